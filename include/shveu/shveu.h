@@ -20,6 +20,51 @@ extern "C" {
  * - \link shveu.h shveu.h \endlink, \link veu_colorspace.h veu_colorspace.h \endlink:
  * Documentation of the SHVEU C API
  *
+ * - \link veu_pyramid.h veu_pyramid.h \endlink:
+ * Image pyramid generation
+ *
+ * - \link veu_dirty.h veu_dirty.h \endlink:
+ * Incremental conversion of dirty rectangles
+ *
+ * - \link veu_dedup.h veu_dedup.h \endlink:
+ * Duplicate frame detection
+ *
+ * - \link veu_cpu.h veu_cpu.h \endlink:
+ * Software implementation of VEU operations
+ *
+ * - \link veu_sched.h veu_sched.h \endlink:
+ * Scheduling between the VEU and the CPU
+ *
+ * - \link veu_queue.h veu_queue.h \endlink:
+ * Prioritised submission of VEU operations
+ *
+ * - \link veu_broker.h veu_broker.h \endlink:
+ * Sharing a VEU between processes
+ *
+ * - \link veu_ring.h veu_ring.h \endlink:
+ * Lock-free submission rings
+ *
+ * - \link veu_fb.h veu_fb.h \endlink:
+ * Framebuffer output
+ *
+ * - \link veu_prepared.h veu_prepared.h \endlink:
+ * Pre-validated operations
+ *
+ * - \link veu_overlay.h veu_overlay.h \endlink:
+ * Blending overlay layers onto video
+ *
+ * - \link veu_stats.h veu_stats.h \endlink:
+ * Image statistics
+ *
+ * - \link veu_surface.h veu_surface.h \endlink:
+ * Buffer layout
+ *
+ * - \link veu_cache.h veu_cache.h \endlink:
+ * Cache maintenance
+ *
+ * - \link shveu.hpp shveu.hpp \endlink:
+ * C++ interface
+ *
  * - \link configuration Configuration \endlink:
  * Customizing libshveu
  *
@@ -86,6 +131,10 @@ extern "C" {
 
 /**
  * Open a VEU device.
+ *
+ * If the environment variable SHVEU_TOPOLOGY_CACHE names a writable file,
+ * the device found is recorded there and later calls (in any process)
+ * skip searching for it, until the system is rebooted.
  * \retval 0 Success
  */
 int shveu_open(void);
@@ -96,6 +145,20 @@ int shveu_open(void);
 void shveu_close(void);
 
 #include <shveu/veu_colorspace.h>
+#include <shveu/veu_pyramid.h>
+#include <shveu/veu_dirty.h>
+#include <shveu/veu_dedup.h>
+#include <shveu/veu_cpu.h>
+#include <shveu/veu_sched.h>
+#include <shveu/veu_queue.h>
+#include <shveu/veu_broker.h>
+#include <shveu/veu_ring.h>
+#include <shveu/veu_fb.h>
+#include <shveu/veu_prepared.h>
+#include <shveu/veu_overlay.h>
+#include <shveu/veu_stats.h>
+#include <shveu/veu_surface.h>
+#include <shveu/veu_cache.h>
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,519 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * C++ interface (C++11 or later), header only
+ *
+ * shveu::Device opens and closes the VEU, and shveu::Buffer owns a block
+ * of memory the VEU can access; both can be moved but not copied. An
+ * shveu::Image is a view of an image in such memory, tagged with its
+ * format, eg. Image<NV12>. Its geometry may also be fixed at compile time,
+ * eg. Image<NV12, 640, 480>.
+ *
+ * Converting between two image types is only allowed if the VEU supports
+ * their formats, so eg. rotating an NV24 image does not compile. If the
+ * geometry of both is fixed, scaling while rotating, an odd pitch, or a
+ * size outside the VEU limits does not compile either. The rules are
+ * those of SHVEU_OP_VALID().
+ *
+ * A shveu::Conversion is checked once when it is created, and can then be
+ * repeated on other images of the same types without further checks.
+ *
+ * shveu::Dispatcher and shveu::Ring wrap the submission rings. With C++20,
+ * an operation submitted to a ring can be awaited with co_await, so that
+ * many operations are in flight on a single thread: the event loop waits
+ * for Ring::fd() to become readable and calls Ring::complete(), which
+ * resumes the coroutines whose operations have completed.
+ *
+ * Nothing here allocates memory.
+ */
+
+#ifndef __SHVEU_HPP__
+#define __SHVEU_HPP__
+
+#ifdef __cplusplus
+
+#include <cstddef>
+#if __cplusplus >= 202002L
+#include <coroutine>
+#endif
+
+#include <shveu/shveu.h>
+
+namespace shveu {
+
+/** \name Format tags
+ * @{ */
+struct RGB565 { static constexpr shveu_format_t format = SHVEU_RGB565; };
+struct RGB565BE { static constexpr shveu_format_t format = SHVEU_RGB565_BE; };
+struct NV12 { static constexpr shveu_format_t format = SHVEU_YCbCr420; };
+struct NV21 { static constexpr shveu_format_t format = SHVEU_YCrCb420; };
+struct NV16 { static constexpr shveu_format_t format = SHVEU_YCbCr422; };
+struct NV24 { static constexpr shveu_format_t format = SHVEU_YCbCr444; };
+/** @} */
+
+/** The VEU, open for the lifetime of the object. Only one should exist
+ * at a time. */
+class Device {
+public:
+	Device() : open_(shveu_open() == 0) {}
+	~Device() { close(); }
+
+	Device(Device &&other) : open_(other.open_) { other.open_ = false; }
+	Device &operator=(Device &&other)
+	{
+		if (this != &other) {
+			close();
+			open_ = other.open_;
+			other.open_ = false;
+		}
+		return *this;
+	}
+
+	Device(const Device &) = delete;
+	Device &operator=(const Device &) = delete;
+
+	/** False if the VEU could not be opened */
+	explicit operator bool() const { return open_; }
+
+	/** Index of the VEU, for the C functions */
+	unsigned int index() const { return 0; }
+
+	void close()
+	{
+		if (open_)
+			shveu_close();
+		open_ = false;
+	}
+
+private:
+	bool open_;
+};
+
+/** A block of memory the VEU can access, released when the object is
+ * destroyed. The memory is allocated by the caller, eg. with uiomux, and
+ * released by the function passed in. */
+class Buffer {
+public:
+	/** Releases size bytes at virt; ctx is as passed to the constructor */
+	typedef void (*release_fn)(void *ctx, void *virt, std::size_t size);
+
+	Buffer() : virt_(nullptr), phys_(0), size_(0), release_(nullptr), ctx_(nullptr) {}
+
+	/** Take ownership of a block of memory
+	 * \param virt Virtual address
+	 * \param phys Physical address
+	 * \param size Size in bytes
+	 * \param release Function to release the memory, or NULL to leave it
+	 * \param ctx Argument passed to \a release
+	 */
+	Buffer(void *virt, unsigned long phys, std::size_t size,
+	       release_fn release = nullptr, void *ctx = nullptr)
+		: virt_(virt), phys_(phys), size_(size), release_(release), ctx_(ctx) {}
+
+	~Buffer() { reset(); }
+
+	Buffer(Buffer &&other) : Buffer() { swap(other); }
+	Buffer &operator=(Buffer &&other)
+	{
+		if (this != &other) {
+			reset();
+			swap(other);
+		}
+		return *this;
+	}
+
+	Buffer(const Buffer &) = delete;
+	Buffer &operator=(const Buffer &) = delete;
+
+	void *virt() const { return virt_; }
+	unsigned long phys() const { return phys_; }
+	std::size_t size() const { return size_; }
+
+	explicit operator bool() const { return virt_ != nullptr; }
+
+	/** Release the memory now */
+	void reset()
+	{
+		if (virt_ && release_)
+			release_(ctx_, virt_, size_);
+		virt_ = nullptr;
+		phys_ = 0;
+		size_ = 0;
+		release_ = nullptr;
+		ctx_ = nullptr;
+	}
+
+private:
+	void swap(Buffer &other)
+	{
+		void *virt = virt_; virt_ = other.virt_; other.virt_ = virt;
+		unsigned long phys = phys_; phys_ = other.phys_; other.phys_ = phys;
+		std::size_t size = size_; size_ = other.size_; other.size_ = size;
+		release_fn release = release_; release_ = other.release_; other.release_ = release;
+		void *ctx = ctx_; ctx_ = other.ctx_; other.ctx_ = ctx;
+	}
+
+	void *virt_;
+	unsigned long phys_;
+	std::size_t size_;
+	release_fn release_;
+	void *ctx_;
+};
+
+/** An image at physical addresses, in format Fmt. If W is nonzero, the
+ * geometry is W x H pixels with a pitch of Pitch pixels, fixed at compile
+ * time; otherwise it is given at run time. The image does not own its
+ * memory. */
+template <typename Fmt, unsigned long W = 0, unsigned long H = 0, unsigned long Pitch = W>
+class Image {
+public:
+	typedef Fmt format_type;
+
+	static constexpr bool fixed = (W != 0);
+	static constexpr unsigned long fixed_width = W;
+	static constexpr unsigned long fixed_height = H;
+	static constexpr unsigned long fixed_pitch = Pitch;
+
+	static_assert(!fixed || (H != 0 && Pitch >= W),
+		      "image height is zero or pitch is less than the width");
+	static_assert(Pitch % 2 == 0, "the VEU requires an even line pitch");
+
+	/** An image of fixed geometry at the given plane addresses */
+	Image(unsigned long py, unsigned long pc)
+		: py_(py), pc_(pc), width_(W), height_(H), pitch_(Pitch)
+	{
+		static_assert(fixed, "the geometry of this image type is not fixed");
+	}
+
+	/** An image of fixed geometry at the start of a buffer, with the
+	 * CbCr plane straight after the Y plane */
+	explicit Image(const Buffer &buf)
+		: Image(buf.phys(), buf.phys() + Pitch * H) {}
+
+	/** An image at the given plane addresses */
+	Image(unsigned long py, unsigned long pc, unsigned long width,
+	      unsigned long height, unsigned long pitch)
+		: py_(py), pc_(pc), width_(width), height_(height), pitch_(pitch)
+	{
+		static_assert(!fixed, "the geometry of this image type is fixed");
+	}
+
+	/** An image at the start of a buffer, with the CbCr plane straight
+	 * after the Y plane */
+	Image(const Buffer &buf, unsigned long width, unsigned long height,
+	      unsigned long pitch)
+		: Image(buf.phys(), buf.phys() + pitch * height, width, height, pitch) {}
+
+	unsigned long py() const { return py_; }
+	unsigned long pc() const { return pc_; }
+	unsigned long width() const { return fixed ? W : width_; }
+	unsigned long height() const { return fixed ? H : height_; }
+	unsigned long pitch() const { return fixed ? Pitch : pitch_; }
+
+private:
+	unsigned long py_, pc_;
+	unsigned long width_, height_, pitch_;
+};
+
+/** Whether the VEU can convert an image of type Src to type Dst with
+ * rotation Rot: always false for unsupported formats, and if the geometry
+ * of both types is fixed, false unless the geometry is supported too */
+template <typename Src, typename Dst, shveu_rotation_t Rot = SHVEU_NO_ROT>
+struct can_convert {
+	static constexpr bool value =
+		SHVEU_FORMATS_VALID(Src::format_type::format, Dst::format_type::format, Rot) &&
+		(!Src::fixed || !Dst::fixed ||
+		 SHVEU_GEOMETRY_VALID(Src::fixed_width, Src::fixed_height, Src::fixed_pitch,
+				      Dst::fixed_width, Dst::fixed_height, Dst::fixed_pitch,
+				      Rot, 8));
+};
+
+/** Convert src into dst, checking the geometry at run time
+ * \retval 0 Success
+ * \retval -1 Error: The VEU cannot perform this operation
+ */
+template <shveu_rotation_t Rot = SHVEU_NO_ROT, typename Src, typename Dst>
+int convert(unsigned int veu_index, const Src &src, const Dst &dst)
+{
+	static_assert(can_convert<Src, Dst, Rot>::value,
+		      "the VEU cannot perform this conversion");
+
+	return shveu_operation(veu_index,
+		src.py(), src.pc(), src.width(), src.height(), src.pitch(),
+		Src::format_type::format,
+		dst.py(), dst.pc(), dst.width(), dst.height(), dst.pitch(),
+		Dst::format_type::format, Rot);
+}
+
+template <shveu_rotation_t Rot = SHVEU_NO_ROT, typename Src, typename Dst>
+int convert(const Device &dev, const Src &src, const Dst &dst)
+{
+	return convert<Rot>(dev.index(), src, dst);
+}
+
+/** A conversion from images of type Src to images of type Dst, checked
+ * once and then repeated on any images of the same types. Where a type's
+ * geometry is not fixed, the images passed must have the geometry of
+ * those the conversion was created with. */
+template <typename Src, typename Dst, shveu_rotation_t Rot = SHVEU_NO_ROT>
+class Conversion {
+public:
+	static_assert(can_convert<Src, Dst, Rot>::value,
+		      "the VEU cannot perform this conversion");
+
+	/** Check the conversion of src into dst, on an open VEU
+	 * \param veu_index Index of which VEU to use
+	 * \param src Source image
+	 * \param dst Destination image
+	 * \param dst_flags Flags of the destination format, eg. a
+	 * SHVEU_FILTER flag
+	 */
+	Conversion(unsigned int veu_index, const Src &src, const Dst &dst,
+		   int dst_flags = 0)
+		: veu_index_(veu_index)
+	{
+		struct shveu_op op;
+
+		op.src_py = src.py();
+		op.src_pc = src.pc();
+		op.src_width = src.width();
+		op.src_height = src.height();
+		op.src_pitch = src.pitch();
+		op.src_fmt = Src::format_type::format;
+		op.dst_py = dst.py();
+		op.dst_pc = dst.pc();
+		op.dst_width = dst.width();
+		op.dst_height = dst.height();
+		op.dst_pitch = dst.pitch();
+		op.dst_fmt = (shveu_format_t)(Dst::format_type::format | dst_flags);
+		op.rotate = Rot;
+
+		ok_ = (shveu_prepare(&prep_, &op) == 0);
+	}
+
+	Conversion(const Device &dev, const Src &src, const Dst &dst, int dst_flags = 0)
+		: Conversion(dev.index(), src, dst, dst_flags) {}
+
+	/** False if the VEU cannot perform the conversion */
+	explicit operator bool() const { return ok_; }
+
+	/** Convert src into dst and wait for completion. No checks are made;
+	 * the conversion must be valid. */
+	void operator()(const Src &src, const Dst &dst)
+	{
+		set_planes(src, dst);
+		shveu_prepared_operation(veu_index_, &prep_);
+	}
+
+	/** Start converting src into dst. The VEU is held until completion
+	 * is waited for with shveu_wait(). No checks are made. */
+	void start(const Src &src, const Dst &dst)
+	{
+		set_planes(src, dst);
+		shveu_prepared_start(veu_index_, &prep_);
+	}
+
+	/** The prepared operation, for the C functions */
+	const struct shveu_prepared *prepared() const { return &prep_; }
+
+private:
+	void set_planes(const Src &src, const Dst &dst)
+	{
+		prep_.op.src_py = src.py();
+		prep_.op.src_pc = src.pc();
+		prep_.op.dst_py = dst.py();
+		prep_.op.dst_pc = dst.pc();
+	}
+
+	unsigned int veu_index_;
+	bool ok_;
+	struct shveu_prepared prep_;
+};
+
+/** A dispatcher thread, running for the lifetime of the object */
+class Dispatcher {
+public:
+	/** Start a dispatcher thread, as shveu_dispatcher_start() */
+	explicit Dispatcher(unsigned int veu_index = 0, shveu_exec_t exec = nullptr,
+			    void *arg = nullptr)
+		: d_(shveu_dispatcher_start(veu_index, exec, arg)) {}
+
+	~Dispatcher() { stop(); }
+
+	Dispatcher(Dispatcher &&other) : d_(other.d_) { other.d_ = nullptr; }
+	Dispatcher &operator=(Dispatcher &&other)
+	{
+		if (this != &other) {
+			stop();
+			d_ = other.d_;
+			other.d_ = nullptr;
+		}
+		return *this;
+	}
+
+	Dispatcher(const Dispatcher &) = delete;
+	Dispatcher &operator=(const Dispatcher &) = delete;
+
+	/** False if the thread could not be started */
+	explicit operator bool() const { return d_ != nullptr; }
+
+	struct shveu_dispatcher *get() const { return d_; }
+
+	/** Stop the thread. All its rings must have been destroyed. */
+	void stop()
+	{
+		if (d_)
+			shveu_dispatcher_stop(d_);
+		d_ = nullptr;
+	}
+
+private:
+	struct shveu_dispatcher *d_;
+};
+
+/** A submission ring, to be used by one thread. Operations awaited on the
+ * ring refer to it, so it can be neither copied nor moved. */
+class Ring {
+public:
+	/** Create a ring, as shveu_ring_create() */
+	Ring(const Dispatcher &dispatcher, unsigned int size)
+		: r_(shveu_ring_create(dispatcher.get(), size)) {}
+
+	/** Operations still in flight are completed first, but coroutines
+	 * awaiting them are not resumed */
+	~Ring()
+	{
+		if (r_)
+			shveu_ring_destroy(r_);
+	}
+
+	Ring(const Ring &) = delete;
+	Ring &operator=(const Ring &) = delete;
+
+	/** False if the ring could not be created */
+	explicit operator bool() const { return r_ != nullptr; }
+
+	struct shveu_ring *get() const { return r_; }
+
+	/** As shveu_ring_submit() */
+	int submit(const struct shveu_op &op, void *cookie)
+	{
+		return shveu_ring_submit(r_, &op, cookie);
+	}
+
+	/** As shveu_ring_reap() */
+	int reap(void **cookie, int *result)
+	{
+		return shveu_ring_reap(r_, cookie, result);
+	}
+
+	/** As shveu_ring_fd() */
+	int fd() { return shveu_ring_fd(r_); }
+
+#if __cplusplus >= 202002L
+	/** An operation that can be awaited, with co_await, for its result
+	 * (0 for success). It is submitted when first awaited, and if the
+	 * ring is full, as soon as there is room. */
+	class Operation {
+	public:
+		Operation(Ring &ring, const struct shveu_op &op) : ring_(ring), op_(op) {}
+
+		bool await_ready() const noexcept { return false; }
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept
+		{
+			handle_ = handle;
+
+			/* Keep to the order of awaiting */
+			if (ring_.waiting_ || ring_.submit(op_, this) < 0)
+				ring_.wait(this);
+		}
+
+		int await_resume() const noexcept { return result_; }
+
+	private:
+		friend class Ring;
+
+		Ring &ring_;
+		struct shveu_op op_;
+		std::coroutine_handle<> handle_;
+		int result_ = -1;
+		Operation *next_ = nullptr;
+	};
+
+	/** An operation to await. Only one of submit() and this interface
+	 * may be used on a ring.
+	 * \param op The operation to perform
+	 */
+	Operation operator()(const struct shveu_op &op) { return Operation(*this, op); }
+
+	/** Resume the coroutines whose operations have completed, and submit
+	 * those waiting for room. Call when fd() is readable.
+	 * \returns The number of coroutines resumed
+	 */
+	int complete()
+	{
+		Operation *op;
+		void *cookie;
+		int result, n = 0;
+
+		while (shveu_ring_reap(r_, &cookie, &result) == 1) {
+			op = static_cast<Operation *>(cookie);
+			op->result_ = result;
+			submit_waiting();
+			/* May destroy op, or await further operations */
+			op->handle_.resume();
+			n++;
+		}
+		submit_waiting();
+
+		return n;
+	}
+
+private:
+	/* Queue an operation until there is room in the ring */
+	void wait(Operation *op)
+	{
+		if (waiting_)
+			last_->next_ = op;
+		else
+			waiting_ = op;
+		last_ = op;
+	}
+
+	void submit_waiting()
+	{
+		while (waiting_ && submit(waiting_->op_, waiting_) == 0)
+			waiting_ = waiting_->next_;
+	}
+
+	Operation *waiting_ = nullptr;
+	Operation *last_ = nullptr;
+#endif
+
+private:
+	struct shveu_ring *r_;
+};
+
+} /* namespace shveu */
+
+#endif /* __cplusplus */
+
+#endif /* __SHVEU_HPP__ */
@@ -0,0 +1,111 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Sharing a VEU between processes through a broker process
+ *
+ * One process (the broker) opens the VEU and creates a shared job queue.
+ * Other processes (clients) connect to the queue and submit operations
+ * instead of calling shveu_open() and locking the VEU themselves. Jobs
+ * from all clients are dispatched back to back by the broker.
+ *
+ * Jobs are queued in shared memory without locks and performed in order
+ * of submission; completion is signalled with a futex, so a client only
+ * enters the kernel to sleep.
+ * Buffers are passed by physical address and must be visible to the
+ * broker, eg. allocated with uiomux. The broker refuses operations on
+ * images outside the VEU memory region and the ranges it has registered
+ * with shveu_cache_register().
+ *
+ * Job slots held by clients that die are freed by the broker, which
+ * assumes that clients and broker share a pid namespace.
+ */
+
+#ifndef __VEU_BROKER_H__
+#define __VEU_BROKER_H__
+
+#include <sys/types.h>
+
+#include <shveu/veu_colorspace.h>
+
+/** Opaque broker handle */
+struct shveu_broker;
+
+/** Opaque client handle */
+struct shveu_client;
+
+/** Create a broker job queue. Fails if another broker is running on
+ * the same file, or if the file belongs to another user.
+ * \param path Path of the file backing the queue, eg. "/dev/shm/shveu"
+ * \param mode Permissions of the file, which decide who may submit jobs,
+ * eg. 0600 for processes of the same user, 0660 for a group
+ * \param veu_index Index of which VEU to dispatch jobs to
+ * \param exec Function performing each operation, or NULL to perform it on
+ * the VEU. Pass a simulated VEU here to run without hardware.
+ * \param arg Argument passed to \a exec
+ * \returns A broker handle, or NULL on error
+ */
+struct shveu_broker *
+shveu_broker_open(
+	const char *path,
+	mode_t mode,
+	unsigned int veu_index,
+	shveu_exec_t exec,
+	void *arg);
+
+/** Dispatch queued jobs. Jobs are performed back to back until the queue
+ * is empty; if there are none, wait up to \a timeout_ms for the first one.
+ * \param broker The broker
+ * \param timeout_ms Maximum time to wait for work, or -1 to wait forever
+ * \returns The number of jobs performed
+ */
+int
+shveu_broker_dispatch(struct shveu_broker *broker, int timeout_ms);
+
+/** Destroy a broker job queue. The backing file is removed.
+ * \param broker The broker
+ */
+void
+shveu_broker_close(struct shveu_broker *broker);
+
+/** Connect to a broker job queue
+ * \param path Path of the file backing the queue
+ * \returns A client handle, or NULL on error
+ */
+struct shveu_client *
+shveu_client_connect(const char *path);
+
+/** Perform an operation through the broker and wait for it to complete.
+ * Fails if no job slot becomes free within a second, or if the broker
+ * goes away.
+ * \param client The client
+ * \param op The operation to perform
+ * \retval 0 Success
+ * \retval -1 Error
+ */
+int
+shveu_client_operation(struct shveu_client *client, const struct shveu_op *op);
+
+/** Disconnect from a broker job queue
+ * \param client The client
+ */
+void
+shveu_client_disconnect(struct shveu_client *client);
+
+#endif				/* __VEU_BROKER_H__ */
@@ -0,0 +1,97 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Cache maintenance for buffers mapped cached by the CPU
+ *
+ * The VEU does not snoop the CPU cache. Buffers are therefore usually
+ * mapped uncached, which makes CPU access to them, such as post-processing
+ * of converted output, several times slower. Buffers that the application
+ * maps cached can instead be registered with shveu_cache_register(). Around
+ * each operation on the VEU, libshveu then writes back the cache lines of
+ * the source and destination image data before the VEU starts, and
+ * discards the cache lines of the destination once it has finished.
+ *
+ * Only the bytes the operation actually reads or writes are maintained,
+ * as worked out from the geometry and line pitch of each plane. Lines
+ * of an image that is much narrower than its pitch are maintained one at
+ * a time. Cached buffers should start on cache line boundaries and have
+ * a cache line aligned pitch, eg. as laid out with SHVEU_ALIGN_LINES,
+ * so that no cache line is shared between an image and other data.
+ *
+ * Within registered ranges, the libshveu functions that access image data
+ * on the CPU, such as the CPU fallback of shveu_sched_operation(),
+ * use the cached mapping.
+ *
+ * If no ranges are registered, as on coherent systems, no maintenance is
+ * performed.
+ */
+
+#ifndef __VEU_CACHE_H__
+#define __VEU_CACHE_H__
+
+/** Maximum number of cached ranges registered at once */
+#define SHVEU_MAX_CACHED_RANGES 8
+
+/** Cache maintenance operations. On SH-Mobile the default operations use
+ * the cacheflush system call on the registered virtual address; elsewhere
+ * there are no default operations, and memory is taken to be coherent
+ * unless operations are set. Operations may also be set to simulate a
+ * non-coherent device, eg. by recording the ranges maintained. */
+struct shveu_cache_ops {
+	/** Write back the dirty cache lines of a range, so that the VEU
+	 * reads what the CPU wrote */
+	void (*writeback)(void *virt, unsigned long phys, unsigned long len,
+			  void *data);
+
+	/** Discard the cache lines of a range, so that the CPU reads what
+	 * the VEU wrote */
+	void (*invalidate)(void *virt, unsigned long phys, unsigned long len,
+			   void *data);
+
+	/** Passed to the operations */
+	void *data;
+};
+
+/** Declare a range of physical memory as mapped cached at a virtual address
+ * \param virt Virtual address of the cached mapping
+ * \param phys Physical address of the range
+ * \param len Length in bytes of the range
+ * \retval 0 Success
+ * \retval -1 Error: Too many ranges, or the range overlaps a registered range
+ */
+int
+shveu_cache_register(void *virt, unsigned long phys, unsigned long len);
+
+/** Remove a range declared with shveu_cache_register(). The caller must
+ * ensure that no operation on the range is in progress.
+ * \param phys Physical address of the range
+ * \retval 0 Success
+ * \retval -1 Error: No range is registered at phys
+ */
+int
+shveu_cache_unregister(unsigned long phys);
+
+/** Set the cache maintenance operations
+ * \param ops The operations, which are copied, or NULL for the defaults
+ */
+void
+shveu_cache_set_ops(const struct shveu_cache_ops *ops);
+
+#endif				/* __VEU_CACHE_H__ */
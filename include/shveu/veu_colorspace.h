@@ -30,15 +30,88 @@ typedef enum {
 	SHVEU_ROT_90,	/**< Rotate 90 degrees clockwise */
 } shveu_rotation_t;
 
-/** Image formats */
+/** Image formats.
+ * The VEU reads and writes big-endian RGB565 directly, and converts
+ * YCrCb 4:2:0 to RGB on VEU2H. Other operations on YCrCb 4:2:0 and the
+ * packed 4:2:2 formats, and rotation of YCbCr 4:4:4, are rejected by
+ * shveu_start(); they are performed on the CPU by shveu_sched_operation()
+ * and shveu_cpu_operation(). Line pitches are always given in pixels.
+ *
+ * A YCbCr format may be ORed with SHVEU_FULL_RANGE and SHVEU_BT709 to
+ * describe how its values relate to RGB. The flags of the YCbCr surface
+ * select the conversion matrix when converting to or from RGB, and are
+ * otherwise ignored.
+ *
+ * The destination format may also be ORed with one of the SHVEU_FILTER
+ * flags to choose how the image is filtered when it is scaled.
+ */
 typedef enum {
 	
 	SHVEU_RGB565=0,	/**< RGB565 */
 	SHVEU_YCbCr420,	/**< YCbCr 4:2:0 */
 	SHVEU_YCbCr422,	/**< YCbCr 4:2:2 */
+	SHVEU_YCrCb420,	/**< YCrCb 4:2:0 (NV21): YCbCr 4:2:0 with Cr before Cb */
+	SHVEU_YUYV,	/**< YCbCr 4:2:2 packed in a single plane as Y0 Cb Y1 Cr */
+	SHVEU_UYVY,	/**< YCbCr 4:2:2 packed in a single plane as Cb Y0 Cr Y1 */
+	SHVEU_RGB565_BE,	/**< RGB565, most significant byte first */
+	SHVEU_YCbCr444,	/**< YCbCr 4:4:4 (NV24): a CbCr plane of 2*pitch bytes per line */
 } shveu_format_t;
 
-/** Start a (scale|rotate) & crop between YCbCr 4:2:0 & RG565 surfaces
+/** Format flag: YCbCr uses the full 0-255 range, as in JPEG, rather than
+ * 16-235 for Y and 16-240 for Cb and Cr */
+#define SHVEU_FULL_RANGE (1 << 16)
+
+/** Format flag: YCbCr uses the BT.709 (HD) matrix rather than BT.601 */
+#define SHVEU_BT709 (1 << 17)
+
+/** Scaling filter flag: the default, interpolating between the nearest
+ * source pixels. */
+#define SHVEU_FILTER_DEFAULT (0 << 18)
+
+/** Scaling filter flag: fastest. The CPU samples the nearest source pixel;
+ * the VEU, which always interpolates, is as for SHVEU_FILTER_DEFAULT. */
+#define SHVEU_FILTER_FAST (1 << 18)
+
+/** Scaling filter flag: anti-aliased. When scaling down, the CPU averages
+ * the source pixels covered by each destination pixel. The VEU refuses this
+ * filter, so the scheduler performs such operations on the CPU. */
+#define SHVEU_FILTER_SMOOTH (2 << 18)
+
+/** Mask to extract the scaling filter flag from a destination format */
+#define SHVEU_FILTER_MASK (3 << 18)
+
+/** Mask to remove the format flags from a format */
+#define SHVEU_FORMAT_MASK 0xffff
+
+/** Parameters of a single VEU operation, as passed to shveu_operation() */
+struct shveu_op {
+	unsigned long src_py;		/**< Physical address of Y or RGB plane of source image */
+	unsigned long src_pc;		/**< Physical address of CbCr plane of source image */
+	unsigned long src_width;	/**< Width in pixels of source image */
+	unsigned long src_height;	/**< Height in pixels of source image */
+	unsigned long src_pitch;	/**< Line pitch of source image */
+	shveu_format_t src_fmt;		/**< Format of source image */
+	unsigned long dst_py;		/**< Physical address of Y or RGB plane of destination image */
+	unsigned long dst_pc;		/**< Physical address of CbCr plane of destination image */
+	unsigned long dst_width;	/**< Width in pixels of destination image */
+	unsigned long dst_height;	/**< Height in pixels of destination image */
+	unsigned long dst_pitch;	/**< Line pitch of destination image */
+	shveu_format_t dst_fmt;		/**< Format of destination image */
+	shveu_rotation_t rotate;	/**< Rotation to apply */
+};
+
+/** Function performing an operation on behalf of a dispatcher, such as
+ * the broker or a submission ring. Used to substitute a simulated VEU.
+ * \param arg User argument given when the dispatcher was created
+ * \param op The operation to perform
+ * \returns The result reported to the submitter (0 for success)
+ */
+typedef int (*shveu_exec_t)(void *arg, const struct shveu_op *op);
+
+/** Start a (scale|rotate) & crop between YCbCr 4:2:0 & RG565 surfaces.
+ * If another thread is using the VEU, this waits for it in the queue of
+ * shveu_submit(). The VEU is then held until shveu_wait(), which must
+ * follow every successful call.
  * \param veu_index Index of which VEU to use
  * \param src_py Physical address of Y or RGB plane of source image
  * \param src_pc Physical address of CbCr plane of source image (ignored for RGB)
@@ -73,7 +146,8 @@ shveu_start(
 	shveu_format_t dst_fmt,
 	shveu_rotation_t rotate);
 
-/** Wait for a VEU operation to complete. The operation is started by a call to shveu_start.
+/** Wait for a VEU operation to complete, and release the VEU to other
+ * threads. The operation is started by a call to shveu_start.
  * \param veu_index Index of which VEU to use
  */
 void
@@ -0,0 +1,67 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Software implementation of VEU operations
+ */
+
+#ifndef __VEU_CPU_H__
+#define __VEU_CPU_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** Perform (scale|rotate) & crop between YCbCr 4:2:0 & RG565 surfaces on
+ * the CPU. The parameters have the same meaning as for shveu_operation(),
+ * except that buffers are given by virtual address. Scaling uses nearest
+ * neighbour sampling and color conversion uses the BT.601 matrix. All
+ * formats are supported, and are read and written in place: packed or
+ * byte-swapped data needs no separate repacking pass.
+ * \param src_y Y, RGB or packed YCbCr plane of source image
+ * \param src_c CbCr plane of source image (ignored for single plane formats)
+ * \param src_width Width in pixels of source image
+ * \param src_height Height in pixels of source image
+ * \param src_pitch Line pitch of source image
+ * \param src_fmt Format of source image
+ * \param dst_y Y, RGB or packed YCbCr plane of destination image
+ * \param dst_c CbCr plane of destination image (ignored for single plane formats)
+ * \param dst_width Width in pixels of destination image
+ * \param dst_height Height in pixels of destination image
+ * \param dst_pitch Line pitch of destination image
+ * \param dst_fmt Format of destination image
+ * \param rotate Rotation to apply
+ * \retval 0 Success
+ * \retval -1 Error: Attempt to perform simultaneous scaling and rotation
+ */
+int
+shveu_cpu_operation(
+	const void *src_y,
+	const void *src_c,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	void *dst_y,
+	void *dst_c,
+	unsigned long dst_width,
+	unsigned long dst_height,
+	unsigned long dst_pitch,
+	shveu_format_t dst_fmt,
+	shveu_rotation_t rotate);
+
+#endif				/* __VEU_CPU_H__ */
@@ -0,0 +1,54 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Duplicate frame detection: skip conversions whose output already exists
+ */
+
+#ifndef __VEU_DEDUP_H__
+#define __VEU_DEDUP_H__
+
+/** Enable or disable skipping of duplicate frames in shveu_operation().
+ * When enabled, a content hash of the source planes is calculated for each
+ * operation. If the source content, geometry, formats and destination all
+ * match the previous operation on the same VEU, the destination already
+ * holds the result and the operation is skipped.
+ * Only source planes within the VEU memory region can be hashed; other
+ * operations are always performed.
+ * \param veu_index Index of which VEU to use
+ * \param enable 1 to enable, 0 to disable (default)
+ */
+void
+shveu_set_skip_duplicates(unsigned int veu_index, int enable);
+
+/** Forget the previous operation, so that the next operation is always
+ * performed. Call this after modifying a destination buffer by other means.
+ * \param veu_index Index of which VEU to use
+ */
+void
+shveu_invalidate_duplicates(unsigned int veu_index);
+
+/** Get the number of operations skipped as duplicates
+ * \param veu_index Index of which VEU to use
+ * \returns The number of operations skipped since skipping was enabled
+ */
+unsigned long
+shveu_get_skipped_frames(unsigned int veu_index);
+
+#endif				/* __VEU_DEDUP_H__ */
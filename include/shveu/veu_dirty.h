@@ -0,0 +1,68 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Incremental conversion of changed (dirty) regions of a frame
+ */
+
+#ifndef __VEU_DIRTY_H__
+#define __VEU_DIRTY_H__
+
+/** A rectangle within an image, in pixels */
+struct shveu_rect {
+	unsigned long x;	/**< Left edge */
+	unsigned long y;	/**< Top edge */
+	unsigned long width;	/**< Width */
+	unsigned long height;	/**< Height */
+};
+
+/** Maximum number of separate regions converted by one call. If more
+ * regions remain after merging, the whole frame is converted instead. */
+#define SHVEU_MAX_DIRTY_RECTS 16
+
+/** Perform color conversion from YCbCr 4:2:0 to RGB565 of only the
+ * changed regions of an image. Source and destination have the same size.
+ * Rectangles are grown to meet chroma and VEU alignment restrictions and
+ * overlapping rectangles are merged. If the regions cover most of the image
+ * a single full-frame conversion is performed instead.
+ * \param y_in Physical address of input Y plane
+ * \param c_in Physical address of input CbCr plane
+ * \param rgb565_out Physical address of output RGB565 image
+ * \param width Width in pixels of image
+ * \param height Height in pixels of image
+ * \param pitch_in Line pitch of input image
+ * \param pitch_out Line pitch of output image
+ * \param rects Array of changed regions
+ * \param nr_rects Number of entries in \a rects
+ * \retval 0 Success
+ * \retval -1 Error
+ */
+int
+shveu_nv12_to_rgb565_rects(
+	unsigned long y_in,
+	unsigned long c_in,
+	unsigned long rgb565_out,
+	unsigned long width,
+	unsigned long height,
+	unsigned long pitch_in,
+	unsigned long pitch_out,
+	const struct shveu_rect *rects,
+	int nr_rects);
+
+#endif				/* __VEU_DIRTY_H__ */
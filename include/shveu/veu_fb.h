@@ -0,0 +1,125 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Converting directly into an RGB565 framebuffer
+ *
+ * The VEU writes into the framebuffer memory itself, so no copy is needed
+ * to display a frame. If the virtual resolution of the framebuffer is at
+ * least twice its visible height, frames can be drawn into the hidden half
+ * and shown by panning, so that a frame is never displayed half drawn.
+ */
+
+#ifndef __VEU_FB_H__
+#define __VEU_FB_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** A framebuffer. All members are read-only. */
+struct shveu_fb {
+	int fd;			/**< File descriptor of the device or file */
+	unsigned long phys;	/**< Physical address of the framebuffer memory, or 0 for a stand-in file */
+	unsigned char *virt;	/**< Mapping of the framebuffer memory */
+	unsigned long size;	/**< Size in bytes of the mapping */
+	unsigned long width;	/**< Visible width in pixels */
+	unsigned long height;	/**< Visible height in pixels */
+	unsigned long pitch;	/**< Line pitch in pixels */
+	int nr_buffers;		/**< 2 if page flipping, otherwise 1 */
+	int back;		/**< Index of the buffer to draw into next */
+};
+
+/** Open a framebuffer device. Only 16bpp RGB565 framebuffers are
+ * supported; other 16bpp layouts such as RGB555 are refused.
+ * \param device Path of the framebuffer device, eg. "/dev/fb0"
+ * \param flip 1 to page flip if the virtual resolution and the framebuffer
+ * memory allow it, 0 to draw into the visible buffer
+ * \returns A framebuffer handle, or NULL on error
+ */
+struct shveu_fb *
+shveu_fb_open(const char *device, int flip);
+
+/** Create a file to stand in for a framebuffer device, eg. for testing.
+ * The file holds \a nr_buffers images one after the other, and flipping
+ * only changes which one is drawn into. As the file has no physical
+ * address, conversions into it are performed on the CPU.
+ * \param path Path of the file to create
+ * \param width Width in pixels
+ * \param height Height in pixels
+ * \param nr_buffers 1, or 2 to simulate page flipping
+ * \returns A framebuffer handle, or NULL on error
+ */
+struct shveu_fb *
+shveu_fb_open_file(
+	const char *path,
+	unsigned long width,
+	unsigned long height,
+	int nr_buffers);
+
+/** Close a framebuffer
+ * \param fb The framebuffer
+ */
+void
+shveu_fb_close(struct shveu_fb *fb);
+
+/** Get the buffer to draw into next
+ * \param fb The framebuffer
+ * \param py Set to the physical address of the buffer (0 for a stand-in
+ * file); may be NULL
+ * \returns The virtual address of the buffer
+ */
+void *
+shveu_fb_get_buffer(struct shveu_fb *fb, unsigned long *py);
+
+/** Convert a surface to fill the buffer to draw into next. The VEU is used
+ * for a framebuffer device; for a stand-in file the conversion is done on
+ * the CPU, and the source must be within the VEU memory region.
+ * \param veu_index Index of which VEU to use
+ * \param fb The framebuffer
+ * \param src_py Physical address of Y or RGB plane of source image
+ * \param src_pc Physical address of CbCr plane of source image (ignored for RGB)
+ * \param src_width Width in pixels of source image
+ * \param src_height Height in pixels of source image
+ * \param src_pitch Line pitch of source image
+ * \param src_fmt Format of source image
+ * \param rotate Rotation to apply
+ * \retval 0 Success
+ * \retval -1 Error: Unsupported operation
+ */
+int
+shveu_fb_operation(
+	unsigned int veu_index,
+	struct shveu_fb *fb,
+	unsigned long src_py,
+	unsigned long src_pc,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	shveu_rotation_t rotate);
+
+/** Display the buffer drawn into since the last flip. Does nothing if not
+ * page flipping.
+ * \param fb The framebuffer
+ * \retval 0 Success
+ * \retval -1 Error: Panning failed; page flipping is disabled
+ */
+int
+shveu_fb_flip(struct shveu_fb *fb);
+
+#endif				/* __VEU_FB_H__ */
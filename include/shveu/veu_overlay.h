@@ -0,0 +1,129 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Blending overlay layers, such as on-screen display graphics, onto
+ * converted video
+ *
+ * shveu_composite() converts a frame into an RGB565 surface and blends
+ * ARGB8888 layers on top of it. The conversion is performed by the VEU
+ * where possible; the CPU only touches the parts of the destination that
+ * are covered by a layer, working through them a band of lines at a time
+ * so that lines covered by several layers stay in the cache between them.
+ * When the conversion is performed by the CPU, as by shveu_cpu_composite(),
+ * each line is blended as soon as it is converted, in a single pass over
+ * the destination.
+ */
+
+#ifndef __VEU_OVERLAY_H__
+#define __VEU_OVERLAY_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** An overlay layer */
+struct shveu_layer {
+	const void *argb;	/**< Pixels as 32-bit words 0xAARRGGBB, in native byte order */
+	unsigned long width;	/**< Width in pixels */
+	unsigned long height;	/**< Height in pixels */
+	unsigned long pitch;	/**< Line pitch in pixels */
+	long x;			/**< Position of the left edge on the destination; may be negative */
+	long y;			/**< Position of the top edge on the destination; may be negative */
+	unsigned int alpha;	/**< Opacity of the whole layer (0-255), multiplied by each pixel's alpha */
+};
+
+/** Blend layers onto an RGB565 surface, in order, so that later layers
+ * appear on top. Layers are clipped to the surface.
+ * \param dst Virtual address of the surface
+ * \param width Width in pixels of the surface
+ * \param height Height in pixels of the surface
+ * \param pitch Line pitch of the surface
+ * \param fmt Format of the surface: SHVEU_RGB565 or SHVEU_RGB565_BE
+ * \param layers Array of layers
+ * \param nr_layers Number of entries in \a layers
+ * \retval 0 Success
+ * \retval -1 Error: Unsupported format
+ */
+int
+shveu_blend(
+	void *dst,
+	unsigned long width,
+	unsigned long height,
+	unsigned long pitch,
+	shveu_format_t fmt,
+	const struct shveu_layer *layers,
+	int nr_layers);
+
+/** Perform an operation into an RGB565 destination, then blend layers on
+ * top of the result. The operation is scheduled as by
+ * shveu_sched_operation(), and the destination must be within the VEU
+ * memory region. Duplicate detection (see shveu_set_skip_duplicates())
+ * never skips the operation that follows, as the blended destination no
+ * longer holds the VEU's output.
+ * \param veu_index Index of which VEU to use
+ * \param op The operation; dst_fmt must be SHVEU_RGB565 or SHVEU_RGB565_BE
+ * \param layers Array of layers, positioned on the destination image
+ * \param nr_layers Number of entries in \a layers
+ * \retval 0 Success
+ * \retval -1 Error: Invalid operation
+ */
+int
+shveu_composite(
+	unsigned int veu_index,
+	const struct shveu_op *op,
+	const struct shveu_layer *layers,
+	int nr_layers);
+
+/** Perform an operation on the CPU, as shveu_cpu_operation(), into an
+ * RGB565 destination, blending layers onto each line of the destination
+ * as soon as it is converted.
+ * \param src_y Y, RGB or packed YCbCr plane of source image
+ * \param src_c CbCr plane of source image (ignored for single plane formats)
+ * \param src_width Width in pixels of source image
+ * \param src_height Height in pixels of source image
+ * \param src_pitch Line pitch of source image
+ * \param src_fmt Format of source image
+ * \param dst Destination image
+ * \param dst_width Width in pixels of destination image
+ * \param dst_height Height in pixels of destination image
+ * \param dst_pitch Line pitch of destination image
+ * \param dst_fmt Format of destination image: SHVEU_RGB565 or SHVEU_RGB565_BE
+ * \param rotate Rotation to apply
+ * \param layers Array of layers, positioned on the destination image
+ * \param nr_layers Number of entries in \a layers
+ * \retval 0 Success
+ * \retval -1 Error: Invalid operation
+ */
+int
+shveu_cpu_composite(
+	const void *src_y,
+	const void *src_c,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	void *dst,
+	unsigned long dst_width,
+	unsigned long dst_height,
+	unsigned long dst_pitch,
+	shveu_format_t dst_fmt,
+	shveu_rotation_t rotate,
+	const struct shveu_layer *layers,
+	int nr_layers);
+
+#endif				/* __VEU_OVERLAY_H__ */
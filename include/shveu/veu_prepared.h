@@ -0,0 +1,120 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Operations checked once and repeated without further checks
+ *
+ * An application converting a stream of frames usually repeats the same
+ * operation with different buffers. shveu_prepare() checks the operation
+ * against the VEU restrictions and works out its register values once;
+ * shveu_prepared_operation() then only writes them, so nothing is checked
+ * or recalculated per frame. A shveu_prepared is a plain structure, and can
+ * live on the stack or inside the caller's own objects.
+ *
+ * Where the formats and geometry are known at compile time,
+ * SHVEU_STATIC_CHECK_OP() rejects an operation the VEU cannot perform when
+ * the program is built. The same rules are applied by shveu_prepare() at
+ * run time. C++ programs can use the types in shveu.hpp instead.
+ */
+
+#ifndef __VEU_PREPARED_H__
+#define __VEU_PREPARED_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** An operation prepared by shveu_prepare(). Only the plane addresses in
+ * op may be changed afterwards; the other members are private. */
+struct shveu_prepared {
+	struct shveu_op op;	/**< The operation */
+
+	unsigned long vessr, veswr, vedwr, vswpr, vtrcr;
+	unsigned long vrfcr, vrfsr, vrpbr, vfmcr;
+	unsigned long dst_offset;
+	unsigned long vmcr[9], vcoffr;
+};
+
+/** Evaluates to nonzero if the VEU can convert between the given formats
+ * (without flags), rotating if \a rotate is nonzero. A constant expression
+ * if the arguments are. YCrCb 4:2:0 is accepted as a source for RGB, which
+ * only the VEU2H supports; shveu_prepare() checks for it at run time. */
+#define SHVEU_FORMATS_VALID(src_fmt, dst_fmt, rotate)				\
+	(((src_fmt) == SHVEU_YCbCr420 || (src_fmt) == SHVEU_YCbCr422 ||	\
+	  (src_fmt) == SHVEU_YCbCr444 || (src_fmt) == SHVEU_RGB565 ||		\
+	  (src_fmt) == SHVEU_RGB565_BE ||					\
+	  ((src_fmt) == SHVEU_YCrCb420 &&					\
+	   ((dst_fmt) == SHVEU_RGB565 || (dst_fmt) == SHVEU_RGB565_BE))) &&	\
+	 ((dst_fmt) == SHVEU_YCbCr420 || (dst_fmt) == SHVEU_YCbCr422 ||	\
+	  (dst_fmt) == SHVEU_YCbCr444 || (dst_fmt) == SHVEU_RGB565 ||		\
+	  (dst_fmt) == SHVEU_RGB565_BE) &&					\
+	 (!(rotate) || ((src_fmt) != SHVEU_YCbCr444 && (dst_fmt) != SHVEU_YCbCr444)))
+
+/** Evaluates to nonzero if the VEU can perform an operation with the given
+ * geometry (pitches in pixels), scaling up by at most \a max_upscale. A
+ * constant expression if the arguments are. */
+#define SHVEU_GEOMETRY_VALID(src_w, src_h, src_pitch, dst_w, dst_h, dst_pitch, rotate, max_upscale) \
+	((!(rotate) || ((src_w) == (dst_h) && (dst_w) == (src_h))) &&	\
+	 (src_pitch) % 2 == 0 && (dst_pitch) % 2 == 0 &&		\
+	 (src_w) >= 16 && (src_w) <= 4092 &&				\
+	 (src_h) >= 16 && (src_h) <= 4092 &&				\
+	 (dst_w) <= (max_upscale) * (src_w) &&				\
+	 (dst_h) <= (max_upscale) * (src_h) &&				\
+	 (dst_w) >= (src_w) / 16 && (dst_h) >= (src_h) / 16)
+
+/** Evaluates to nonzero if the VEU can perform an operation with the given
+ * formats and geometry. A constant expression if the arguments are. These
+ * are the rules shveu_prepare() applies, except that the scaling limit is
+ * that of the most restrictive VEU (8x upscaling). */
+#define SHVEU_OP_VALID(src_w, src_h, src_pitch, src_fmt, dst_w, dst_h, dst_pitch, dst_fmt, rotate) \
+	(SHVEU_FORMATS_VALID(src_fmt, dst_fmt, rotate) &&		\
+	 SHVEU_GEOMETRY_VALID(src_w, src_h, src_pitch, dst_w, dst_h, dst_pitch, rotate, 8))
+
+/** Fail to compile unless SHVEU_OP_VALID() holds for constant formats and
+ * geometry. May be used at file scope any number of times. */
+#define SHVEU_STATIC_CHECK_OP(src_w, src_h, src_pitch, src_fmt, dst_w, dst_h, dst_pitch, dst_fmt, rotate) \
+	extern char shveu_static_check_op[					\
+		SHVEU_OP_VALID(src_w, src_h, src_pitch, src_fmt,		\
+			       dst_w, dst_h, dst_pitch, dst_fmt, rotate) ? 1 : -1]
+
+/** Check an operation and work out its register values. Must be called
+ * after shveu_open().
+ * \param prep The prepared operation to fill in
+ * \param op The operation
+ * \retval 0 Success
+ * \retval -1 Error: The VEU cannot perform this operation
+ */
+int
+shveu_prepare(struct shveu_prepared *prep, const struct shveu_op *op);
+
+/** Start a prepared operation. No checks are made. As for shveu_start(),
+ * the VEU is held until completion is waited for with shveu_wait().
+ * \param veu_index Index of which VEU to use
+ * \param prep The prepared operation
+ */
+void
+shveu_prepared_start(unsigned int veu_index, const struct shveu_prepared *prep);
+
+/** Perform a prepared operation and wait for it to complete. No checks are
+ * made.
+ * \param veu_index Index of which VEU to use
+ * \param prep The prepared operation
+ */
+void
+shveu_prepared_operation(unsigned int veu_index, const struct shveu_prepared *prep);
+
+#endif				/* __VEU_PREPARED_H__ */
@@ -0,0 +1,119 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Image pyramid generation: successive 1/2 scale copies of an image
+ */
+
+#ifndef __VEU_PYRAMID_H__
+#define __VEU_PYRAMID_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** Maximum number of levels in an image pyramid */
+#define SHVEU_PYRAMID_MAX_LEVELS 8
+
+/** One level of an image pyramid */
+struct shveu_pyramid_level {
+	unsigned long py;	/**< Physical address of Y or RGB plane */
+	unsigned long pc;	/**< Physical address of CbCr plane (0 for RGB) */
+	unsigned long width;	/**< Width in pixels */
+	unsigned long height;	/**< Height in pixels */
+	unsigned long pitch;	/**< Line pitch in pixels */
+};
+
+/** An image pyramid laid out in a single caller-supplied buffer pool.
+ * Level 0 is half the size of the source image, and each following level
+ * is half the size of the level before it. Levels are laid out with
+ * SHVEU_ALIGN_DEFAULT, relative to the start of the pool, which should
+ * itself be page aligned.
+ */
+struct shveu_pyramid {
+	shveu_format_t format;	/**< Format of all levels */
+	int nr_levels;		/**< Number of usable levels */
+	unsigned long pool_py;	/**< Physical address of the buffer pool */
+	unsigned long pool_size;/**< Size in bytes used within the pool */
+	struct shveu_pyramid_level level[SHVEU_PYRAMID_MAX_LEVELS];
+};
+
+/** Calculate the size of buffer pool required for an image pyramid
+ * \param src_width Width in pixels of source image
+ * \param src_height Height in pixels of source image
+ * \param format Format of the pyramid levels
+ * \param nr_levels Number of levels requested
+ * \retval >0 Size in bytes of the buffer pool
+ * \retval -1 Error: Invalid format or geometry
+ */
+long
+shveu_pyramid_size(
+	unsigned long src_width,
+	unsigned long src_height,
+	shveu_format_t format,
+	int nr_levels);
+
+/** Lay out an image pyramid within a buffer pool. The layout only depends
+ * on the source geometry, so a pyramid can be initialised once and reused
+ * for every frame of a stream.
+ * The number of levels is reduced if a level would become too small to be
+ * used as the source of the next one (the VEU requires at least 16x16).
+ * \param pyr The pyramid to initialise
+ * \param pool_py Physical address of the buffer pool
+ * \param pool_size Size in bytes of the buffer pool
+ * \param src_width Width in pixels of source image
+ * \param src_height Height in pixels of source image
+ * \param format Format of the pyramid levels
+ * \param nr_levels Number of levels requested
+ * \retval >0 Number of levels laid out
+ * \retval -1 Error: Invalid format or geometry, or pool too small
+ */
+int
+shveu_pyramid_init(
+	struct shveu_pyramid *pyr,
+	unsigned long pool_py,
+	unsigned long pool_size,
+	unsigned long src_width,
+	unsigned long src_height,
+	shveu_format_t format,
+	int nr_levels);
+
+/** Generate all levels of an image pyramid. Level 0 is scaled from the
+ * source image, and each following level is scaled from the previous level.
+ * \param veu_index Index of which VEU to use
+ * \param pyr A pyramid initialised with shveu_pyramid_init()
+ * \param src_py Physical address of Y or RGB plane of source image
+ * \param src_pc Physical address of CbCr plane of source image (ignored for RGB)
+ * \param src_width Width in pixels of source image
+ * \param src_height Height in pixels of source image
+ * \param src_pitch Line pitch of source image
+ * \param src_fmt Format of source image
+ * \retval 0 Success
+ * \retval -1 Error: Source does not match the pyramid, or VEU error
+ */
+int
+shveu_pyramid_generate(
+	unsigned int veu_index,
+	const struct shveu_pyramid *pyr,
+	unsigned long src_py,
+	unsigned long src_pc,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt);
+
+#endif				/* __VEU_PYRAMID_H__ */
@@ -0,0 +1,79 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Prioritised, deadline ordered submission of VEU operations
+ */
+
+#ifndef __VEU_QUEUE_H__
+#define __VEU_QUEUE_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** Priority classes */
+typedef enum {
+	SHVEU_PRIORITY_REALTIME=0,	/**< Latency critical, eg. display */
+	SHVEU_PRIORITY_NORMAL,		/**< Default */
+	SHVEU_PRIORITY_BACKGROUND,	/**< Batch work, eg. thumbnails, analytics */
+} shveu_priority_t;
+
+/** Number of priority classes */
+#define SHVEU_NR_PRIORITIES 3
+
+/** Queue statistics */
+struct shveu_queue_stats {
+	unsigned long completed[SHVEU_NR_PRIORITIES];	/**< Operations completed per class */
+	unsigned long missed[SHVEU_NR_PRIORITIES];	/**< Operations completed after their deadline */
+	unsigned long promoted;				/**< Operations promoted after waiting too long */
+};
+
+/** Submit an operation to a VEU and wait for it to complete.
+ * While the VEU is busy, waiting operations are ordered by priority class,
+ * then by earliest deadline. Operations that have waited too long are
+ * promoted to the next class, so background work is never starved.
+ * Every operation this process starts on the VEU waits in the same
+ * queue: those of shveu_operation(), shveu_start(), the prepared
+ * operations, and the functions built on them such as
+ * shveu_sched_operation(), the submission rings, the broker, the
+ * pyramid, dirty rectangle and framebuffer conversions. These wait at
+ * SHVEU_PRIORITY_NORMAL without a deadline. Other processes are not
+ * arbitrated; see shveu_broker_open() for sharing the VEU between them.
+ * \param veu_index Index of which VEU to use
+ * \param op The operation to perform
+ * \param priority Priority class of the operation
+ * \param deadline_us Time in microseconds from now by which the operation
+ * should be complete, or 0 for no deadline
+ * \retval 0 Success
+ * \retval -1 Error: Invalid operation
+ */
+int
+shveu_submit(
+	unsigned int veu_index,
+	const struct shveu_op *op,
+	shveu_priority_t priority,
+	unsigned long deadline_us);
+
+/** Get queue statistics
+ * \param veu_index Index of which VEU to use
+ * \param stats Filled with the current statistics
+ */
+void
+shveu_queue_get_stats(unsigned int veu_index, struct shveu_queue_stats *stats);
+
+#endif				/* __VEU_QUEUE_H__ */
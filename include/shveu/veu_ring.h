@@ -0,0 +1,114 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Non-blocking submission rings drained by a VEU dispatcher thread
+ *
+ * Each producer thread creates its own ring. A ring is a pair of
+ * single-producer/single-consumer queues: operations flow to the dispatcher
+ * thread, and results flow back. Submitting and collecting results never
+ * block, and only enter the kernel to wake the dispatcher when it is idle.
+ *
+ * An event loop can wait for results on many rings, along with its other
+ * file descriptors, using shveu_ring_fd(). This lets a single thread keep
+ * many operations in flight without blocking in shveu_wait(). A simulated
+ * VEU can be passed to shveu_dispatcher_start() for testing.
+ */
+
+#ifndef __VEU_RING_H__
+#define __VEU_RING_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** Opaque dispatcher handle */
+struct shveu_dispatcher;
+
+/** Opaque ring handle */
+struct shveu_ring;
+
+/** Maximum number of rings served by one dispatcher */
+#define SHVEU_MAX_RINGS 16
+
+/** Start a dispatcher thread
+ * \param veu_index Index of which VEU to dispatch operations to
+ * \param exec Function performing each operation, or NULL to perform it on
+ * the VEU. Pass a simulated VEU here to run without hardware.
+ * \param arg Argument passed to \a exec
+ * \returns A dispatcher handle, or NULL on error
+ */
+struct shveu_dispatcher *
+shveu_dispatcher_start(unsigned int veu_index, shveu_exec_t exec, void *arg);
+
+/** Stop a dispatcher thread. All rings must have been destroyed.
+ * \param dispatcher The dispatcher
+ */
+void
+shveu_dispatcher_stop(struct shveu_dispatcher *dispatcher);
+
+/** Create a ring served by a dispatcher. Each ring must only be used by
+ * one thread.
+ * \param dispatcher The dispatcher
+ * \param size Maximum number of operations in flight (rounded up to a
+ * power of 2)
+ * \returns A ring handle, or NULL on error
+ */
+struct shveu_ring *
+shveu_ring_create(struct shveu_dispatcher *dispatcher, unsigned int size);
+
+/** Destroy a ring. Operations still in flight are completed first.
+ * \param ring The ring
+ */
+void
+shveu_ring_destroy(struct shveu_ring *ring);
+
+/** Queue an operation. Never blocks.
+ * \param ring The ring
+ * \param op The operation to perform
+ * \param cookie Value returned with the result by shveu_ring_reap()
+ * \retval 0 Success
+ * \retval -1 Error: The ring is full; reap some results first
+ */
+int
+shveu_ring_submit(struct shveu_ring *ring, const struct shveu_op *op,
+		  void *cookie);
+
+/** Collect the result of a completed operation. Never blocks.
+ * Results are returned in order of submission.
+ * \param ring The ring
+ * \param cookie Set to the cookie given to shveu_ring_submit()
+ * \param result Set to the result of the operation (0 for success)
+ * \retval 1 A result was collected
+ * \retval 0 No operation has completed
+ */
+int
+shveu_ring_reap(struct shveu_ring *ring, void **cookie, int *result);
+
+/** Get a file descriptor that is readable whenever results are ready to
+ * be reaped, for use with poll(), select() or epoll. It is emptied by
+ * shveu_ring_reap() when there are no more results, so after it becomes
+ * readable, reap until shveu_ring_reap() returns 0. Once this has been
+ * called, completing each operation costs a system call. The descriptor is
+ * closed by shveu_ring_destroy().
+ * \param ring The ring
+ * \returns A file descriptor, or -1 on error
+ */
+int
+shveu_ring_fd(struct shveu_ring *ring);
+
+#endif				/* __VEU_RING_H__ */
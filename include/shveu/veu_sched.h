@@ -0,0 +1,82 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Scheduling of operations between the VEU and the CPU
+ */
+
+#ifndef __VEU_SCHED_H__
+#define __VEU_SCHED_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** Scheduling policy */
+typedef enum {
+	SHVEU_SCHED_PREFER_HW=0,	/**< Use the CPU only if it is expected to finish much sooner (default) */
+	SHVEU_SCHED_LATENCY,		/**< Use whichever is expected to finish first */
+	SHVEU_SCHED_HW_ONLY,		/**< Always use the VEU */
+	SHVEU_SCHED_CPU_ONLY,		/**< Always use the CPU */
+} shveu_sched_policy_t;
+
+/** Scheduler statistics */
+struct shveu_sched_stats {
+	unsigned long hw_ops;		/**< Operations performed by the VEU */
+	unsigned long cpu_ops;		/**< Operations performed by the CPU */
+	unsigned long hw_setup_us;	/**< Estimated VEU fixed cost per operation (us) */
+	unsigned long hw_ns_per_pixel;	/**< Estimated VEU cost per output pixel (ns) */
+	unsigned long cpu_setup_us;	/**< Estimated CPU fixed cost per operation on cached images (us) */
+	unsigned long cpu_ns_per_pixel;	/**< Estimated CPU cost per output pixel of cached images (ns) */
+	unsigned long cpu_uncached_setup_us;	/**< As cpu_setup_us, for images in uncached VEU memory */
+	unsigned long cpu_uncached_ns_per_pixel;	/**< As cpu_ns_per_pixel, for images in uncached VEU memory */
+};
+
+/** Set the scheduling policy used by shveu_sched_operation()
+ * \param veu_index Index of which VEU to use
+ * \param policy Scheduling policy
+ */
+void
+shveu_sched_set_policy(unsigned int veu_index, shveu_sched_policy_t policy);
+
+/** Perform an operation on either the VEU or the CPU, whichever is
+ * expected to complete it first according to the scheduling policy.
+ * Completion time on the VEU is estimated from the operations already
+ * waiting for it and a size based cost model learned from measured
+ * completions, with separate CPU models for images in cached ranges (see
+ * shveu_cache_register()) and in the uncached VEU memory mapping. The
+ * path not chosen is still given an occasional operation, so that its
+ * model stays current. The CPU is only used if both images are in the
+ * VEU memory region or in cached ranges. Operations the VEU cannot perform (such as images smaller than
+ * 16x16) are performed on the CPU.
+ * This function may be called from several threads at once.
+ * \param veu_index Index of which VEU to use
+ * \param op The operation to perform
+ * \retval 0 Success
+ * \retval -1 Error: Invalid operation
+ */
+int
+shveu_sched_operation(unsigned int veu_index, const struct shveu_op *op);
+
+/** Get scheduler statistics
+ * \param veu_index Index of which VEU to use
+ * \param stats Filled with the current statistics
+ */
+void
+shveu_sched_get_stats(unsigned int veu_index, struct shveu_sched_stats *stats);
+
+#endif				/* __VEU_SCHED_H__ */
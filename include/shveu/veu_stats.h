@@ -0,0 +1,115 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Image statistics, such as for auto-exposure or scene change detection
+ *
+ * When a conversion is performed on the CPU, the statistics of the output
+ * are gathered a line at a time as it is written, while the line is still
+ * in the cache. When the VEU performs the conversion, the output is read
+ * afterwards; sampling every \a step pixels of every \a step lines makes
+ * this pass correspondingly cheaper.
+ */
+
+#ifndef __VEU_STATS_H__
+#define __VEU_STATS_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** Number of blocks across and down the image in shveu_stats.blocks */
+#define SHVEU_STATS_GRID 8
+
+/** Statistics of an image. Channels are Y, Cb, Cr, or R, G, B for RGB
+ * formats. For RGB, luma is taken as 0.299 R + 0.587 G + 0.114 B. */
+struct shveu_stats {
+	unsigned long samples;			/**< Number of pixels sampled */
+	unsigned long histogram[256];		/**< Luma histogram */
+	unsigned char min[3];			/**< Minimum of each channel */
+	unsigned char max[3];			/**< Maximum of each channel */
+	unsigned char mean[3];			/**< Mean of each channel, rounded */
+	unsigned char blocks[SHVEU_STATS_GRID][SHVEU_STATS_GRID];
+						/**< Mean luma of each block, by row then column */
+};
+
+/** Gather the statistics of an image
+ * \param py Y or RGB plane
+ * \param pc CbCr plane (ignored for single plane formats)
+ * \param width Width in pixels
+ * \param height Height in pixels
+ * \param pitch Line pitch
+ * \param fmt Format
+ * \param step Sample every \a step pixels of every \a step lines (1 for all)
+ * \param stats Filled with the statistics
+ * \retval 0 Success
+ * \retval -1 Error: Unsupported format or size
+ */
+int
+shveu_stats_surface(
+	const void *py,
+	const void *pc,
+	unsigned long width,
+	unsigned long height,
+	unsigned long pitch,
+	shveu_format_t fmt,
+	unsigned int step,
+	struct shveu_stats *stats);
+
+/** Perform an operation on the CPU as shveu_cpu_operation(), and gather
+ * the statistics of every pixel of the destination image as it is written.
+ * \param stats Filled with the statistics of the destination image
+ * \retval 0 Success
+ * \retval -1 Error: Unsupported operation
+ */
+int
+shveu_cpu_operation_stats(
+	const void *src_y,
+	const void *src_c,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	void *dst_y,
+	void *dst_c,
+	unsigned long dst_width,
+	unsigned long dst_height,
+	unsigned long dst_pitch,
+	shveu_format_t dst_fmt,
+	shveu_rotation_t rotate,
+	struct shveu_stats *stats);
+
+/** Perform an operation as shveu_sched_operation(), and gather the
+ * statistics of the destination image. If the CPU performs the operation
+ * every pixel is counted, as by shveu_cpu_operation_stats(); otherwise
+ * the destination is sampled as by shveu_stats_surface(). The destination
+ * must be within the VEU memory region.
+ * \param veu_index Index of which VEU to use
+ * \param op The operation to perform
+ * \param step Sampling step used if the VEU performs the operation
+ * \param stats Filled with the statistics of the destination image
+ * \retval 0 Success
+ * \retval -1 Error: Invalid operation
+ */
+int
+shveu_sched_operation_stats(
+	unsigned int veu_index,
+	const struct shveu_op *op,
+	unsigned int step,
+	struct shveu_stats *stats);
+
+#endif				/* __VEU_STATS_H__ */
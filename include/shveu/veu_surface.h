@@ -0,0 +1,100 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/** \file
+ * Layout of image buffers: line pitch, plane offsets and alignment
+ *
+ * Raw image files hold tightly packed frames, but a buffer whose lines
+ * and planes start on cache line boundaries is transferred by the VEU in
+ * whole bursts and read by the CPU a whole cache line at a time. The
+ * functions here describe the layout of a buffer according to a policy,
+ * for allocating buffers and passing them to the conversion functions.
+ */
+
+#ifndef __VEU_SURFACE_H__
+#define __VEU_SURFACE_H__
+
+#include <shveu/veu_colorspace.h>
+
+/** Alignment in bytes of lines and planes with SHVEU_ALIGN_LINES. This is
+ * both the cache line size and the VEU burst size. */
+#define SHVEU_LINE_ALIGN 32
+
+/** Alignment in bytes of large planes with SHVEU_ALIGN_PAGES */
+#define SHVEU_PAGE_ALIGN 4096
+
+/** Size in bytes from which a plane counts as large */
+#define SHVEU_LARGE_PLANE (64 * 1024)
+
+/** Layout policy: no padding, as in raw image files */
+#define SHVEU_ALIGN_PACKED 0
+
+/** Layout policy: lines and planes start on SHVEU_LINE_ALIGN boundaries */
+#define SHVEU_ALIGN_LINES (1 << 0)
+
+/** Layout policy: large planes start on SHVEU_PAGE_ALIGN boundaries */
+#define SHVEU_ALIGN_PAGES (1 << 1)
+
+/** Layout policy suitable for most buffers */
+#define SHVEU_ALIGN_DEFAULT (SHVEU_ALIGN_LINES | SHVEU_ALIGN_PAGES)
+
+/** Layout of an image in a buffer. Offsets are in bytes from the start of
+ * the buffer; the Y or RGB plane is at the start. */
+struct shveu_surface {
+	shveu_format_t format;	/**< Format */
+	unsigned long width;	/**< Width in pixels */
+	unsigned long height;	/**< Height in pixels */
+	unsigned long pitch;	/**< Line pitch in pixels, as passed to the conversion functions */
+	unsigned long y_line;	/**< Bytes of image data in each line of the Y or RGB plane */
+	unsigned long y_stride;	/**< Bytes from one line of the Y or RGB plane to the next */
+	unsigned long c_offset;	/**< Offset of the CbCr plane (0 if none) */
+	unsigned long c_line;	/**< Bytes of image data in each line of the CbCr plane */
+	unsigned long c_stride;	/**< Bytes from one line of the CbCr plane to the next */
+	unsigned long c_lines;	/**< Number of lines in the CbCr plane */
+	unsigned long size;	/**< Size in bytes of the buffer */
+	unsigned long align;	/**< Alignment in bytes required of the start of the buffer */
+};
+
+/** Describe the layout of an image buffer
+ * \param s The surface to initialise
+ * \param format Format of the image
+ * \param width Width in pixels
+ * \param height Height in pixels
+ * \param policy Layout policy, eg. SHVEU_ALIGN_DEFAULT
+ * \retval 0 Success
+ * \retval -1 Error: Unsupported format or policy
+ */
+int
+shveu_surface_init(
+	struct shveu_surface *s,
+	shveu_format_t format,
+	unsigned long width,
+	unsigned long height,
+	int policy);
+
+/** Check whether a surface is laid out without padding, so that it can be
+ * transferred to or from a raw image file in one piece
+ * \param s The surface
+ * \retval 1 The surface is packed
+ * \retval 0 The surface has padding
+ */
+int
+shveu_surface_is_packed(const struct shveu_surface *s);
+
+#endif				/* __VEU_SURFACE_H__ */
@@ -7,7 +7,20 @@ LOCAL_C_INCLUDES := \
 #LOCAL_CFLAGS := -DDEBUG
 
 LOCAL_SRC_FILES := \
-	veu_colorspace.c
+	veu_colorspace.c \
+	veu_pyramid.c \
+	veu_dirty.c \
+	veu_dedup.c \
+	veu_cpu.c \
+	veu_sched.c \
+	veu_queue.c \
+	veu_broker.c \
+	veu_ring.c \
+	veu_fb.c \
+	veu_overlay.c \
+	veu_stats.c \
+	veu_surface.c \
+	veu_cache.c
 
 LOCAL_SHARED_LIBRARIES := libcutils
 
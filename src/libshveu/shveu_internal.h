@@ -0,0 +1,208 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Functions shared between the libshveu source files.
+ * None of these are exported from the shared library.
+ */
+
+#ifndef __SHVEU_INTERNAL_H__
+#define __SHVEU_INTERNAL_H__
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_stats.h"
+#include "shveu/veu_surface.h"
+
+/* veu_colorspace.c */
+
+struct sh_veu_uio_device {
+	char *name;
+	char *path;
+	int fd;
+	dev_t rdev;
+};
+
+struct uio_map {
+	unsigned long address;
+	unsigned long size;
+	void *iomem;
+};
+
+/* The VEU found by shveu_open(): its UIO device, registers and memory.
+ * The tests fill these in to stand in for a VEU. */
+extern struct sh_veu_uio_device sh_veu_uio_dev;
+extern struct uio_map sh_veu_uio_mmio, sh_veu_uio_mem;
+
+/* Map a physical address range within the VEU memory region, or within a
+ * registered cached range, to a virtual address. Returns NULL if the range
+ * is not inside either. */
+void *sh_veu_phys_to_virt(unsigned long phys, unsigned long len);
+
+/* Calculate the size in bytes of the Y/RGB and CbCr planes of an image
+ * with the given line pitch (in pixels) and height */
+int sh_veu_plane_sizes(shveu_format_t format, unsigned long pitch,
+		       unsigned long height, unsigned long *y_size,
+		       unsigned long *c_size);
+
+/* Check an operation against the VEU restrictions without starting it.
+ * Returns 0 if the VEU can perform op, -1 otherwise. */
+int sh_veu_check_op(const struct shveu_op *op);
+
+/* Perform op, waiting for the VEU with the given priority class and
+ * absolute deadline in us (0 for none) as for sh_veu_acquire() */
+int sh_veu_operation(unsigned int veu_index, const struct shveu_op *op,
+		     int priority, double deadline);
+
+/* veu_surface.c */
+
+/* Describe the layout of an image with the given line pitch (in pixels),
+ * with the CbCr plane straight after the Y plane */
+int sh_veu_surface_pitch(struct shveu_surface *s, shveu_format_t format,
+			 unsigned long width, unsigned long height,
+			 unsigned long pitch);
+
+/* veu_cache.c */
+
+/* Perform cache maintenance before the VEU starts op, and remember op
+ * until sh_veu_cache_done() is called once the VEU has finished */
+void sh_veu_cache_start(const struct shveu_op *op);
+void sh_veu_cache_done(void);
+
+/* Return the cached mapping of a physical address range, or NULL if it is
+ * not within a registered cached range */
+void *sh_veu_cache_virt(unsigned long phys, unsigned long len);
+
+/* veu_stats.c */
+
+/* Statistics being gathered a line at a time */
+struct sh_veu_stats_acc {
+	struct shveu_stats *stats;
+	unsigned long width, height, step;
+	uint64_t sum[3];
+	unsigned long block_sum[SHVEU_STATS_GRID][SHVEU_STATS_GRID];
+	unsigned long block_samples[SHVEU_STATS_GRID][SHVEU_STATS_GRID];
+};
+
+/* Start gathering the statistics of an image. Returns -1 if the size or
+ * step is invalid. */
+int sh_veu_stats_begin(struct sh_veu_stats_acc *acc, struct shveu_stats *stats,
+		       unsigned long width, unsigned long height,
+		       unsigned int step);
+
+/* Add line y of an image; lines not on the sampling step are ignored */
+void sh_veu_stats_row(struct sh_veu_stats_acc *acc, const unsigned char *py,
+		      const unsigned char *pc, unsigned long pitch,
+		      shveu_format_t fmt, unsigned long y);
+
+/* Work out the means once all lines have been added */
+void sh_veu_stats_end(struct sh_veu_stats_acc *acc);
+
+/* veu_cpu.c */
+
+struct shveu_layer;
+
+/* Perform op on the CPU with the planes at the given virtual addresses,
+ * blending layers onto each line of the destination as soon as it is
+ * written, and gathering the statistics of the result if stats is set */
+int sh_veu_cpu_operation(const struct shveu_op *op, const void *src_y,
+			 const void *src_c, void *dst_y, void *dst_c,
+			 const struct shveu_layer *layers, int nr_layers,
+			 struct shveu_stats *stats);
+
+/* veu_overlay.c */
+
+/* Blend layers onto line y of an RGB565 surface, byte-swapped if swap is
+ * set */
+void sh_veu_blend_line(void *dst, unsigned long width, unsigned long pitch,
+		       int swap, const struct shveu_layer *layers,
+		       int nr_layers, unsigned long y);
+
+/* veu_dedup.c */
+
+/* Returns 1 if op would reproduce the output of the previous operation,
+ * which is then skipped. Otherwise remembers op, returns 0 and the caller
+ * must report the outcome with sh_veu_dedup_done(). Every operation
+ * started on the VEU must be reported with sh_veu_dedup_started(). */
+int sh_veu_dedup_skip(unsigned int veu_index, const struct shveu_op *op);
+void sh_veu_dedup_started(unsigned int veu_index);
+void sh_veu_dedup_done(unsigned int veu_index, int ret);
+
+/* veu_sched.c */
+
+/* The path chosen for an operation */
+struct sh_veu_route {
+	double pixels;		/* output pixels, set by the caller */
+	int cached;		/* images are in cached ranges, set by the caller */
+	int cpu;		/* 1 to use the CPU, 0 for the VEU */
+	double estimate;	/* predicted time in us */
+};
+
+/* Choose the path for an operation that the VEU (if hw_ok) and the CPU (if
+ * cpu_ok) can perform. An operation given to the VEU counts towards its
+ * backlog until its completion is reported with sh_veu_sched_done(), which
+ * must follow every sh_veu_sched_route(). ret is the result of the
+ * operation; only successful operations are measured. */
+void sh_veu_sched_route(unsigned int veu_index, int hw_ok, int cpu_ok,
+			struct sh_veu_route *route);
+void sh_veu_sched_done(unsigned int veu_index, const struct sh_veu_route *route,
+		       double elapsed, int ret);
+
+/* Perform op as shveu_sched_operation(), then blend layers onto its RGB565
+ * destination. On the CPU each line is blended as it is converted. */
+int sh_veu_sched_composite(unsigned int veu_index, const struct shveu_op *op,
+			   const struct shveu_layer *layers, int nr_layers);
+
+/* veu_queue.c */
+
+/* Current time in microseconds */
+double sh_veu_now_us(void);
+
+/* Wait for exclusive use of the VEU by this thread, ordered against other
+ * waiting threads by priority class and absolute deadline (0 for none).
+ * Every sh_veu_acquire() must be followed by sh_veu_release(). Every
+ * operation started on the VEU is performed between the two. */
+void sh_veu_acquire(unsigned int veu_index, int priority, double deadline);
+void sh_veu_release(unsigned int veu_index);
+
+/* shveu_exec_t performing op on the VEU at normal priority.
+ * arg points to an unsigned int holding the VEU index. */
+int sh_veu_exec(void *arg, const struct shveu_op *op);
+
+/* veu_broker.c */
+
+/* Futex operations, usable on shared mappings */
+int sh_veu_futex_wait(volatile uint32_t *addr, uint32_t val, int timeout_ms);
+int sh_veu_futex_wake(volatile uint32_t *addr, int nr);
+
+/* veu_fb.c */
+
+struct shveu_fb;
+struct fb_fix_screeninfo;
+struct fb_var_screeninfo;
+
+/* Describe the framebuffer memory in fb, for double buffering if flip is
+ * set and the virtual resolution and memory allow it. Returns -1 unless
+ * the framebuffer is RGB565. */
+int sh_veu_fb_setup(struct shveu_fb *fb, const struct fb_fix_screeninfo *fix,
+		    const struct fb_var_screeninfo *var, int flip);
+
+#endif /* __SHVEU_INTERNAL_H__ */
@@ -0,0 +1,160 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Access to single pixels of an image in any format, for the CPU paths.
+ * The functions are always inlined so that, called with a constant
+ * format, the format switch disappears from the caller's loop.
+ */
+
+#ifndef __SHVEU_PIXEL_H__
+#define __SHVEU_PIXEL_H__
+
+#include <inttypes.h>
+
+#include "shveu/veu_colorspace.h"
+
+struct pixel {
+	int y, cb, cr;		/* YCbCr, or R, G, B for RGB formats */
+};
+
+#define ALWAYS_INLINE inline __attribute__ ((always_inline))
+
+static ALWAYS_INLINE void get_pixel(const unsigned char *py, const unsigned char *pc,
+				    unsigned long pitch, shveu_format_t fmt,
+				    unsigned long x, unsigned long y, struct pixel *p)
+{
+	const unsigned char *c;
+	uint16_t v;
+
+	switch (fmt) {
+	case SHVEU_RGB565:
+	case SHVEU_RGB565_BE:
+		v = ((const uint16_t *)py)[y * pitch + x];
+		if (fmt == SHVEU_RGB565_BE)
+			v = (v << 8) | (v >> 8);
+		p->y  = ((v >> 11) & 0x1f) << 3;
+		p->cb = ((v >> 5) & 0x3f) << 2;
+		p->cr = (v & 0x1f) << 3;
+		break;
+	case SHVEU_YCbCr420:
+		p->y = py[y * pitch + x];
+		c = pc + (y / 2) * pitch + (x & ~1UL);
+		p->cb = c[0];
+		p->cr = c[1];
+		break;
+	case SHVEU_YCrCb420:
+		p->y = py[y * pitch + x];
+		c = pc + (y / 2) * pitch + (x & ~1UL);
+		p->cr = c[0];
+		p->cb = c[1];
+		break;
+	case SHVEU_YCbCr422:
+		p->y = py[y * pitch + x];
+		c = pc + y * pitch + (x & ~1UL);
+		p->cb = c[0];
+		p->cr = c[1];
+		break;
+	case SHVEU_YUYV:
+		c = py + (y * pitch + (x & ~1UL)) * 2;
+		p->y = c[(x & 1) * 2];
+		p->cb = c[1];
+		p->cr = c[3];
+		break;
+	case SHVEU_UYVY:
+		c = py + (y * pitch + (x & ~1UL)) * 2;
+		p->y = c[(x & 1) * 2 + 1];
+		p->cb = c[0];
+		p->cr = c[2];
+		break;
+	case SHVEU_YCbCr444:
+		p->y = py[y * pitch + x];
+		c = pc + (y * pitch + x) * 2;
+		p->cb = c[0];
+		p->cr = c[1];
+		break;
+	}
+}
+
+static ALWAYS_INLINE void put_pixel(unsigned char *py, unsigned char *pc,
+				    unsigned long pitch, shveu_format_t fmt,
+				    unsigned long x, unsigned long y, const struct pixel *p)
+{
+	unsigned char *c;
+
+	uint16_t v;
+
+	switch (fmt) {
+	case SHVEU_RGB565:
+	case SHVEU_RGB565_BE:
+		v = ((p->y >> 3) << 11) | ((p->cb >> 2) << 5) | (p->cr >> 3);
+		if (fmt == SHVEU_RGB565_BE)
+			v = (v << 8) | (v >> 8);
+		((uint16_t *)py)[y * pitch + x] = v;
+		break;
+	case SHVEU_YCbCr420:
+		py[y * pitch + x] = p->y;
+		if ((x & 1) || (y & 1))
+			break;
+		c = pc + (y / 2) * pitch + x;
+		c[0] = p->cb;
+		c[1] = p->cr;
+		break;
+	case SHVEU_YCrCb420:
+		py[y * pitch + x] = p->y;
+		if ((x & 1) || (y & 1))
+			break;
+		c = pc + (y / 2) * pitch + x;
+		c[0] = p->cr;
+		c[1] = p->cb;
+		break;
+	case SHVEU_YCbCr422:
+		py[y * pitch + x] = p->y;
+		if (x & 1)
+			break;
+		c = pc + y * pitch + x;
+		c[0] = p->cb;
+		c[1] = p->cr;
+		break;
+	case SHVEU_YUYV:
+		c = py + (y * pitch + (x & ~1UL)) * 2;
+		c[(x & 1) * 2] = p->y;
+		if (x & 1)
+			break;
+		c[1] = p->cb;
+		c[3] = p->cr;
+		break;
+	case SHVEU_UYVY:
+		c = py + (y * pitch + (x & ~1UL)) * 2;
+		c[(x & 1) * 2 + 1] = p->y;
+		if (x & 1)
+			break;
+		c[0] = p->cb;
+		c[2] = p->cr;
+		break;
+	case SHVEU_YCbCr444:
+		py[y * pitch + x] = p->y;
+		c = pc + (y * pitch + x) * 2;
+		c[0] = p->cb;
+		c[1] = p->cr;
+		break;
+	}
+}
+
+#endif /* __SHVEU_PIXEL_H__ */
@@ -21,9 +21,9 @@
 #define __SHVEU_REGS_H__
 
 #define YCBCR_COMP_RANGE (0 << 16)
-#define YCBCR_FULL_RANGE (1 << 16)
+#define YCBCR_FULL_RANGE SHVEU_FULL_RANGE
 #define YCBCR_BT601      (0 << 17)
-#define YCBCR_BT709      (1 << 17)
+#define YCBCR_BT709      SHVEU_BT709
 
 #define SH_VEU_RESERVE_TOP (512 << 10)
 #define YUV_COLOR
@@ -0,0 +1,500 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Cross-process VEU broker
+ *
+ * The shared region holds a table of job slots. A client claims a free
+ * slot, fills in the operation, takes a ticket from a shared counter and
+ * marks the slot queued. The broker performs the queued job with the
+ * oldest ticket first, so jobs are performed in order of submission
+ * without locks. Nothing but the slot records a job, so a client dying
+ * at any point cannot hold up the jobs of others.
+ *
+ * Slot states change FREE -> CLAIMED -> QUEUED -> DONE -> FREE. The broker
+ * sleeps on the work counter and clients sleep on their slot state, both
+ * with futexes on the shared mapping.
+ *
+ * A slot is owned by the process that claimed it, whose pid is recorded
+ * in the slot; a slot without an owner is free. When idle, the broker
+ * frees the slots of clients that died holding them, unless their job
+ * is still queued. Clients give up if the broker dies.
+ *
+ * Clients can write to the shared region at any time, so the broker
+ * checks and performs a copy of each operation, and only trusts slot
+ * indices it computed itself.
+ *
+ * The backing file is locked by the broker for its lifetime, so that a
+ * second broker cannot take over the queue of a running one.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <time.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_broker.h"
+
+#include "shveu_internal.h"
+
+#define BROKER_MAGIC   0x53485645	/* "SHVE" */
+#define BROKER_VERSION 3
+#define BROKER_SLOTS   64		/* power of 2 */
+
+/* How long a client waits for a free slot */
+#define CLAIM_TIMEOUT_MS 1000
+
+#define SLOT_FREE    0
+#define SLOT_CLAIMED 1
+#define SLOT_QUEUED  2
+#define SLOT_DONE    3
+
+struct broker_slot {
+	volatile int32_t owner;		/* pid of the client, or 0 if free */
+	volatile uint32_t state;
+	uint32_t ticket;		/* order of submission */
+	int32_t result;
+	struct shveu_op op;
+};
+
+struct broker_shm {
+	volatile uint32_t magic;
+	uint32_t version;
+	int32_t broker_pid;
+	volatile uint32_t next_ticket;	/* advanced by clients */
+	volatile uint32_t work;		/* futex: bumped for every job queued */
+	volatile uint32_t broker_waiting;
+	volatile uint32_t slot_hint;
+	struct broker_slot slot[BROKER_SLOTS];
+};
+
+struct shveu_broker {
+	char *path;
+	int fd;
+	struct broker_shm *shm;
+	unsigned int veu_index;
+	shveu_exec_t exec;
+	void *arg;
+};
+
+struct shveu_client {
+	int fd;
+	struct broker_shm *shm;
+};
+
+int sh_veu_futex_wait(volatile uint32_t *addr, uint32_t val, int timeout_ms)
+{
+	struct timespec ts, *tsp = NULL;
+
+	if (timeout_ms >= 0) {
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+		tsp = &ts;
+	}
+
+	return syscall(SYS_futex, addr, FUTEX_WAIT, val, tsp, NULL, 0);
+}
+
+int sh_veu_futex_wake(volatile uint32_t *addr, int nr)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAKE, nr, NULL, NULL, 0);
+}
+
+static struct broker_shm *map_shm(int fd)
+{
+	void *p;
+
+	p = mmap(0, sizeof(struct broker_shm), PROT_READ | PROT_WRITE,
+		 MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	return p;
+}
+
+/* Returns 1 if the process pid no longer exists */
+static int process_dead(pid_t pid)
+{
+	return (kill(pid, 0) < 0 && errno == ESRCH);
+}
+
+/* Returns the index of the queued job with the oldest ticket, or -1 if
+ * no job is queued */
+static int next_job(struct broker_shm *shm)
+{
+	uint32_t ticket = 0;
+	int i, idx = -1;
+
+	for (i = 0; i < BROKER_SLOTS; i++) {
+		if (shm->slot[i].state != SLOT_QUEUED)
+			continue;
+
+		if (idx < 0 || (int32_t)(shm->slot[i].ticket - ticket) < 0) {
+			idx = i;
+			ticket = shm->slot[i].ticket;
+		}
+	}
+
+	return idx;
+}
+
+struct shveu_broker *
+shveu_broker_open(
+	const char *path,
+	mode_t mode,
+	unsigned int veu_index,
+	shveu_exec_t exec,
+	void *arg)
+{
+	struct shveu_broker *broker;
+	struct broker_shm *shm;
+	int i;
+
+	broker = calloc(1, sizeof(*broker));
+	if (broker == NULL)
+		return NULL;
+
+	broker->fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW, mode);
+	if (broker->fd < 0)
+		goto err_free;
+
+	/* The file may be left over from a broker that died, but must not
+	 * belong to a running one */
+	if (flock(broker->fd, LOCK_EX | LOCK_NB) < 0)
+		goto err_close;
+
+	/* Fails unless we own a left over file */
+	if (fchmod(broker->fd, mode) < 0)
+		goto err_close;
+
+	if (ftruncate(broker->fd, sizeof(struct broker_shm)) < 0)
+		goto err_unlink;
+
+	shm = map_shm(broker->fd);
+	if (shm == NULL)
+		goto err_unlink;
+
+	/* Clients of a previous broker still mapping the file see the magic
+	 * cleared and give up */
+	memset(shm, 0, sizeof(*shm));
+	for (i = 0; i < BROKER_SLOTS; i++)
+		shm->slot[i].state = SLOT_FREE;
+	shm->version = BROKER_VERSION;
+	shm->broker_pid = getpid();
+	__sync_synchronize();
+	shm->magic = BROKER_MAGIC;
+
+	broker->path = strdup(path);
+	broker->shm = shm;
+	broker->veu_index = veu_index;
+	if (exec) {
+		broker->exec = exec;
+		broker->arg = arg;
+	} else {
+		broker->exec = sh_veu_exec;
+		broker->arg = &broker->veu_index;
+	}
+
+	return broker;
+
+err_unlink:
+	unlink(path);
+err_close:
+	close(broker->fd);
+err_free:
+	free(broker);
+	return NULL;
+}
+
+/* Returns 1 if the planes of an image lie within memory the VEU may
+ * access: its UIO memory region or a registered range */
+static int image_accessible(unsigned long py, unsigned long pc,
+			    unsigned long pitch, unsigned long height,
+			    shveu_format_t format)
+{
+	unsigned long y_size, c_size;
+
+	/* Plane sizes are at most 2 * pitch * height */
+	if (height == 0 || pitch > ULONG_MAX / 2 / height)
+		return 0;
+
+	if (sh_veu_plane_sizes(format, pitch, height, &y_size, &c_size) < 0)
+		return 0;
+
+	if (sh_veu_phys_to_virt(py, y_size) == NULL)
+		return 0;
+	if (c_size && sh_veu_phys_to_virt(pc, c_size) == NULL)
+		return 0;
+
+	return 1;
+}
+
+/* Jobs come from other processes, which must not be able to make the VEU
+ * read or write arbitrary memory. Without a VEU memory region (a
+ * simulated VEU), checking is left to the exec function. */
+static int op_accessible(const struct shveu_op *op)
+{
+	if (sh_veu_uio_mem.size == 0)
+		return 1;
+
+	return image_accessible(op->src_py, op->src_pc, op->src_pitch,
+				op->src_height, op->src_fmt) &&
+	       image_accessible(op->dst_py, op->dst_pc, op->dst_pitch,
+				op->dst_height, op->dst_fmt);
+}
+
+/* Free the slots of clients that have died. A slot whose job is queued
+ * is left until the job has been performed. */
+static void reclaim_slots(struct broker_shm *shm)
+{
+	struct broker_slot *slot;
+	int32_t owner;
+	int i;
+
+	for (i = 0; i < BROKER_SLOTS; i++) {
+		slot = &shm->slot[i];
+		owner = slot->owner;
+		if (owner == 0 || slot->state == SLOT_QUEUED)
+			continue;
+
+		if (!process_dead(owner))
+			continue;
+
+		/* Only this process touches the slot of a dead client */
+		slot->state = SLOT_FREE;
+		__sync_bool_compare_and_swap(&slot->owner, owner, 0);
+	}
+}
+
+int
+shveu_broker_dispatch(struct shveu_broker *broker, int timeout_ms)
+{
+	struct broker_shm *shm = broker->shm;
+	struct broker_slot *slot;
+	struct shveu_op op;
+	uint32_t work;
+	int idx, n = 0;
+
+	for (;;) {
+		idx = next_job(shm);
+
+		if (idx < 0) {
+			if (n > 0)
+				break;
+
+			reclaim_slots(shm);
+			if (timeout_ms == 0)
+				break;
+
+			/* Announce that we are about to sleep, then check
+			 * again so that a job queued meanwhile is not missed */
+			shm->broker_waiting = 1;
+			__sync_synchronize();
+			work = shm->work;
+			idx = next_job(shm);
+			if (idx < 0) {
+				sh_veu_futex_wait(&shm->work, work, timeout_ms);
+				shm->broker_waiting = 0;
+				idx = next_job(shm);
+				if (idx < 0) {
+					/* Possibly woken by a client
+					 * waiting for a slot */
+					reclaim_slots(shm);
+					break;
+				}
+			}
+			shm->broker_waiting = 0;
+		}
+
+		/* The client may still change the slot, so check and perform
+		 * a copy of the operation, read after the slot was seen
+		 * queued. The compiler barrier keeps later uses of the copy
+		 * from reading the slot again. */
+		slot = &shm->slot[idx];
+		__sync_synchronize();
+		op = slot->op;
+		__asm__ __volatile__("" ::: "memory");
+
+		if (op_accessible(&op))
+			slot->result = broker->exec(broker->arg, &op);
+		else
+			slot->result = -1;
+		__sync_synchronize();
+		slot->state = SLOT_DONE;
+		sh_veu_futex_wake(&slot->state, INT_MAX);
+		n++;
+	}
+
+	return n;
+}
+
+void
+shveu_broker_close(struct shveu_broker *broker)
+{
+	if (broker == NULL)
+		return;
+
+	broker->shm->magic = 0;
+	munmap(broker->shm, sizeof(struct broker_shm));
+	/* Remove the file while it is still locked */
+	unlink(broker->path);
+	close(broker->fd);
+	free(broker->path);
+	free(broker);
+}
+
+struct shveu_client *
+shveu_client_connect(const char *path)
+{
+	struct shveu_client *client;
+	struct stat st;
+
+	client = calloc(1, sizeof(*client));
+	if (client == NULL)
+		return NULL;
+
+	client->fd = open(path, O_RDWR);
+	if (client->fd < 0)
+		goto err_free;
+
+	if (fstat(client->fd, &st) < 0 ||
+	    st.st_size < (off_t)sizeof(struct broker_shm))
+		goto err_close;
+
+	client->shm = map_shm(client->fd);
+	if (client->shm == NULL)
+		goto err_close;
+
+	if (client->shm->magic != BROKER_MAGIC ||
+	    client->shm->version != BROKER_VERSION) {
+		munmap(client->shm, sizeof(struct broker_shm));
+		goto err_close;
+	}
+
+	return client;
+
+err_close:
+	close(client->fd);
+err_free:
+	free(client);
+	return NULL;
+}
+
+/* Returns 1 if the broker has closed the queue or died */
+static int broker_gone(struct broker_shm *shm)
+{
+	return (shm->magic != BROKER_MAGIC || process_dead(shm->broker_pid));
+}
+
+static void wake_broker(struct broker_shm *shm)
+{
+	__sync_fetch_and_add(&shm->work, 1);
+	if (shm->broker_waiting)
+		sh_veu_futex_wake(&shm->work, 1);
+}
+
+static int claim_slot(struct broker_shm *shm)
+{
+	uint32_t start, i, idx;
+	int32_t pid = getpid();
+	int ms;
+
+	for (ms = 0; ms < CLAIM_TIMEOUT_MS; ms++) {
+		start = __sync_fetch_and_add(&shm->slot_hint, 1);
+		for (i = 0; i < BROKER_SLOTS; i++) {
+			idx = (start + i) & (BROKER_SLOTS - 1);
+			if (__sync_bool_compare_and_swap(&shm->slot[idx].owner,
+							 0, pid)) {
+				shm->slot[idx].state = SLOT_CLAIMED;
+				return idx;
+			}
+		}
+
+		if (broker_gone(shm))
+			return -1;
+
+		/* All slots in use: let the broker catch up, and free the
+		 * slots of dead clients if it is idle */
+		if (ms % 100 == 0)
+			wake_broker(shm);
+		usleep(1000);
+	}
+
+	return -1;
+}
+
+int
+shveu_client_operation(struct shveu_client *client, const struct shveu_op *op)
+{
+	struct broker_shm *shm = client->shm;
+	struct broker_slot *slot;
+	int idx, ret;
+
+	idx = claim_slot(shm);
+	if (idx < 0)
+		return -1;
+
+	slot = &shm->slot[idx];
+	slot->op = *op;
+	slot->ticket = __sync_fetch_and_add(&shm->next_ticket, 1);
+	__sync_synchronize();
+	slot->state = SLOT_QUEUED;
+
+	wake_broker(shm);
+
+	while (slot->state != SLOT_DONE) {
+		if (broker_gone(shm))
+			return -1;
+		sh_veu_futex_wait(&slot->state, SLOT_QUEUED, 100);
+	}
+
+	__sync_synchronize();
+	ret = slot->result;
+	slot->state = SLOT_FREE;
+	__sync_synchronize();
+	slot->owner = 0;
+
+	return ret;
+}
+
+void
+shveu_client_disconnect(struct shveu_client *client)
+{
+	if (client == NULL)
+		return;
+
+	munmap(client->shm, sizeof(struct broker_shm));
+	close(client->fd);
+	free(client);
+}
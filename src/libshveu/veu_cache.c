@@ -0,0 +1,255 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_surface.h"
+#include "shveu/veu_cache.h"
+
+#include "shveu_internal.h"
+
+/* Planes at least this many times wider in memory than in image data are
+ * maintained a line at a time, rather than as one range */
+#define LINE_BY_LINE 2
+
+struct cached_range {
+	void *virt;
+	unsigned long phys;
+	unsigned long len;
+};
+
+static struct cached_range ranges[SHVEU_MAX_CACHED_RANGES];
+static int nr_ranges;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The operation in progress on the VEU, if it touches cached memory */
+static struct shveu_op current_op;
+static int current_cached;
+
+#if defined(__sh__) && defined(__NR_cacheflush)
+
+/* From <asm/cachectl.h> */
+#ifndef CACHEFLUSH_D_INVAL
+#define CACHEFLUSH_D_INVAL 0x1
+#define CACHEFLUSH_D_WB    0x2
+#endif
+
+static void sh_writeback(void *virt, unsigned long phys, unsigned long len,
+			 void *data)
+{
+	syscall(__NR_cacheflush, virt, len, CACHEFLUSH_D_WB);
+}
+
+static void sh_invalidate(void *virt, unsigned long phys, unsigned long len,
+			  void *data)
+{
+	syscall(__NR_cacheflush, virt, len, CACHEFLUSH_D_INVAL);
+}
+
+static const struct shveu_cache_ops default_ops = {
+	sh_writeback, sh_invalidate, NULL
+};
+
+#else
+
+/* Coherent unless told otherwise */
+static const struct shveu_cache_ops default_ops = {
+	NULL, NULL, NULL
+};
+
+#endif
+
+static struct shveu_cache_ops cache_ops = {
+	default_ops.writeback, default_ops.invalidate, default_ops.data
+};
+
+int
+shveu_cache_register(void *virt, unsigned long phys, unsigned long len)
+{
+	int i, ret = -1;
+
+	if (len == 0 || phys + len < phys)
+		return -1;
+
+	pthread_mutex_lock(&cache_lock);
+
+	if (nr_ranges == SHVEU_MAX_CACHED_RANGES)
+		goto out;
+
+	for (i = 0; i < nr_ranges; i++) {
+		if (phys < ranges[i].phys + ranges[i].len &&
+		    ranges[i].phys < phys + len)
+			goto out;
+	}
+
+	ranges[nr_ranges].virt = virt;
+	ranges[nr_ranges].phys = phys;
+	ranges[nr_ranges].len = len;
+	nr_ranges++;
+	ret = 0;
+
+out:
+	pthread_mutex_unlock(&cache_lock);
+	return ret;
+}
+
+int
+shveu_cache_unregister(unsigned long phys)
+{
+	int i, ret = -1;
+
+	pthread_mutex_lock(&cache_lock);
+
+	for (i = 0; i < nr_ranges; i++) {
+		if (ranges[i].phys == phys) {
+			ranges[i] = ranges[--nr_ranges];
+			ret = 0;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+	return ret;
+}
+
+void
+shveu_cache_set_ops(const struct shveu_cache_ops *ops)
+{
+	pthread_mutex_lock(&cache_lock);
+	cache_ops = ops ? *ops : default_ops;
+	pthread_mutex_unlock(&cache_lock);
+}
+
+/* Apply a maintenance operation to the parts of [phys, phys+len) that are
+ * within cached ranges. Called with cache_lock held. */
+static void maintain_range(unsigned long phys, unsigned long len, int writeback)
+{
+	unsigned long start, end;
+	void *virt;
+	int i;
+
+	for (i = 0; i < nr_ranges; i++) {
+		start = phys > ranges[i].phys ? phys : ranges[i].phys;
+		end = phys + len < ranges[i].phys + ranges[i].len ?
+		      phys + len : ranges[i].phys + ranges[i].len;
+		if (start >= end)
+			continue;
+
+		virt = (char *)ranges[i].virt + (start - ranges[i].phys);
+		if (writeback)
+			cache_ops.writeback(virt, start, end - start, cache_ops.data);
+		else
+			cache_ops.invalidate(virt, start, end - start, cache_ops.data);
+	}
+}
+
+/* Maintain the bytes of a plane that hold image data */
+static void maintain_plane(unsigned long phys, unsigned long line,
+			   unsigned long stride, unsigned long lines,
+			   int writeback)
+{
+	unsigned long i;
+
+	if (lines == 0)
+		return;
+
+	if (stride >= LINE_BY_LINE * line) {
+		for (i = 0; i < lines; i++)
+			maintain_range(phys + i * stride, line, writeback);
+	} else {
+		maintain_range(phys, (lines - 1) * stride + line, writeback);
+	}
+}
+
+/* Maintain both planes of an image */
+static void maintain_image(unsigned long py, unsigned long pc,
+			   unsigned long width, unsigned long height,
+			   unsigned long pitch, shveu_format_t fmt,
+			   int writeback)
+{
+	struct shveu_surface s;
+
+	if (sh_veu_surface_pitch(&s, fmt, width, height, pitch) < 0)
+		return;
+
+	maintain_plane(py, s.y_line, s.y_stride, s.height, writeback);
+	if (s.c_lines)
+		maintain_plane(pc, s.c_line, s.c_stride, s.c_lines, writeback);
+}
+
+void sh_veu_cache_start(const struct shveu_op *op)
+{
+	pthread_mutex_lock(&cache_lock);
+
+	current_cached = (nr_ranges > 0 && cache_ops.writeback && cache_ops.invalidate);
+	if (current_cached) {
+		current_op = *op;
+
+		/* Dirty lines of the destination must not be written back
+		 * over the output later */
+		maintain_image(op->src_py, op->src_pc, op->src_width, op->src_height,
+			       op->src_pitch, op->src_fmt, 1);
+		maintain_image(op->dst_py, op->dst_pc, op->dst_width, op->dst_height,
+			       op->dst_pitch, op->dst_fmt, 1);
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void sh_veu_cache_done(void)
+{
+	const struct shveu_op *op = &current_op;
+
+	pthread_mutex_lock(&cache_lock);
+
+	if (current_cached) {
+		maintain_image(op->dst_py, op->dst_pc, op->dst_width, op->dst_height,
+			       op->dst_pitch, op->dst_fmt, 0);
+		current_cached = 0;
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void *sh_veu_cache_virt(unsigned long phys, unsigned long len)
+{
+	void *virt = NULL;
+	int i;
+
+	pthread_mutex_lock(&cache_lock);
+
+	for (i = 0; i < nr_ranges; i++) {
+		if (phys >= ranges[i].phys && len <= ranges[i].len &&
+		    phys - ranges[i].phys <= ranges[i].len - len) {
+			virt = (char *)ranges[i].virt + (phys - ranges[i].phys);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+	return virt;
+}
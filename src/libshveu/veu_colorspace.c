@@ -34,7 +34,8 @@
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <fcntl.h>
-#include <linux/fb.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include <pthread.h>
 #include <semaphore.h>
 
@@ -43,10 +44,59 @@
 #include <errno.h>
 
 #include "shveu/veu_colorspace.h"
+#include "shveu/veu_prepared.h"
+#include "shveu/veu_queue.h"
 
 #include "shveu_regs.h"
+#include "shveu_internal.h"
+
+/* Flags that may be ORed into a format */
+#define FMT_FLAGS (SHVEU_FULL_RANGE | SHVEU_BT709)
+
+/* VEU2H colour matrices for YCbCr to RGB: rows R, G, B; columns Cr, Y, Cb.
+ * 14-bit two's complement with 11 fractional bits. Indexed by the
+ * SHVEU_FULL_RANGE and SHVEU_BT709 flags of the YCbCr format. */
+static const unsigned long vmcr_tables[4][9] = {
+	/* BT.601 limited range */
+	{ 0x0cc5, 0x0950, 0x0000,
+	  0x397f, 0x0950, 0x3cdd,
+	  0x0000, 0x0950, 0x1023 },
+	/* BT.601 full range */
+	{ 0x0b37, 0x0800, 0x0000,
+	  0x3a49, 0x0800, 0x3d3f,
+	  0x0000, 0x0800, 0x0e2d },
+	/* BT.709 limited range */
+	{ 0x0e58, 0x0951, 0x0000,
+	  0x3bbd, 0x0951, 0x3e4b,
+	  0x0000, 0x0951, 0x10e6 },
+	/* BT.709 full range */
+	{ 0x0c99, 0x0800, 0x0000,
+	  0x3c41, 0x0800, 0x3e80,
+	  0x0000, 0x0800, 0x0ed8 },
+};
+
+/* VCOFFR: Cb/Cr offset in the high half, Y offset in the low half */
+#define VCOFFR_LIMITED 0x00800010
+#define VCOFFR_FULL    0x00800000
+
+/* Whether a format is RGB, and its layout as far as VTRCR is concerned */
+static int fmt_is_rgb(shveu_format_t fmt)
+{
+	fmt &= SHVEU_FORMAT_MASK;
+	return (fmt == SHVEU_RGB565) || (fmt == SHVEU_RGB565_BE);
+}
 
-#define FMT_MASK (SHVEU_RGB565 | SHVEU_YCbCr420 | SHVEU_YCbCr422)
+static shveu_format_t fmt_base(shveu_format_t fmt)
+{
+	switch (fmt & SHVEU_FORMAT_MASK) {
+	case SHVEU_RGB565_BE:
+		return SHVEU_RGB565;
+	case SHVEU_YCrCb420:
+		return SHVEU_YCbCr420;
+	default:
+		return fmt & SHVEU_FORMAT_MASK;
+	}
+}
 
 static int fgets_with_openclose(char *fname, char *buf, size_t maxlen)
 {
@@ -63,42 +113,45 @@ static int fgets_with_openclose(char *fname, char *buf, size_t maxlen)
 	}
 }
 
-struct sh_veu_uio_device {
-	char *name;
-	char *path;
-	int fd;
-};
-
-struct uio_map {
-	unsigned long address;
-	unsigned long size;
-	void *iomem;
-};
-
-
-#define MAXUIOIDS  100
 #define MAXNAMELEN 256
 
+/* Find the lowest numbered UIO device whose name starts with 'name',
+ * reading only the names of the devices that exist */
 static int locate_sh_veu_uio_device(char *name,
 				    struct sh_veu_uio_device *udp)
 {
-	char fname[MAXNAMELEN], buf[MAXNAMELEN];
-	int uio_id, i;
+	char fname[MAXNAMELEN], buf[MAXNAMELEN], match[MAXNAMELEN];
+	struct dirent *de;
+	struct stat st;
+	DIR *dir;
+	int uio_id = -1, id;
 
-	for (uio_id = 0; uio_id < MAXUIOIDS; uio_id++) {
-		sprintf(fname, "/sys/class/uio/uio%d/name", uio_id);
+	if ((dir = opendir("/sys/class/uio")) == NULL)
+		return -1;
+
+	while ((de = readdir(dir)) != NULL) {
+		if (sscanf(de->d_name, "uio%d", &id) != 1)
+			continue;
+		if (uio_id >= 0 && id > uio_id)
+			continue;
+		sprintf(fname, "/sys/class/uio/uio%d/name", id);
 		if (fgets_with_openclose(fname, buf, MAXNAMELEN) < 0)
 			continue;
-		if (strncmp(name, buf, strlen(name)) == 0)
-			break;
+		if (strncmp(name, buf, strlen(name)) == 0) {
+			uio_id = id;
+			strcpy(match, buf);
+		}
 	}
+	closedir(dir);
 
-	if (uio_id >= MAXUIOIDS)
+	if (uio_id < 0)
 		return -1;
 
-	udp->name = strdup(buf);
+	match[strcspn(match, "\n")] = '\0';
+	sprintf(fname, "/sys/class/uio/uio%d", uio_id);
+
+	udp->name = strdup(match);
 	udp->path = strdup(fname);
-	udp->path[strlen(udp->path) - 4] = '\0';
 
 	sprintf(buf, "/dev/uio%d", uio_id);
 	udp->fd = open(buf, O_RDWR | O_SYNC /*| O_NONBLOCK */ );
@@ -108,11 +161,14 @@ static int locate_sh_veu_uio_device(char *name,
 		return -1;
 	}
 
+	if (fstat(udp->fd, &st) == 0)
+		udp->rdev = st.st_rdev;
+
 	return 0;
 }
 
-static int setup_uio_map(struct sh_veu_uio_device *udp, int nr,
-			 struct uio_map *ump)
+static int read_uio_map(struct sh_veu_uio_device *udp, int nr,
+			struct uio_map *ump)
 {
 	char fname[MAXNAMELEN], buf[MAXNAMELEN];
 
@@ -128,6 +184,12 @@ static int setup_uio_map(struct sh_veu_uio_device *udp, int nr,
 
 	ump->size = strtoul(buf, NULL, 0);
 
+	return 0;
+}
+
+static int setup_uio_map(struct sh_veu_uio_device *udp, int nr,
+			 struct uio_map *ump)
+{
 	ump->iomem = mmap(0, ump->size,
 			  PROT_READ | PROT_WRITE, MAP_SHARED,
 			  udp->fd, nr * getpagesize());
@@ -138,22 +200,174 @@ static int setup_uio_map(struct sh_veu_uio_device *udp, int nr,
 	return 0;
 }
 
-/* global variables */
+/*
+ * Topology cache
+ *
+ * If SHVEU_TOPOLOGY_CACHE names a file, the UIO device found by a previous
+ * probe and its map addresses and sizes (which also identify the VEU
+ * variant) are kept there, so that a later shveu_open() need not search
+ * sysfs. The cache is only trusted during the boot it was written in, and
+ * if the device node still has the same device number.
+ */
+
+#define CACHE_VERSION 1
+#define BOOT_ID_LEN 36
+
+static int read_boot_id(char *boot_id)
+{
+	char buf[MAXNAMELEN];
+
+	if (fgets_with_openclose("/proc/sys/kernel/random/boot_id", buf, MAXNAMELEN) < BOOT_ID_LEN)
+		return -1;
+
+	memcpy(boot_id, buf, BOOT_ID_LEN);
+	boot_id[BOOT_ID_LEN] = '\0';
+
+	return 0;
+}
+
+static int load_topology(const char *cache, struct sh_veu_uio_device *udp,
+			 struct uio_map *mmio, struct uio_map *mem)
+{
+	char boot_id[BOOT_ID_LEN+1], cached_id[BOOT_ID_LEN+1];
+	char name[MAXNAMELEN], fname[MAXNAMELEN];
+	unsigned long rdev;
+	struct stat st;
+	int version, uio_id, n;
+	FILE *fp;
+
+	if (read_boot_id(boot_id) < 0)
+		return -1;
+
+	if ((fp = fopen(cache, "r")) == NULL)
+		return -1;
+	n = fscanf(fp, "shveu-topology %d boot %36s uio %d %lx name %255s "
+		   "map0 %lx %lx map1 %lx %lx",
+		   &version, cached_id, &uio_id, &rdev, name,
+		   &mmio->address, &mmio->size, &mem->address, &mem->size);
+	fclose(fp);
+
+	if (n != 9 || version != CACHE_VERSION || strcmp(boot_id, cached_id))
+		return -1;
+
+	sprintf(fname, "/dev/uio%d", uio_id);
+	udp->fd = open(fname, O_RDWR | O_SYNC);
+	if (udp->fd < 0)
+		return -1;
+
+	if (fstat(udp->fd, &st) < 0 || st.st_rdev != (dev_t)rdev) {
+		close(udp->fd);
+		udp->fd = -1;
+		return -1;
+	}
+
+	sprintf(fname, "/sys/class/uio/uio%d", uio_id);
+	udp->name = strdup(name);
+	udp->path = strdup(fname);
+	udp->rdev = st.st_rdev;
+
+	return 0;
+}
+
+static void save_topology(const char *cache, struct sh_veu_uio_device *udp,
+			  struct uio_map *mmio, struct uio_map *mem)
+{
+	char boot_id[BOOT_ID_LEN+1], tmp[MAXNAMELEN];
+	int uio_id, fd;
+	FILE *fp;
+
+	if (read_boot_id(boot_id) < 0 ||
+	    sscanf(udp->path, "/sys/class/uio/uio%d", &uio_id) != 1)
+		return;
+
+	/* Write a new file and rename it, so readers never see a partial one */
+	if (snprintf(tmp, MAXNAMELEN, "%s.XXXXXX", cache) >= MAXNAMELEN)
+		return;
+	if ((fd = mkstemp(tmp)) < 0)
+		return;
+	if ((fp = fdopen(fd, "w")) == NULL) {
+		close(fd);
+		unlink(tmp);
+		return;
+	}
+
+	fprintf(fp, "shveu-topology %d\nboot %s\nuio %d %lx\nname %s\n"
+		"map0 %lx %lx\nmap1 %lx %lx\n",
+		CACHE_VERSION, boot_id, uio_id, (unsigned long)udp->rdev, udp->name,
+		mmio->address, mmio->size, mem->address, mem->size);
+
+	if (fclose(fp) != 0 || rename(tmp, cache) < 0)
+		unlink(tmp);
+}
+
+/* global variables, declared in shveu_internal.h */
 struct sh_veu_uio_device sh_veu_uio_dev;
 struct uio_map sh_veu_uio_mmio, sh_veu_uio_mem;
 
+void *sh_veu_phys_to_virt(unsigned long phys, unsigned long len)
+{
+	struct uio_map *ump = &sh_veu_uio_mem;
+	void *virt;
+
+	/* Prefer a cached mapping for the CPU */
+	if ((virt = sh_veu_cache_virt(phys, len)) != NULL)
+		return virt;
+
+	if (ump->iomem == NULL || ump->iomem == MAP_FAILED)
+		return NULL;
+	if ((phys < ump->address) || (len > ump->size) ||
+	    (phys - ump->address > ump->size - len))
+		return NULL;
+
+	return (char *)ump->iomem + (phys - ump->address);
+}
+
+int sh_veu_plane_sizes(shveu_format_t format, unsigned long pitch,
+		       unsigned long height, unsigned long *y_size,
+		       unsigned long *c_size)
+{
+	switch (format & SHVEU_FORMAT_MASK) {
+	case SHVEU_RGB565:
+	case SHVEU_RGB565_BE:
+	case SHVEU_YUYV:
+	case SHVEU_UYVY:
+		*y_size = pitch * height * 2;
+		*c_size = 0;
+		break;
+	case SHVEU_YCbCr420:
+	case SHVEU_YCrCb420:
+		*y_size = pitch * height;
+		*c_size = pitch * ((height + 1) / 2);
+		break;
+	case SHVEU_YCbCr422:
+		*y_size = pitch * height;
+		*c_size = pitch * height;
+		break;
+	case SHVEU_YCbCr444:
+		*y_size = pitch * height;
+		*c_size = pitch * height * 2;
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
+
 /* Helper functions for reading registers. */
 
-static unsigned long read_reg(struct uio_map *ump, int reg_nr)
+/* Registers are 32 bits wide, whatever the size of a long */
+
+static uint32_t read_reg(struct uio_map *ump, int reg_nr)
 {
-	volatile unsigned long *reg = ump->iomem + reg_nr;
+	volatile uint32_t *reg = ump->iomem + reg_nr;
 
 	return *reg;
 }
 
-static void write_reg(struct uio_map *ump, unsigned long value, int reg_nr)
+static void write_reg(struct uio_map *ump, uint32_t value, int reg_nr)
 {
-	volatile unsigned long *reg = ump->iomem + reg_nr;
+	volatile uint32_t *reg = ump->iomem + reg_nr;
 
 	*reg = value;
 }
@@ -168,8 +382,9 @@ static int sh_veu_is_veu3f(void)
 	return sh_veu_uio_mmio.size == 0xcc;
 }
 
-static void set_scale(struct uio_map *ump, int vertical,
-		      int size_in, int size_out)
+/* Calculate the scale, clip and resize passband fields for one direction */
+static void calc_scale(int size_in, int size_out, unsigned long *scale,
+		       unsigned long *clip, unsigned long *passband)
 {
 	unsigned long fixpoint, mant, frac, value, vb;
 
@@ -194,77 +409,45 @@ static void set_scale(struct uio_map *ump, int vertical,
 		frac = 0;
 	}
 
-	/* set scale */
-
-	value = read_reg(ump, VRFCR);
+	*scale = (mant << 12) | frac;
+	*clip = size_out;
 
-	if (vertical) {
-		value &= ~0xffff0000;
-		value |= ((mant << 12) | frac) << 16;
-	} else {
-		value &= ~0xffff;
-		value |= (mant << 12) | frac;
-	}
-
-	write_reg(ump, value, VRFCR);
-
-	/* set clip */
-
-	value = read_reg(ump, VRFSR);
+	/* VEU3F needs additional VRPBR register handling */
+	if (size_out >= size_in)
+		vb = 64;
+	else {
+		if ((mant >= 8) && (mant < 16))
+			value = 4;
+		else if ((mant >= 4) && (mant < 8))
+			value = 2;
+		else
+			value = 1;
 
-	if (vertical) {
-		value &= ~0xffff0000;
-		value |= size_out << 16;
-	} else {
-		value &= ~0xffff;
-		value |= size_out;
+		vb = 64 * 4096 * value;
+		vb /= 4096 * mant + frac;
 	}
 
-	write_reg(ump, value, VRFSR);
-
-	/* VEU3F needs additional VRPBR register handling */
-#ifdef KERNEL2_6_33
-	if (sh_veu_is_veu3f()) {
-#endif
-	    if (size_out >= size_in)
-	        vb = 64;
-	    else {
-	        if ((mant >= 8) && (mant < 16))
-	            value = 4;
-	        else if ((mant >= 4) && (mant < 8))
-	            value = 2;
-	        else
-	            value = 1;
-
-	        vb = 64 * 4096 * value;
-	        vb /= 4096 * mant + frac;
-	    }
-
-	    /* set resize passband register */
-	    value = read_reg(ump, VRPBR);
-	    if (vertical) {
-	        value &= ~0xffff0000;
-		value |= vb << 16;
-	    } else {
-	        value &= ~0xffff;
-	        value |= vb;
-	    }
-	    write_reg(ump, value, VRPBR);
-#ifdef KERNEL2_6_33
-	}
-#endif
+	*passband = vb;
 }
 
 static int sh_veu_probe(int verbose, int force)
 {
-	unsigned long addr;
-	int src_w, src_h, src_bpp;
-	int dst_w, dst_h;
+	const char *cache = getenv("SHVEU_TOPOLOGY_CACHE");
 	int ret;
 
-	ret = locate_sh_veu_uio_device("VEU", &sh_veu_uio_dev);
-	if (ret < 0)
-		return ret;
+	if (cache == NULL || *cache == '\0' ||
+	    load_topology(cache, &sh_veu_uio_dev, &sh_veu_uio_mmio, &sh_veu_uio_mem) < 0) {
+		ret = locate_sh_veu_uio_device("VEU", &sh_veu_uio_dev);
+		if (ret < 0)
+			return ret;
+
+		if (read_uio_map(&sh_veu_uio_dev, 0, &sh_veu_uio_mmio) < 0 ||
+		    read_uio_map(&sh_veu_uio_dev, 1, &sh_veu_uio_mem) < 0)
+			return -1;
+
+		if (cache && *cache)
+			save_topology(cache, &sh_veu_uio_dev, &sh_veu_uio_mmio, &sh_veu_uio_mem);
+	}
 
 #ifdef DEBUG
 	fprintf(stderr, "found matching UIO device at %s\n", sh_veu_uio_dev.path);
@@ -290,206 +473,238 @@ static int sh_veu_init(void)
 
 static void sh_veu_destroy(void)
 {
+	if (sh_veu_uio_mmio.iomem && sh_veu_uio_mmio.iomem != MAP_FAILED)
+		munmap(sh_veu_uio_mmio.iomem, sh_veu_uio_mmio.size);
+	if (sh_veu_uio_mem.iomem && sh_veu_uio_mem.iomem != MAP_FAILED)
+		munmap(sh_veu_uio_mem.iomem, sh_veu_uio_mem.size);
+	if (sh_veu_uio_dev.fd > 0)
+		close(sh_veu_uio_dev.fd);
+	free(sh_veu_uio_dev.name);
+	free(sh_veu_uio_dev.path);
+
+	memset(&sh_veu_uio_dev, 0, sizeof(sh_veu_uio_dev));
+	memset(&sh_veu_uio_mmio, 0, sizeof(sh_veu_uio_mmio));
+	memset(&sh_veu_uio_mem, 0, sizeof(sh_veu_uio_mem));
 }
 
 
+int sh_veu_check_op(const struct shveu_op *op)
+{
+	shveu_format_t src_fmt = op->src_fmt & SHVEU_FORMAT_MASK;
+	shveu_format_t dst_fmt = op->dst_fmt & SHVEU_FORMAT_MASK;
+
+	if ((op->src_fmt | op->dst_fmt) & ~(SHVEU_FORMAT_MASK | FMT_FLAGS | SHVEU_FILTER_MASK))
+		return -1;
+
+	/* The filter applies to the destination. The layout of the VEU
+	 * lowpass registers is not documented, so smooth scaling is only
+	 * done on the CPU. */
+	if ((op->src_fmt & SHVEU_FILTER_MASK) ||
+	    (op->dst_fmt & SHVEU_FILTER_MASK) > SHVEU_FILTER_FAST)
+		return -1;
+
+	/* Supported formats. The rotator handles 1 and 2 bytes per pixel
+	 * only. */
+	if (!SHVEU_FORMATS_VALID(src_fmt, dst_fmt, op->rotate))
+		return -1;
+
+	/* Cb and Cr can only be exchanged by the VEU2H colour matrix */
+	if ((src_fmt == SHVEU_YCrCb420) && !sh_veu_is_veu2h())
+		return -1;
+
+	/* Rotate can't be performed at the same time as a scale, and the
+	 * VESWR/VEDWR, VESSR and scaling limits */
+	if (!SHVEU_GEOMETRY_VALID(op->src_width, op->src_height, op->src_pitch,
+				  op->dst_width, op->dst_height, op->dst_pitch,
+				  op->rotate, sh_veu_is_veu2h() ? 8 : 16))
+		return -1;
+
+	return 0;
+}
+
 int shveu_open(void)
 {
 	int ret=0;
 
 	ret = sh_veu_probe(0, 0);
-	if (ret < 0)
+	if (ret < 0) {
+		sh_veu_destroy();
 		return ret;
+	}
 
-	sh_veu_init();
+	/* The VEU is reset before each operation, so resetting it here too
+	 * would only delay startup (and could disturb another process
+	 * using it) */
 
 	return 0;
 }
 
 void shveu_close(void)
 {
+	sh_veu_destroy();
 }
 
-int
-shveu_start(
-	unsigned int veu_index,
-	unsigned long src_py,
-	unsigned long src_pc,
-	unsigned long src_width,
-	unsigned long src_height,
-	unsigned long src_pitch,
-	shveu_format_t src_fmt,
-	unsigned long dst_py,
-	unsigned long dst_pc,
-	unsigned long dst_width,
-	unsigned long dst_height,
-	unsigned long dst_pitch,
-	shveu_format_t dst_fmt,
-	shveu_rotation_t rotate)
+/* Translate a checked operation into register values */
+static void sh_veu_prepare(struct shveu_prepared *prep)
 {
-	/* Ignore veu_index as we only support one VEU at the moment */
-	struct uio_map *ump = &sh_veu_uio_mmio;
-
-#ifdef DEBUG
-	fprintf(stderr, "%s IN\n", __FUNCTION__);
-	fprintf(stderr, "src_fmt=%X: src_width=%d, src_height=%d src_pitch=%d\n",
-		src_fmt, src_width, src_height, src_pitch);
-	fprintf(stderr, "dst_fmt=%x: dst_width=%d, dst_height=%d dst_pitch=%d\n",
-		dst_fmt, dst_width, dst_height, dst_pitch);
-	fprintf(stderr, "rotate=%d\n", rotate);
-#endif
-
-	/* Rotate can't be performed at the same time as a scale! */
-	if (rotate && (src_width != dst_height))
-		return -1;
-	if (rotate && (dst_width != src_height))
-		return -1;
-
-	if ((src_fmt != SHVEU_YCbCr420) &&
-	    (src_fmt != SHVEU_YCbCr422) &&
-	    (src_fmt != SHVEU_RGB565))
-		return -1;
-	if ((dst_fmt != SHVEU_YCbCr420) &&
-	    (dst_fmt != SHVEU_YCbCr422) &&
-	    (dst_fmt != SHVEU_RGB565))
-		return -1;
-
-	/* VESWR/VEDWR restrictions */
-	if ((src_pitch % 2) || (dst_pitch % 2))
-		return -1;
-
-	/* VESSR restrictions */
-	if ((src_height < 16) || (src_height > 4092) ||
-	    (src_width  < 16) || (src_width  > 4092))
-		return -1;
+	const struct shveu_op *op = &prep->op;
+	unsigned long h_scale, h_clip, h_passband;
+	unsigned long v_scale, v_clip, v_passband;
+	unsigned long vswpr = 0, vtrcr = 0;
+	shveu_format_t ycbcr_fmt;
+	int i, col;
+
+	prep->vessr = (op->src_height << 16) | op->src_width;
+
+	prep->veswr = op->src_pitch;
+	if (fmt_is_rgb(op->src_fmt))
+		prep->veswr *= 2;
+	prep->vedwr = op->dst_pitch;
+	if (fmt_is_rgb(op->dst_fmt))
+		prep->vedwr *= 2;
+
+	if (op->rotate) {
+		int src_vblk  = (op->src_height+15)/16;
+		int src_sidev = (op->src_height+15)%16 + 1;
+		int dst_density = 2;	/* for RGB565 and YCbCr422 */
 
-	/* Scaling limits */
-	if (sh_veu_is_veu2h()) {
-		if ((dst_width > 8*src_width) || (dst_height > 8*src_height))
-			return -1;
+		if (fmt_base(op->dst_fmt) == SHVEU_YCbCr420)
+			dst_density = 1;
+		prep->dst_offset = ((src_vblk-2)*16 + src_sidev) * dst_density;
 	} else {
-		if ((dst_width > 16*src_width) || (dst_height > 16*src_height))
-			return -1;
+		prep->dst_offset = 0;
 	}
-	if ((dst_width < src_width/16) || (dst_height < src_height/16))
-		return -1;
 
-	/* reset */
-	sh_veu_init();
-
-	/* source */
-	write_reg(ump, (unsigned long)src_py, VSAYR);
-	write_reg(ump, (unsigned long)src_pc, VSACR);
+	/* byte/word swapping: longwords and words are always swapped, and
+	 * bytes too unless the data is little-endian 16-bit RGB565 */
+	if ((op->src_fmt & SHVEU_FORMAT_MASK) == SHVEU_RGB565)
+		vswpr |= 0x6;
+	else
+		vswpr |= 0x7;
+	if ((op->dst_fmt & SHVEU_FORMAT_MASK) == SHVEU_RGB565)
+		vswpr |= 0x60;
+	else
+		vswpr |= 0x70;
+	prep->vswpr = vswpr;
 
-	write_reg(ump, (src_height << 16) | src_width, VESSR);
+	/* transform control */
+	if (fmt_base(op->src_fmt) == SHVEU_RGB565) {
+		vtrcr |= VTRCR_RY_SRC_RGB;
+		vtrcr |= VTRCR_SRC_FMT_RGB565;
+	} else {
+		vtrcr |= VTRCR_RY_SRC_YCBCR;
+		if (fmt_base(op->src_fmt) == SHVEU_YCbCr420)
+			vtrcr |= VTRCR_SRC_FMT_YCBCR420;
+		else if (fmt_base(op->src_fmt) == SHVEU_YCbCr444)
+			vtrcr |= VTRCR_SRC_FMT_YCBCR444;
+		else
+			vtrcr |= VTRCR_SRC_FMT_YCBCR422;
+	}
 
-	if (src_fmt == SHVEU_RGB565)
-		src_pitch *= 2;
-	write_reg(ump, src_pitch, VESWR);
-	write_reg(ump, 0, VBSSR);	/* not using bundle mode */
+	if (fmt_base(op->dst_fmt) == SHVEU_RGB565) {
+		vtrcr |= VTRCR_DST_FMT_RGB565;
+	} else {
+		if (fmt_base(op->dst_fmt) == SHVEU_YCbCr420)
+			vtrcr |= VTRCR_DST_FMT_YCBCR420;
+		else if (fmt_base(op->dst_fmt) == SHVEU_YCbCr444)
+			vtrcr |= VTRCR_DST_FMT_YCBCR444;
+		else
+			vtrcr |= VTRCR_DST_FMT_YCBCR422;
+	}
 
+	/* The flags of the YCbCr side describe an RGB conversion */
+	ycbcr_fmt = fmt_is_rgb(op->src_fmt) ? op->dst_fmt : op->src_fmt;
+	if (fmt_is_rgb(op->src_fmt) == fmt_is_rgb(op->dst_fmt))
+		ycbcr_fmt = 0;
+
+	if (fmt_base(op->src_fmt) != fmt_base(op->dst_fmt)) {
+		vtrcr |= VTRCR_TE_BIT_SET;
+		if (ycbcr_fmt & YCBCR_FULL_RANGE)
+			vtrcr |= VTRCR_FULL_COLOR_CONV;
+		if (ycbcr_fmt & YCBCR_BT709)
+			vtrcr |= VTRCR_BT709;
+	}
+	prep->vtrcr = vtrcr;
+
+	/* VEU2H matrix. NV21 is read as NV12, with the Cb and Cr columns
+	 * exchanged */
+	for (i = 0; i < 9; i++) {
+		col = i % 3;
+		if ((op->src_fmt & SHVEU_FORMAT_MASK) == SHVEU_YCrCb420)
+			col = 2 - col;
+		prep->vmcr[i - i % 3 + col] =
+			vmcr_tables[(ycbcr_fmt & FMT_FLAGS) >> 16][i];
+	}
+	prep->vcoffr = (ycbcr_fmt & YCBCR_FULL_RANGE) ? VCOFFR_FULL : VCOFFR_LIMITED;
 
-	/* dest */
-	if (rotate) {
-		int src_vblk  = (src_height+15)/16;
-		int src_sidev = (src_height+15)%16 + 1;
-		int dst_density = 2;	/* for RGB565 and YCbCr422 */
-		int offset;
+	/* scaling: horizontal in the low half, vertical in the high half */
+	calc_scale(op->src_width, op->dst_width, &h_scale, &h_clip, &h_passband);
+	calc_scale(op->src_height, op->dst_height, &v_scale, &v_clip, &v_passband);
 
-		if ((dst_fmt & FMT_MASK) == SHVEU_YCbCr420)
-			dst_density = 1;
-		offset = ((src_vblk-2)*16 + src_sidev) * dst_density;
+	prep->vrfcr = (v_scale << 16) | h_scale;
+	prep->vrfsr = (v_clip << 16) | h_clip;
+	prep->vrpbr = (v_passband << 16) | h_passband;
 
-		write_reg(ump, (unsigned long)dst_py + offset, VDAYR);
-		write_reg(ump, (unsigned long)dst_pc + offset, VDACR);
+	if (op->rotate) {
+		prep->vfmcr = 1;
+		prep->vrfcr = 0;
 	} else {
-		write_reg(ump, (unsigned long)dst_py, VDAYR);
-		write_reg(ump, (unsigned long)dst_pc, VDACR);
+		prep->vfmcr = 0;
 	}
 
-	if (dst_fmt == SHVEU_RGB565)
-		dst_pitch *= 2;
-	write_reg(ump, dst_pitch, VEDWR);
-
-	/* byte/word swapping */
-	{
-		unsigned long vswpr = 0;
-		if (src_fmt == SHVEU_RGB565)
-			vswpr |= 0x6;
-		else
-			vswpr |= 0x7;
-		if (dst_fmt == SHVEU_RGB565)
-			vswpr |= 0x60;
-		else
-			vswpr |= 0x70;
-		write_reg(ump, vswpr, VSWPR);
 #if DEBUG
-		fprintf(stderr, "vswpr=0x%X\n", vswpr);
+	fprintf(stderr, "vswpr=0x%lX\n", prep->vswpr);
+	fprintf(stderr, "vtrcr=0x%lX\n", prep->vtrcr);
 #endif
-	}
+}
 
+/* Write a prepared operation to the VEU and start it */
+static void sh_veu_program(const struct shveu_prepared *prep)
+{
+	const struct shveu_op *op = &prep->op;
+	struct uio_map *ump = &sh_veu_uio_mmio;
 
-	/* transform control */
-	{
-		unsigned long vtrcr = 0;
-		if ((src_fmt & FMT_MASK) == SHVEU_RGB565) {
-			vtrcr |= VTRCR_RY_SRC_RGB;
-			vtrcr |= VTRCR_SRC_FMT_RGB565;
-		} else {
-			vtrcr |= VTRCR_RY_SRC_YCBCR;
-			if ((src_fmt & FMT_MASK) == SHVEU_YCbCr420)
-				vtrcr |= VTRCR_SRC_FMT_YCBCR420;
-			else
-				vtrcr |= VTRCR_SRC_FMT_YCBCR422;
-		}
+	/* The VEU must see what the CPU wrote */
+	sh_veu_cache_start(op);
 
-		if ((dst_fmt & FMT_MASK) == SHVEU_RGB565) {
-			vtrcr |= VTRCR_DST_FMT_RGB565;
-		} else {
-			if ((dst_fmt & FMT_MASK) == SHVEU_YCbCr420)
-				vtrcr |= VTRCR_DST_FMT_YCBCR420;
-			else
-				vtrcr |= VTRCR_DST_FMT_YCBCR422;
-		}
+	/* reset */
+	sh_veu_init();
 
-		if ((src_fmt & FMT_MASK) != (dst_fmt & FMT_MASK)) {
-			vtrcr |= VTRCR_TE_BIT_SET;
-			if ((src_fmt & YCBCR_FULL_RANGE) || (dst_fmt & YCBCR_FULL_RANGE))
-				vtrcr |= VTRCR_FULL_COLOR_CONV;
-			if ((src_fmt & YCBCR_BT709) || (dst_fmt & YCBCR_BT709))
-				vtrcr |= VTRCR_BT709;
-		}
-		write_reg(ump, vtrcr, VTRCR);
-#if DEBUG
-		fprintf(stderr, "vtrcr=0x%X\n", vtrcr);
-#endif
-	}
+	/* source */
+	write_reg(ump, (unsigned long)op->src_py, VSAYR);
+	write_reg(ump, (unsigned long)op->src_pc, VSACR);
+
+	write_reg(ump, prep->vessr, VESSR);
+	write_reg(ump, prep->veswr, VESWR);
+	write_reg(ump, 0, VBSSR);	/* not using bundle mode */
+
+	/* dest */
+	write_reg(ump, (unsigned long)op->dst_py + prep->dst_offset, VDAYR);
+	write_reg(ump, (unsigned long)op->dst_pc + prep->dst_offset, VDACR);
+	write_reg(ump, prep->vedwr, VEDWR);
+
+	write_reg(ump, prep->vswpr, VSWPR);
+	write_reg(ump, prep->vtrcr, VTRCR);
 
 	/* Is this a VEU2H on SH7723? */
 	if (ump->size > VBSRR) {
-		/* color conversion matrix */
-		write_reg(ump, 0x0cc5, VMCR00);
-		write_reg(ump, 0x0950, VMCR01);
-		write_reg(ump, 0x0000, VMCR02);
-		write_reg(ump, 0x397f, VMCR10);
-		write_reg(ump, 0x0950, VMCR11);
-		write_reg(ump, 0x3cdd, VMCR12);
-		write_reg(ump, 0x0000, VMCR20);
-		write_reg(ump, 0x0950, VMCR21);
-		write_reg(ump, 0x1023, VMCR22);
-		write_reg(ump, 0x00800010, VCOFFR);
+		int i;
+
+		for (i = 0; i < 9; i++)
+			write_reg(ump, prep->vmcr[i], VMCR00 + 4 * i);
+		write_reg(ump, prep->vcoffr, VCOFFR);
 	}
 
-        set_scale(ump, 0, src_width,  dst_width);
-        set_scale(ump, 1, src_height, dst_height);
+	write_reg(ump, prep->vrfcr, VRFCR);
+	write_reg(ump, prep->vrfsr, VRFSR);
 
-	if (rotate) {
-		write_reg(ump, 1, VFMCR);
-		write_reg(ump, 0, VRFCR);
-	}
-	else {
-		write_reg(ump, 0, VFMCR);
-	}
+	/* VEU3F needs additional VRPBR register handling */
+#ifdef KERNEL2_6_33
+	if (sh_veu_is_veu3f())
+#endif
+		write_reg(ump, prep->vrpbr, VRPBR);
+
+	write_reg(ump, prep->vfmcr, VFMCR);
 
 	/* enable interrupt in VEU */
 	write_reg(ump, 1, VEIER);
@@ -507,6 +722,51 @@ shveu_start(
 
 	/* start operation */
 	write_reg(ump, 1, VESTR);
+}
+
+int
+shveu_start(
+	unsigned int veu_index,
+	unsigned long src_py,
+	unsigned long src_pc,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	unsigned long dst_py,
+	unsigned long dst_pc,
+	unsigned long dst_width,
+	unsigned long dst_height,
+	unsigned long dst_pitch,
+	shveu_format_t dst_fmt,
+	shveu_rotation_t rotate)
+{
+	/* Ignore veu_index as we only support one VEU at the moment */
+	struct shveu_op op = {
+		src_py, src_pc, src_width, src_height, src_pitch, src_fmt,
+		dst_py, dst_pc, dst_width, dst_height, dst_pitch, dst_fmt,
+		rotate
+	};
+	struct shveu_prepared prep;
+
+#ifdef DEBUG
+	fprintf(stderr, "%s IN\n", __FUNCTION__);
+	fprintf(stderr, "src_fmt=%X: src_width=%d, src_height=%d src_pitch=%d\n",
+		src_fmt, src_width, src_height, src_pitch);
+	fprintf(stderr, "dst_fmt=%x: dst_width=%d, dst_height=%d dst_pitch=%d\n",
+		dst_fmt, dst_width, dst_height, dst_pitch);
+	fprintf(stderr, "rotate=%d\n", rotate);
+#endif
+
+	if (shveu_prepare(&prep, &op) < 0)
+		return -1;
+
+	/* Held until shveu_wait() */
+	sh_veu_acquire(veu_index, SHVEU_PRIORITY_NORMAL, 0.0);
+
+	sh_veu_dedup_started(veu_index);
+
+	sh_veu_program(&prep);
 
 #ifdef DEBUG
 	fprintf(stderr, "%s OUT\n", __FUNCTION__);
@@ -515,13 +775,10 @@ shveu_start(
 	return 0;
 }
 
-void
-shveu_wait(
-	unsigned int veu_index)
+/* Wait for the operation in progress to complete */
+static void sh_veu_wait_irq(void)
 {
 	ssize_t nread;
-
-	/* Ignore veu_index as we only support one VEU at the moment */
 	struct uio_map *ump = &sh_veu_uio_mmio;
 
 	/* Wait for an interrupt */
@@ -531,6 +788,51 @@ shveu_wait(
 	}
 
 	write_reg(ump, 0x100, VEVTR);	/* ack int, write 0 to bit 0 */
+
+	/* The CPU must see what the VEU wrote */
+	sh_veu_cache_done();
+}
+
+void
+shveu_wait(
+	unsigned int veu_index)
+{
+	/* Ignore veu_index as we only support one VEU at the moment */
+	sh_veu_wait_irq();
+
+	sh_veu_release(veu_index);
+}
+
+/* Perform a prepared operation, unless the destination already holds its
+ * result, while holding the VEU */
+static void sh_veu_prepared_operation(unsigned int veu_index,
+				      const struct shveu_prepared *prep,
+				      int priority, double deadline)
+{
+	sh_veu_acquire(veu_index, priority, deadline);
+
+	/* Destination already holds the result of this operation */
+	if (!sh_veu_dedup_skip(veu_index, &prep->op)) {
+		sh_veu_dedup_started(veu_index);
+		sh_veu_program(prep);
+		sh_veu_wait_irq();
+		sh_veu_dedup_done(veu_index, 0);
+	}
+
+	sh_veu_release(veu_index);
+}
+
+int sh_veu_operation(unsigned int veu_index, const struct shveu_op *op,
+		     int priority, double deadline)
+{
+	struct shveu_prepared prep;
+
+	if (shveu_prepare(&prep, op) < 0)
+		return -1;
+
+	sh_veu_prepared_operation(veu_index, &prep, priority, deadline);
+
+	return 0;
 }
 
 int
@@ -550,18 +852,41 @@ shveu_operation(
 	shveu_format_t dst_fmt,
 	shveu_rotation_t rotate)
 {
-	int ret = 0;
-
-	ret = shveu_start(
-		veu_index,
+	struct shveu_op op = {
 		src_py, src_pc, src_width, src_height, src_pitch, src_fmt,
 		dst_py, dst_pc, dst_width, dst_height, dst_pitch, dst_fmt,
-		rotate);
+		rotate
+	};
 
-	if (ret == 0)
-		shveu_wait(veu_index);
+	return sh_veu_operation(veu_index, &op, SHVEU_PRIORITY_NORMAL, 0.0);
+}
 
-	return ret;
+int
+shveu_prepare(struct shveu_prepared *prep, const struct shveu_op *op)
+{
+	if (sh_veu_check_op(op) < 0)
+		return -1;
+
+	prep->op = *op;
+	sh_veu_prepare(prep);
+
+	return 0;
+}
+
+void
+shveu_prepared_start(unsigned int veu_index, const struct shveu_prepared *prep)
+{
+	/* Held until shveu_wait() */
+	sh_veu_acquire(veu_index, SHVEU_PRIORITY_NORMAL, 0.0);
+
+	sh_veu_dedup_started(veu_index);
+	sh_veu_program(prep);
+}
+
+void
+shveu_prepared_operation(unsigned int veu_index, const struct shveu_prepared *prep)
+{
+	sh_veu_prepared_operation(veu_index, prep, SHVEU_PRIORITY_NORMAL, 0.0);
 }
 
 
@@ -0,0 +1,555 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Software fallback for VEU operations
+ *
+ * There is a kernel for each combination of source format, destination
+ * format and filter or rotation, generated by KERNEL() from the same inline
+ * functions with the formats as constants, so that the compiler removes
+ * the format switches from the inner loops. shveu_cpu_operation() picks
+ * the kernel from a table once per operation.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_cpu.h"
+#include "shveu/veu_overlay.h"
+
+#include "shveu_internal.h"
+#include "shveu_pixel.h"
+
+/* Integer colour matrices, with 8 fractional bits */
+struct matrix {
+	int y_offset;
+	int y2r[5];	/* Y, Cr to R, Cb to G, Cr to G, Cb to B */
+	int r2y[9];	/* rows Y, Cb, Cr; columns R, G, B */
+};
+
+/* Indexed by the SHVEU_FULL_RANGE and SHVEU_BT709 flags, as for VMCR in
+ * shveu_start() */
+static const struct matrix matrices[4] = {
+	/* BT.601 limited range */
+	{ 16, { 298, 409, -100, -208, 516 },
+	  { 66, 129, 25, -38, -74, 112, 112, -94, -18 } },
+	/* BT.601 full range */
+	{ 0, { 256, 359, -88, -183, 454 },
+	  { 77, 150, 29, -43, -85, 128, 128, -107, -21 } },
+	/* BT.709 limited range */
+	{ 16, { 298, 459, -55, -136, 541 },
+	  { 47, 157, 16, -26, -86, 112, 112, -102, -10 } },
+	/* BT.709 full range */
+	{ 0, { 256, 403, -48, -120, 475 },
+	  { 54, 183, 19, -29, -99, 128, 128, -116, -12 } },
+};
+
+#define FMT_FLAGS (SHVEU_FULL_RANGE | SHVEU_BT709)
+
+/* An operation, with the checks done */
+struct cpu_op {
+	const unsigned char *src_y, *src_c;
+	unsigned long src_width, src_height, src_pitch;
+	unsigned char *dst_y, *dst_c;
+	unsigned long dst_width, dst_height, dst_pitch;
+	const struct matrix *m;
+	struct sh_veu_stats_acc *acc;	/* statistics of the output, or NULL */
+	const struct shveu_layer *layers;	/* blended onto RGB output */
+	int nr_layers;
+};
+
+typedef void (*kernel_t)(const struct cpu_op *op);
+
+/* Blend the layers onto line y of the destination once it is written,
+ * while it is still in the cache, then add it to the statistics */
+static ALWAYS_INLINE void finish_row(const struct cpu_op *op,
+				     shveu_format_t dst_fmt, unsigned long y)
+{
+	if (op->nr_layers > 0)
+		sh_veu_blend_line(op->dst_y, op->dst_width, op->dst_pitch,
+				  dst_fmt == SHVEU_RGB565_BE, op->layers,
+				  op->nr_layers, y);
+	if (op->acc)
+		sh_veu_stats_row(op->acc, op->dst_y, op->dst_c,
+				 op->dst_pitch, dst_fmt, y);
+}
+
+static ALWAYS_INLINE int clip(int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static ALWAYS_INLINE void ycbcr_to_rgb(const struct matrix *m,
+					const struct pixel *in, struct pixel *out)
+{
+	int c = m->y2r[0] * (in->y - m->y_offset);
+	int d = in->cb - 128, e = in->cr - 128;
+
+	out->y  = clip((c + m->y2r[1] * e + 128) >> 8);
+	out->cb = clip((c + m->y2r[2] * d + m->y2r[3] * e + 128) >> 8);
+	out->cr = clip((c + m->y2r[4] * d + 128) >> 8);
+}
+
+static ALWAYS_INLINE void rgb_to_ycbcr(const struct matrix *m,
+					const struct pixel *in, struct pixel *out)
+{
+	int r = in->y, g = in->cb, b = in->cr;
+	const int *k = m->r2y;
+
+	out->y  = clip(((k[0] * r + k[1] * g + k[2] * b + 128) >> 8) + m->y_offset);
+	out->cb = clip(((k[3] * r + k[4] * g + k[5] * b + 128) >> 8) + 128);
+	out->cr = clip(((k[6] * r + k[7] * g + k[8] * b + 128) >> 8) + 128);
+}
+
+static ALWAYS_INLINE void convert_pixel(const struct matrix *m,
+					shveu_format_t src_fmt,
+					shveu_format_t dst_fmt,
+					const struct pixel *in, struct pixel *out)
+{
+	int src_rgb = (src_fmt == SHVEU_RGB565) || (src_fmt == SHVEU_RGB565_BE);
+	int dst_rgb = (dst_fmt == SHVEU_RGB565) || (dst_fmt == SHVEU_RGB565_BE);
+
+	if (src_rgb && !dst_rgb)
+		rgb_to_ycbcr(m, in, out);
+	else if (!src_rgb && dst_rgb)
+		ycbcr_to_rgb(m, in, out);
+	else
+		*out = *in;
+}
+
+/* Scale, sampling the nearest source pixel above and to the left */
+static ALWAYS_INLINE void scale_kernel(const struct cpu_op *op,
+				       shveu_format_t src_fmt,
+				       shveu_format_t dst_fmt)
+{
+	unsigned long step = op->src_width / op->dst_width;
+	unsigned long rem = op->src_width % op->dst_width;
+	unsigned long x, y, sx, sy, r;
+	struct pixel in, out;
+	/* A local copy stays in registers across the byte stores */
+	const struct matrix m = *op->m;
+
+	for (y = 0; y < op->dst_height; y++) {
+		sy = y * op->src_height / op->dst_height;
+
+		/* sx = x * src_width / dst_width, stepped incrementally */
+		sx = 0;
+		r = 0;
+		for (x = 0; x < op->dst_width; x++) {
+			get_pixel(op->src_y, op->src_c, op->src_pitch, src_fmt, sx, sy, &in);
+			convert_pixel(&m, src_fmt, dst_fmt, &in, &out);
+			put_pixel(op->dst_y, op->dst_c, op->dst_pitch, dst_fmt, x, y, &out);
+
+			sx += step;
+			r += rem;
+			if (r >= op->dst_width) {
+				r -= op->dst_width;
+				sx++;
+			}
+		}
+
+		finish_row(op, dst_fmt, y);
+	}
+}
+
+/* Move a pixel w/256 of the way towards another */
+static ALWAYS_INLINE void lerp(struct pixel *a, const struct pixel *b, int w)
+{
+	a->y  += ((b->y  - a->y)  * w + 128) >> 8;
+	a->cb += ((b->cb - a->cb) * w + 128) >> 8;
+	a->cr += ((b->cr - a->cr) * w + 128) >> 8;
+}
+
+/* Scale, interpolating between the four source pixels nearest to the
+ * centre of each destination pixel. Positions are in 16.16 fixed point. */
+static ALWAYS_INLINE void bilinear_kernel(const struct cpu_op *op,
+					  shveu_format_t src_fmt,
+					  shveu_format_t dst_fmt)
+{
+	long xstep = (op->src_width << 16) / op->dst_width;
+	long ystep = (op->src_height << 16) / op->dst_height;
+	long fx, fy;
+	unsigned long x, y, x0, x1, y0, y1;
+	int wx, wy;
+	struct pixel a, b, c, d, out;
+	const struct matrix m = *op->m;
+
+	for (y = 0; y < op->dst_height; y++) {
+		fy = ystep / 2 - 0x8000 + (long)y * ystep;
+		if (fy < 0)
+			fy = 0;
+		y0 = fy >> 16;
+		y1 = (y0 + 1 < op->src_height) ? y0 + 1 : y0;
+		wy = (fy >> 8) & 0xff;
+
+		fx = xstep / 2 - 0x8000;
+		for (x = 0; x < op->dst_width; x++, fx += xstep) {
+			x0 = (fx < 0) ? 0 : fx >> 16;
+			x1 = (x0 + 1 < op->src_width) ? x0 + 1 : x0;
+			wx = (fx < 0) ? 0 : (fx >> 8) & 0xff;
+
+			get_pixel(op->src_y, op->src_c, op->src_pitch, src_fmt, x0, y0, &a);
+			get_pixel(op->src_y, op->src_c, op->src_pitch, src_fmt, x1, y0, &b);
+			get_pixel(op->src_y, op->src_c, op->src_pitch, src_fmt, x0, y1, &c);
+			get_pixel(op->src_y, op->src_c, op->src_pitch, src_fmt, x1, y1, &d);
+			lerp(&a, &b, wx);
+			lerp(&c, &d, wx);
+			lerp(&a, &c, wy);
+
+			convert_pixel(&m, src_fmt, dst_fmt, &a, &out);
+			put_pixel(op->dst_y, op->dst_c, op->dst_pitch, dst_fmt, x, y, &out);
+		}
+
+		finish_row(op, dst_fmt, y);
+	}
+}
+
+/* Scale down, averaging the source pixels covered by each destination
+ * pixel so that detail finer than the destination does not alias */
+static ALWAYS_INLINE void area_kernel(const struct cpu_op *op,
+				      shveu_format_t src_fmt,
+				      shveu_format_t dst_fmt)
+{
+	unsigned long x, y, sx, sy, x0, x1, y0, y1, n;
+	unsigned long sum_y, sum_cb, sum_cr;
+	struct pixel in, out;
+	const struct matrix m = *op->m;
+
+	for (y = 0; y < op->dst_height; y++) {
+		y0 = y * op->src_height / op->dst_height;
+		y1 = (y + 1) * op->src_height / op->dst_height;
+		if (y1 == y0)
+			y1++;
+
+		for (x = 0; x < op->dst_width; x++) {
+			x0 = x * op->src_width / op->dst_width;
+			x1 = (x + 1) * op->src_width / op->dst_width;
+			if (x1 == x0)
+				x1++;
+
+			sum_y = sum_cb = sum_cr = 0;
+			for (sy = y0; sy < y1; sy++) {
+				for (sx = x0; sx < x1; sx++) {
+					get_pixel(op->src_y, op->src_c, op->src_pitch,
+						  src_fmt, sx, sy, &in);
+					sum_y += in.y;
+					sum_cb += in.cb;
+					sum_cr += in.cr;
+				}
+			}
+
+			n = (x1 - x0) * (y1 - y0);
+			in.y = (sum_y + n / 2) / n;
+			in.cb = (sum_cb + n / 2) / n;
+			in.cr = (sum_cr + n / 2) / n;
+
+			convert_pixel(&m, src_fmt, dst_fmt, &in, &out);
+			put_pixel(op->dst_y, op->dst_c, op->dst_pitch, dst_fmt, x, y, &out);
+		}
+
+		finish_row(op, dst_fmt, y);
+	}
+}
+
+/* Rotate 90 degrees clockwise */
+static ALWAYS_INLINE void rotate_kernel(const struct cpu_op *op,
+					shveu_format_t src_fmt,
+					shveu_format_t dst_fmt)
+{
+	unsigned long x, y;
+	struct pixel in, out;
+	const struct matrix m = *op->m;
+
+	for (y = 0; y < op->dst_height; y++) {
+		for (x = 0; x < op->dst_width; x++) {
+			get_pixel(op->src_y, op->src_c, op->src_pitch, src_fmt,
+				  y, op->src_height - 1 - x, &in);
+			convert_pixel(&m, src_fmt, dst_fmt, &in, &out);
+			put_pixel(op->dst_y, op->dst_c, op->dst_pitch, dst_fmt, x, y, &out);
+		}
+
+		finish_row(op, dst_fmt, y);
+	}
+}
+
+#define KERNEL(src, dst)						\
+static void scale_##src##_##dst(const struct cpu_op *op)		\
+{									\
+	scale_kernel(op, SHVEU_##src, SHVEU_##dst);			\
+}									\
+static void rotate_##src##_##dst(const struct cpu_op *op)		\
+{									\
+	rotate_kernel(op, SHVEU_##src, SHVEU_##dst);			\
+}									\
+static void bilinear_##src##_##dst(const struct cpu_op *op)		\
+{									\
+	bilinear_kernel(op, SHVEU_##src, SHVEU_##dst);			\
+}									\
+static void area_##src##_##dst(const struct cpu_op *op)		\
+{									\
+	area_kernel(op, SHVEU_##src, SHVEU_##dst);			\
+}
+
+#define KERNELS_FROM(src)						\
+	KERNEL(src, RGB565)						\
+	KERNEL(src, YCbCr420)						\
+	KERNEL(src, YCbCr422)						\
+	KERNEL(src, YCrCb420)						\
+	KERNEL(src, YUYV)						\
+	KERNEL(src, UYVY)						\
+	KERNEL(src, RGB565_BE)						\
+	KERNEL(src, YCbCr444)
+
+KERNELS_FROM(RGB565)
+KERNELS_FROM(YCbCr420)
+KERNELS_FROM(YCbCr422)
+KERNELS_FROM(YCrCb420)
+KERNELS_FROM(YUYV)
+KERNELS_FROM(UYVY)
+KERNELS_FROM(RGB565_BE)
+KERNELS_FROM(YCbCr444)
+
+#define NR_FORMATS 8
+
+/* Kernels of each conversion */
+enum {
+	KERNEL_NEAREST,
+	KERNEL_ROTATE,
+	KERNEL_BILINEAR,
+	KERNEL_AREA,
+	NR_KERNELS
+};
+
+#define KERNELS(src, dst) {						\
+	scale_##src##_##dst, rotate_##src##_##dst,			\
+	bilinear_##src##_##dst, area_##src##_##dst			\
+}
+
+#define KERNEL_ROW(src) {						\
+	KERNELS(src, RGB565),						\
+	KERNELS(src, YCbCr420),						\
+	KERNELS(src, YCbCr422),						\
+	KERNELS(src, YCrCb420),						\
+	KERNELS(src, YUYV),						\
+	KERNELS(src, UYVY),						\
+	KERNELS(src, RGB565_BE),					\
+	KERNELS(src, YCbCr444),						\
+}
+
+/* Indexed by source format, destination format and kernel */
+static const kernel_t kernels[NR_FORMATS][NR_FORMATS][NR_KERNELS] = {
+	KERNEL_ROW(RGB565),
+	KERNEL_ROW(YCbCr420),
+	KERNEL_ROW(YCbCr422),
+	KERNEL_ROW(YCrCb420),
+	KERNEL_ROW(YUYV),
+	KERNEL_ROW(UYVY),
+	KERNEL_ROW(RGB565_BE),
+	KERNEL_ROW(YCbCr444),
+};
+
+static int valid_format(shveu_format_t fmt, int flags)
+{
+	if (fmt & ~(SHVEU_FORMAT_MASK | flags))
+		return 0;
+	if ((fmt & SHVEU_FILTER_MASK) > SHVEU_FILTER_SMOOTH)
+		return 0;
+	return (unsigned int)(fmt & SHVEU_FORMAT_MASK) < NR_FORMATS;
+}
+
+/* Choose the kernel for an operation */
+static int select_kernel(const struct cpu_op *op, shveu_format_t dst_fmt,
+			 shveu_rotation_t rotate)
+{
+	int filter = dst_fmt & SHVEU_FILTER_MASK;
+
+	if (rotate)
+		return KERNEL_ROTATE;
+
+	/* Without scaling, every filter samples the source pixels as is */
+	if (filter == SHVEU_FILTER_FAST ||
+	    (op->src_width == op->dst_width && op->src_height == op->dst_height))
+		return KERNEL_NEAREST;
+
+	if (filter == SHVEU_FILTER_SMOOTH &&
+	    op->dst_width <= op->src_width && op->dst_height <= op->src_height)
+		return KERNEL_AREA;
+
+	return KERNEL_BILINEAR;
+}
+
+static int is_rgb(shveu_format_t fmt)
+{
+	fmt &= SHVEU_FORMAT_MASK;
+	return (fmt == SHVEU_RGB565) || (fmt == SHVEU_RGB565_BE);
+}
+
+static int
+cpu_operation(
+	const void *src_y,
+	const void *src_c,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	void *dst_y,
+	void *dst_c,
+	unsigned long dst_width,
+	unsigned long dst_height,
+	unsigned long dst_pitch,
+	shveu_format_t dst_fmt,
+	shveu_rotation_t rotate,
+	const struct shveu_layer *layers,
+	int nr_layers,
+	struct shveu_stats *stats)
+{
+	struct sh_veu_stats_acc acc;
+	struct cpu_op op = {
+		src_y, src_c, src_width, src_height, src_pitch,
+		dst_y, dst_c, dst_width, dst_height, dst_pitch, NULL,
+		stats ? &acc : NULL, layers, nr_layers
+	};
+	shveu_format_t ycbcr_fmt;
+	int kernel;
+
+	/* Same restrictions as the VEU, so results do not depend on the path */
+	if (rotate && (src_width != dst_height))
+		return -1;
+	if (rotate && (dst_width != src_height))
+		return -1;
+
+	/* The filter applies to the destination */
+	if (!valid_format(src_fmt, FMT_FLAGS) ||
+	    !valid_format(dst_fmt, FMT_FLAGS | SHVEU_FILTER_MASK))
+		return -1;
+
+	if (src_width == 0 || src_height == 0 ||
+	    dst_width == 0 || dst_height == 0)
+		return -1;
+
+	/* Layers are only blended onto RGB */
+	if (nr_layers > 0 && !is_rgb(dst_fmt))
+		return -1;
+
+	if (stats && sh_veu_stats_begin(&acc, stats, dst_width, dst_height, 1) < 0)
+		return -1;
+
+	/* The flags of the YCbCr side describe an RGB conversion */
+	ycbcr_fmt = is_rgb(src_fmt) ? dst_fmt : src_fmt;
+	op.m = &matrices[(ycbcr_fmt & FMT_FLAGS) >> 16];
+
+	kernel = select_kernel(&op, dst_fmt, rotate);
+
+	src_fmt &= SHVEU_FORMAT_MASK;
+	dst_fmt &= SHVEU_FORMAT_MASK;
+	kernels[src_fmt][dst_fmt][kernel](&op);
+
+	if (stats)
+		sh_veu_stats_end(&acc);
+
+	return 0;
+}
+
+int sh_veu_cpu_operation(const struct shveu_op *op, const void *src_y,
+			 const void *src_c, void *dst_y, void *dst_c,
+			 const struct shveu_layer *layers, int nr_layers,
+			 struct shveu_stats *stats)
+{
+	return cpu_operation(
+		src_y, src_c, op->src_width, op->src_height, op->src_pitch,
+		op->src_fmt, dst_y, dst_c, op->dst_width, op->dst_height,
+		op->dst_pitch, op->dst_fmt, op->rotate, layers, nr_layers,
+		stats);
+}
+
+int
+shveu_cpu_operation(
+	const void *src_y,
+	const void *src_c,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	void *dst_y,
+	void *dst_c,
+	unsigned long dst_width,
+	unsigned long dst_height,
+	unsigned long dst_pitch,
+	shveu_format_t dst_fmt,
+	shveu_rotation_t rotate)
+{
+	return cpu_operation(
+		src_y, src_c, src_width, src_height, src_pitch, src_fmt,
+		dst_y, dst_c, dst_width, dst_height, dst_pitch, dst_fmt,
+		rotate, NULL, 0, NULL);
+}
+
+int
+shveu_cpu_operation_stats(
+	const void *src_y,
+	const void *src_c,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	void *dst_y,
+	void *dst_c,
+	unsigned long dst_width,
+	unsigned long dst_height,
+	unsigned long dst_pitch,
+	shveu_format_t dst_fmt,
+	shveu_rotation_t rotate,
+	struct shveu_stats *stats)
+{
+	return cpu_operation(
+		src_y, src_c, src_width, src_height, src_pitch, src_fmt,
+		dst_y, dst_c, dst_width, dst_height, dst_pitch, dst_fmt,
+		rotate, NULL, 0, stats);
+}
+
+int
+shveu_cpu_composite(
+	const void *src_y,
+	const void *src_c,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	void *dst,
+	unsigned long dst_width,
+	unsigned long dst_height,
+	unsigned long dst_pitch,
+	shveu_format_t dst_fmt,
+	shveu_rotation_t rotate,
+	const struct shveu_layer *layers,
+	int nr_layers)
+{
+	if (!is_rgb(dst_fmt))
+		return -1;
+
+	return cpu_operation(
+		src_y, src_c, src_width, src_height, src_pitch, src_fmt,
+		dst, NULL, dst_width, dst_height, dst_pitch, dst_fmt,
+		rotate, layers, nr_layers, NULL);
+}
@@ -0,0 +1,229 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Duplicate frame detection
+ *
+ * The source planes are hashed with several independent 32-bit lanes so
+ * that the inner loop vectorises. Each step is a bijection of the lane
+ * state, so a frame differing from the previous one in a single word can
+ * never produce the same hash.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_dedup.h"
+
+#include "shveu_internal.h"
+
+#define HASH_LANES 4
+#define HASH_PRIME 0x9e3779b1U
+#define HASH_SEED  0x811c9dc5U
+
+struct dedup_state {
+	int enabled;
+	int valid;		/* last holds a completed operation */
+	int pending;		/* next holds an operation in progress */
+	struct shveu_op last;
+	uint32_t last_hash[HASH_LANES];
+	struct shveu_op next;
+	uint32_t next_hash[HASH_LANES];
+	unsigned long skipped;
+};
+
+/* Ignore veu_index as we only support one VEU at the moment */
+static struct dedup_state dedup;
+static pthread_mutex_t dedup_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void hash_row(uint32_t *h, const unsigned char *p, unsigned long len)
+{
+	uint32_t w[HASH_LANES];
+	unsigned long i;
+	int k;
+
+	for (i = 0; i + sizeof(w) <= len; i += sizeof(w)) {
+		memcpy(w, p + i, sizeof(w));
+		for (k = 0; k < HASH_LANES; k++)
+			h[k] = (h[k] ^ w[k]) * HASH_PRIME;
+	}
+
+	for (; i < len; i++)
+		h[0] = (h[0] ^ p[i]) * HASH_PRIME;
+}
+
+static int hash_plane(uint32_t *h, unsigned long phys, unsigned long row_len,
+		      unsigned long rows, unsigned long pitch)
+{
+	const unsigned char *virt;
+	unsigned long y;
+
+	virt = sh_veu_phys_to_virt(phys, (rows - 1) * pitch + row_len);
+	if (virt == NULL)
+		return -1;
+
+	for (y = 0; y < rows; y++)
+		hash_row(h, virt + y * pitch, row_len);
+
+	return 0;
+}
+
+static int hash_source(const struct shveu_op *op, uint32_t *h)
+{
+	unsigned long w = op->src_width, ht = op->src_height;
+	unsigned long pitch = op->src_pitch;
+	int k;
+
+	for (k = 0; k < HASH_LANES; k++)
+		h[k] = HASH_SEED + k;
+
+	if (w == 0 || ht == 0)
+		return -1;
+
+	switch (op->src_fmt & SHVEU_FORMAT_MASK) {
+	case SHVEU_RGB565:
+	case SHVEU_RGB565_BE:
+	case SHVEU_YUYV:
+	case SHVEU_UYVY:
+		return hash_plane(h, op->src_py, w * 2, ht, pitch * 2);
+	case SHVEU_YCbCr420:
+	case SHVEU_YCrCb420:
+		/* The last chroma line of an odd height is shared by one line */
+		if (hash_plane(h, op->src_py, w, ht, pitch) < 0)
+			return -1;
+		return hash_plane(h, op->src_pc, w, (ht + 1) / 2, pitch);
+	case SHVEU_YCbCr422:
+		if (hash_plane(h, op->src_py, w, ht, pitch) < 0)
+			return -1;
+		return hash_plane(h, op->src_pc, w, ht, pitch);
+	case SHVEU_YCbCr444:
+		if (hash_plane(h, op->src_py, w, ht, pitch) < 0)
+			return -1;
+		return hash_plane(h, op->src_pc, w * 2, ht, pitch * 2);
+	default:
+		return -1;
+	}
+}
+
+static int op_equal(const struct shveu_op *a, const struct shveu_op *b)
+{
+	return a->src_py == b->src_py && a->src_pc == b->src_pc &&
+	       a->src_width == b->src_width && a->src_height == b->src_height &&
+	       a->src_pitch == b->src_pitch && a->src_fmt == b->src_fmt &&
+	       a->dst_py == b->dst_py && a->dst_pc == b->dst_pc &&
+	       a->dst_width == b->dst_width && a->dst_height == b->dst_height &&
+	       a->dst_pitch == b->dst_pitch && a->dst_fmt == b->dst_fmt &&
+	       a->rotate == b->rotate;
+}
+
+int sh_veu_dedup_skip(unsigned int veu_index, const struct shveu_op *op)
+{
+	int skip = 0;
+
+	pthread_mutex_lock(&dedup_lock);
+
+	dedup.pending = 0;
+
+	if (!dedup.enabled)
+		goto out;
+
+	if (hash_source(op, dedup.next_hash) < 0) {
+		/* Unknown content: the destination may be overwritten */
+		dedup.valid = 0;
+		goto out;
+	}
+
+	if (dedup.valid &&
+	    op_equal(&dedup.last, op) &&
+	    !memcmp(dedup.last_hash, dedup.next_hash, sizeof(dedup.next_hash))) {
+		dedup.skipped++;
+		skip = 1;
+		goto out;
+	}
+
+	dedup.next = *op;
+	dedup.pending = 1;
+	dedup.valid = 0;
+
+out:
+	pthread_mutex_unlock(&dedup_lock);
+	return skip;
+}
+
+void sh_veu_dedup_started(unsigned int veu_index)
+{
+	/* An operation not checked by sh_veu_dedup_skip() may overwrite
+	 * the previous destination */
+	pthread_mutex_lock(&dedup_lock);
+	if (!dedup.pending)
+		dedup.valid = 0;
+	pthread_mutex_unlock(&dedup_lock);
+}
+
+void sh_veu_dedup_done(unsigned int veu_index, int ret)
+{
+	pthread_mutex_lock(&dedup_lock);
+
+	if (dedup.pending && ret == 0) {
+		dedup.last = dedup.next;
+		memcpy(dedup.last_hash, dedup.next_hash, sizeof(dedup.last_hash));
+		dedup.valid = 1;
+	}
+	dedup.pending = 0;
+
+	pthread_mutex_unlock(&dedup_lock);
+}
+
+void
+shveu_set_skip_duplicates(unsigned int veu_index, int enable)
+{
+	pthread_mutex_lock(&dedup_lock);
+	dedup.enabled = enable;
+	dedup.valid = 0;
+	dedup.pending = 0;
+	dedup.skipped = 0;
+	pthread_mutex_unlock(&dedup_lock);
+}
+
+void
+shveu_invalidate_duplicates(unsigned int veu_index)
+{
+	pthread_mutex_lock(&dedup_lock);
+	dedup.valid = 0;
+	dedup.pending = 0;
+	pthread_mutex_unlock(&dedup_lock);
+}
+
+unsigned long
+shveu_get_skipped_frames(unsigned int veu_index)
+{
+	unsigned long skipped;
+
+	pthread_mutex_lock(&dedup_lock);
+	skipped = dedup.skipped;
+	pthread_mutex_unlock(&dedup_lock);
+
+	return skipped;
+}
@@ -0,0 +1,192 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Dirty rectangle conversion for mostly static framebuffers
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_dirty.h"
+
+/* Horizontal alignment keeps CbCr pairs and plane addresses aligned,
+ * vertical alignment keeps 4:2:0 chroma lines paired */
+#define ALIGN_X 8
+#define ALIGN_Y 2
+
+/* VESSR restriction */
+#define MIN_SIZE 16
+
+/* Convert the whole frame if the dirty area exceeds this percentage */
+#define FULL_FRAME_PERCENT 50
+
+/* Grow r to the alignment and size restrictions, clipped to the frame */
+static void align_rect(struct shveu_rect *r, unsigned long width,
+		       unsigned long height)
+{
+	unsigned long x0, y0, x1, y1;
+
+	x0 = r->x & ~(ALIGN_X - 1UL);
+	y0 = r->y & ~(ALIGN_Y - 1UL);
+	x1 = (r->x + r->width + ALIGN_X - 1) & ~(ALIGN_X - 1UL);
+	y1 = (r->y + r->height + ALIGN_Y - 1) & ~(ALIGN_Y - 1UL);
+
+	if (x1 - x0 < MIN_SIZE)
+		x1 = x0 + MIN_SIZE;
+	if (y1 - y0 < MIN_SIZE)
+		y1 = y0 + MIN_SIZE;
+
+	/* Shift back inside the frame rather than shrinking below the minimum */
+	if (x1 > width) {
+		x0 -= (x1 - width < x0) ? x1 - width : x0;
+		x0 &= ~(ALIGN_X - 1UL);
+		x1 = width;
+	}
+	if (y1 > height) {
+		y0 -= (y1 - height < y0) ? y1 - height : y0;
+		y0 &= ~(ALIGN_Y - 1UL);
+		y1 = height;
+	}
+
+	r->x = x0;
+	r->y = y0;
+	r->width = x1 - x0;
+	r->height = y1 - y0;
+}
+
+/* Overlapping or adjacent */
+static int touching(const struct shveu_rect *a, const struct shveu_rect *b)
+{
+	return (a->x <= b->x + b->width) && (b->x <= a->x + a->width) &&
+	       (a->y <= b->y + b->height) && (b->y <= a->y + a->height);
+}
+
+static void merge_into(struct shveu_rect *a, const struct shveu_rect *b)
+{
+	unsigned long x1, y1;
+
+	x1 = a->x + a->width;
+	y1 = a->y + a->height;
+	if (b->x + b->width > x1)
+		x1 = b->x + b->width;
+	if (b->y + b->height > y1)
+		y1 = b->y + b->height;
+	if (b->x < a->x)
+		a->x = b->x;
+	if (b->y < a->y)
+		a->y = b->y;
+	a->width = x1 - a->x;
+	a->height = y1 - a->y;
+}
+
+/* Merge touching rectangles in place until no more merges are possible.
+ * Returns the new number of rectangles. */
+static int merge_rects(struct shveu_rect *r, int n)
+{
+	int i, j, merged;
+
+	do {
+		merged = 0;
+		for (i = 0; i < n; i++) {
+			for (j = i + 1; j < n; j++) {
+				if (!touching(&r[i], &r[j]))
+					continue;
+				merge_into(&r[i], &r[j]);
+				r[j] = r[--n];
+				merged = 1;
+				j = i;
+			}
+		}
+	} while (merged);
+
+	return n;
+}
+
+int
+shveu_nv12_to_rgb565_rects(
+	unsigned long y_in,
+	unsigned long c_in,
+	unsigned long rgb565_out,
+	unsigned long width,
+	unsigned long height,
+	unsigned long pitch_in,
+	unsigned long pitch_out,
+	const struct shveu_rect *rects,
+	int nr_rects)
+{
+	struct shveu_rect r[SHVEU_MAX_DIRTY_RECTS];
+	unsigned long area = 0;
+	int i, n = 0, ret;
+
+	if (nr_rects <= 0)
+		return 0;
+
+	/* Too many regions to be worth tracking individually */
+	if (nr_rects > SHVEU_MAX_DIRTY_RECTS)
+		goto full_frame;
+
+	for (i = 0; i < nr_rects; i++) {
+		if (rects[i].width == 0 || rects[i].height == 0)
+			continue;
+		if (rects[i].x >= width || rects[i].y >= height)
+			continue;
+
+		r[n] = rects[i];
+		if (r[n].x + r[n].width > width)
+			r[n].width = width - r[n].x;
+		if (r[n].y + r[n].height > height)
+			r[n].height = height - r[n].y;
+
+		align_rect(&r[n], width, height);
+		n++;
+	}
+
+	n = merge_rects(r, n);
+
+	for (i = 0; i < n; i++)
+		area += r[i].width * r[i].height;
+
+	if (area * 100 > width * height * FULL_FRAME_PERCENT)
+		goto full_frame;
+
+	for (i = 0; i < n; i++) {
+		unsigned long y_off = r[i].y * pitch_in + r[i].x;
+		unsigned long c_off = (r[i].y / 2) * pitch_in + r[i].x;
+		unsigned long rgb_off = (r[i].y * pitch_out + r[i].x) * 2;
+
+		ret = shveu_operation(
+			0,
+			y_in + y_off, c_in + c_off, r[i].width, r[i].height,
+			pitch_in, SHVEU_YCbCr420,
+			rgb565_out + rgb_off, 0, r[i].width, r[i].height,
+			pitch_out, SHVEU_RGB565,
+			SHVEU_NO_ROT);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+
+full_frame:
+	return shveu_nv12_to_rgb565(y_in, c_in, rgb565_out,
+				    width, height, pitch_in, pitch_out);
+}
@@ -0,0 +1,259 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Framebuffer output
+ *
+ * When page flipping, buffer 0 is the top half of the virtual screen and
+ * buffer 1 the bottom half. Panning to a buffer's y offset displays it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_cpu.h"
+#include "shveu/veu_fb.h"
+
+#include "shveu_internal.h"
+
+static int map_fb(struct shveu_fb *fb)
+{
+	void *p;
+
+	p = mmap(0, fb->size, PROT_READ | PROT_WRITE, MAP_SHARED, fb->fd, 0);
+	if (p == MAP_FAILED)
+		return -1;
+
+	fb->virt = p;
+	return 0;
+}
+
+static int is_bitfield(const struct fb_bitfield *f,
+		       unsigned int offset, unsigned int length)
+{
+	return (f->offset == offset && f->length == length && !f->msb_right);
+}
+
+int sh_veu_fb_setup(struct shveu_fb *fb, const struct fb_fix_screeninfo *fix,
+		    const struct fb_var_screeninfo *var, int flip)
+{
+	unsigned long frame_size = (unsigned long)var->yres * fix->line_length;
+
+	/* RGB565 only; 16bpp may also be eg. RGB555 or a palette */
+	if (var->bits_per_pixel != 16 || var->grayscale ||
+	    !is_bitfield(&var->red, 11, 5) ||
+	    !is_bitfield(&var->green, 5, 6) ||
+	    !is_bitfield(&var->blue, 0, 5))
+		return -1;
+
+	if (var->xres == 0 || var->yres == 0 ||
+	    fix->line_length < var->xres * 2 || fix->line_length % 2 ||
+	    fix->smem_len < frame_size)
+		return -1;
+
+	fb->phys = fix->smem_start;
+	fb->size = fix->smem_len;
+	fb->width = var->xres;
+	fb->height = var->yres;
+	fb->pitch = fix->line_length / 2;
+	fb->nr_buffers = 1;
+	fb->back = 0;
+
+	if (flip && var->yres_virtual >= 2 * var->yres &&
+	    fix->smem_len >= 2 * frame_size &&
+	    fix->ypanstep != 0 && var->yres % fix->ypanstep == 0) {
+		/* Draw into whichever half is hidden */
+		fb->nr_buffers = 2;
+		fb->back = (var->yoffset >= var->yres) ? 0 : 1;
+	}
+
+	return 0;
+}
+
+struct shveu_fb *
+shveu_fb_open(const char *device, int flip)
+{
+	struct fb_fix_screeninfo fix;
+	struct fb_var_screeninfo var;
+	struct shveu_fb *fb;
+
+	fb = calloc(1, sizeof(*fb));
+	if (fb == NULL)
+		return NULL;
+
+	fb->fd = open(device, O_RDWR);
+	if (fb->fd < 0)
+		goto err_free;
+
+	if (ioctl(fb->fd, FBIOGET_FSCREENINFO, &fix) < 0 ||
+	    ioctl(fb->fd, FBIOGET_VSCREENINFO, &var) < 0)
+		goto err_close;
+
+	if (sh_veu_fb_setup(fb, &fix, &var, flip) < 0)
+		goto err_close;
+
+	if (map_fb(fb) < 0)
+		goto err_close;
+
+	return fb;
+
+err_close:
+	close(fb->fd);
+err_free:
+	free(fb);
+	return NULL;
+}
+
+struct shveu_fb *
+shveu_fb_open_file(
+	const char *path,
+	unsigned long width,
+	unsigned long height,
+	int nr_buffers)
+{
+	struct shveu_fb *fb;
+
+	if (width == 0 || height == 0 || nr_buffers < 1 || nr_buffers > 2)
+		return NULL;
+
+	fb = calloc(1, sizeof(*fb));
+	if (fb == NULL)
+		return NULL;
+
+	fb->width = width;
+	fb->height = height;
+	fb->pitch = width;
+	fb->nr_buffers = nr_buffers;
+	fb->back = nr_buffers - 1;
+	fb->size = width * height * 2 * nr_buffers;
+
+	fb->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fb->fd < 0)
+		goto err_free;
+
+	if (ftruncate(fb->fd, fb->size) < 0 || map_fb(fb) < 0)
+		goto err_close;
+
+	return fb;
+
+err_close:
+	close(fb->fd);
+err_free:
+	free(fb);
+	return NULL;
+}
+
+void
+shveu_fb_close(struct shveu_fb *fb)
+{
+	if (fb == NULL)
+		return;
+
+	munmap(fb->virt, fb->size);
+	close(fb->fd);
+	free(fb);
+}
+
+void *
+shveu_fb_get_buffer(struct shveu_fb *fb, unsigned long *py)
+{
+	unsigned long offset = fb->back * fb->height * fb->pitch * 2;
+
+	if (py)
+		*py = fb->phys ? fb->phys + offset : 0;
+
+	return fb->virt + offset;
+}
+
+int
+shveu_fb_operation(
+	unsigned int veu_index,
+	struct shveu_fb *fb,
+	unsigned long src_py,
+	unsigned long src_pc,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt,
+	shveu_rotation_t rotate)
+{
+	unsigned long dst_py, y_size, c_size;
+	const void *src_y, *src_c = NULL;
+	void *dst;
+
+	dst = shveu_fb_get_buffer(fb, &dst_py);
+
+	if (dst_py)
+		return shveu_operation(veu_index,
+			src_py, src_pc, src_width, src_height, src_pitch, src_fmt,
+			dst_py, 0, fb->width, fb->height, fb->pitch, SHVEU_RGB565,
+			rotate);
+
+	/* Stand-in file: no physical address for the VEU to write to */
+	if (sh_veu_plane_sizes(src_fmt, src_pitch, src_height,
+			       &y_size, &c_size) < 0)
+		return -1;
+	src_y = sh_veu_phys_to_virt(src_py, y_size);
+	if (c_size)
+		src_c = sh_veu_phys_to_virt(src_pc, c_size);
+	if (src_y == NULL || (c_size && src_c == NULL))
+		return -1;
+
+	return shveu_cpu_operation(
+		src_y, src_c, src_width, src_height, src_pitch, src_fmt,
+		dst, NULL, fb->width, fb->height, fb->pitch, SHVEU_RGB565,
+		rotate);
+}
+
+int
+shveu_fb_flip(struct shveu_fb *fb)
+{
+	struct fb_var_screeninfo var;
+
+	if (fb->nr_buffers < 2)
+		return 0;
+
+	if (fb->phys) {
+		if (ioctl(fb->fd, FBIOGET_VSCREENINFO, &var) < 0)
+			goto err;
+		var.xoffset = 0;
+		var.yoffset = fb->back * fb->height;
+		if (ioctl(fb->fd, FBIOPAN_DISPLAY, &var) < 0)
+			goto err;
+	}
+
+	fb->back = !fb->back;
+	return 0;
+
+err:
+	/* Keep drawing into the buffer that is on display */
+	fb->back = !fb->back;
+	fb->nr_buffers = 1;
+	return -1;
+}
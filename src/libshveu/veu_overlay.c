@@ -0,0 +1,183 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Overlay blending
+ *
+ * Pixels are blended in RGB565 with 5-bit alpha. Spreading a pixel as
+ * 00000GGG GGG00000 RRRRR000 000BBBBB leaves 5 spare bits above each
+ * field, so all three channels are multiplied by the alpha at once in a
+ * single 32-bit multiply.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_overlay.h"
+
+#include "shveu_internal.h"
+
+/* Lines of the destination blended at a time, for all layers */
+#define BAND_LINES 16
+
+#define SPREAD_MASK 0x07e0f81f
+
+static inline uint32_t spread(uint32_t c)
+{
+	return (c | (c << 16)) & SPREAD_MASK;
+}
+
+static inline uint16_t unspread(uint32_t x)
+{
+	x &= SPREAD_MASK;
+	return x | (x >> 16);
+}
+
+static inline uint16_t swab16(uint16_t v)
+{
+	return (v << 8) | (v >> 8);
+}
+
+static void blend_row(uint16_t *d, const uint32_t *s, unsigned long n,
+		      unsigned int alpha, int swap)
+{
+	unsigned long i;
+	uint32_t p, c, a, v;
+
+	for (i = 0; i < n; i++) {
+		p = s[i];
+
+		/* Combined alpha, rounded to 0-32 */
+		a = (((p >> 24) * alpha + 255) >> 8);
+		a = (a + 4) >> 3;
+		if (a == 0)
+			continue;
+
+		c = ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+		if (a < 32) {
+			v = swap ? swab16(d[i]) : d[i];
+			c = unspread((spread(c) * a + spread(v) * (32 - a)) >> 5);
+		}
+		d[i] = swap ? swab16(c) : c;
+	}
+}
+
+/* Blend the lines [y0, y1) of the destination that a layer covers */
+static void blend_band(uint16_t *dst, unsigned long width, unsigned long pitch,
+		       const struct shveu_layer *l, long y0, long y1, int swap)
+{
+	const uint32_t *src;
+	long x0 = l->x, x1 = l->x + (long)l->width, y;
+
+	if (y0 < l->y) y0 = l->y;
+	if (y1 > l->y + (long)l->height) y1 = l->y + (long)l->height;
+	if (x0 < 0) x0 = 0;
+	if (x1 > (long)width) x1 = width;
+	if (y0 >= y1 || x0 >= x1)
+		return;
+
+	for (y = y0; y < y1; y++) {
+		src = (const uint32_t *)l->argb + (y - l->y) * l->pitch + (x0 - l->x);
+		blend_row(dst + y * pitch + x0, src, x1 - x0, l->alpha, swap);
+	}
+}
+
+void sh_veu_blend_line(void *dst, unsigned long width, unsigned long pitch,
+		       int swap, const struct shveu_layer *layers,
+		       int nr_layers, unsigned long y)
+{
+	int i;
+
+	for (i = 0; i < nr_layers; i++) {
+		if (layers[i].alpha == 0)
+			continue;
+		blend_band(dst, width, pitch, &layers[i], y, y + 1, swap);
+	}
+}
+
+int
+shveu_blend(
+	void *dst,
+	unsigned long width,
+	unsigned long height,
+	unsigned long pitch,
+	shveu_format_t fmt,
+	const struct shveu_layer *layers,
+	int nr_layers)
+{
+	long top = height, bottom = 0, y, y1;
+	int i, swap;
+
+	fmt &= SHVEU_FORMAT_MASK;
+	if (fmt == SHVEU_RGB565)
+		swap = 0;
+	else if (fmt == SHVEU_RGB565_BE)
+		swap = 1;
+	else
+		return -1;
+
+	/* Only visit the lines that some layer covers */
+	for (i = 0; i < nr_layers; i++) {
+		if (layers[i].alpha == 0 || layers[i].width == 0)
+			continue;
+		if (layers[i].y < top)
+			top = layers[i].y;
+		if (layers[i].y + (long)layers[i].height > bottom)
+			bottom = layers[i].y + (long)layers[i].height;
+	}
+	if (top < 0) top = 0;
+	if (bottom > (long)height) bottom = height;
+
+	for (y = top; y < bottom; y = y1) {
+		y1 = y + BAND_LINES;
+		if (y1 > bottom)
+			y1 = bottom;
+
+		for (i = 0; i < nr_layers; i++) {
+			if (layers[i].alpha == 0)
+				continue;
+			blend_band(dst, width, pitch, &layers[i], y, y1, swap);
+		}
+	}
+
+	return 0;
+}
+
+int
+shveu_composite(
+	unsigned int veu_index,
+	const struct shveu_op *op,
+	const struct shveu_layer *layers,
+	int nr_layers)
+{
+	switch (op->dst_fmt & SHVEU_FORMAT_MASK) {
+	case SHVEU_RGB565:
+	case SHVEU_RGB565_BE:
+		break;
+	default:
+		return -1;
+	}
+
+	return sh_veu_sched_composite(veu_index, op, layers, nr_layers);
+}
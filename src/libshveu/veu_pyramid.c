@@ -0,0 +1,187 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Image pyramid generation.
+ *
+ * Each level is scaled from the previous (already reduced) level rather
+ * than from the full resolution source, so the VEU reads at most a quarter
+ * of the data of the level before it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_pyramid.h"
+#include "shveu/veu_surface.h"
+
+#include "shveu_internal.h"
+
+/* VESSR restrictions on the source of each level */
+#define MIN_SRC_SIZE 16
+#define MAX_SRC_SIZE 4092
+
+#define ALIGN_UP(x, a) (((x) + (a) - 1) & ~((unsigned long)(a) - 1))
+
+/* Lay out up to nr_levels levels starting at pool_py. Returns the number of
+ * levels and sets *size to the number of bytes used. */
+static int layout(struct shveu_pyramid *pyr, unsigned long pool_py,
+		  unsigned long src_width, unsigned long src_height,
+		  shveu_format_t format, int nr_levels, unsigned long *size)
+{
+	unsigned long w = src_width, h = src_height;
+	unsigned long offset = 0;
+	struct shveu_surface surface;
+	int i;
+
+	if (nr_levels > SHVEU_PYRAMID_MAX_LEVELS)
+		nr_levels = SHVEU_PYRAMID_MAX_LEVELS;
+
+	for (i = 0; i < nr_levels; i++) {
+		struct shveu_pyramid_level *lvl = &pyr->level[i];
+
+		/* The previous level (or the source) must be usable as input */
+		if (w < MIN_SRC_SIZE || h < MIN_SRC_SIZE)
+			break;
+
+		/* Halve, keeping dimensions even for chroma subsampling */
+		w = (w / 2) & ~1UL;
+		h = (h / 2) & ~1UL;
+		if (w == 0 || h == 0)
+			break;
+
+		if (shveu_surface_init(&surface, format, w, h, SHVEU_ALIGN_DEFAULT) < 0)
+			return -1;
+
+		lvl->width = w;
+		lvl->height = h;
+		lvl->pitch = surface.pitch;
+
+		offset = ALIGN_UP(offset, surface.align);
+		lvl->py = pool_py + offset;
+		lvl->pc = surface.c_offset ? lvl->py + surface.c_offset : 0;
+		offset += surface.size;
+	}
+
+	*size = offset;
+	return i;
+}
+
+long
+shveu_pyramid_size(
+	unsigned long src_width,
+	unsigned long src_height,
+	shveu_format_t format,
+	int nr_levels)
+{
+	struct shveu_pyramid pyr;
+	unsigned long size;
+	int n;
+
+	if ((src_width > MAX_SRC_SIZE) || (src_height > MAX_SRC_SIZE))
+		return -1;
+
+	n = layout(&pyr, 0, src_width, src_height, format, nr_levels, &size);
+	if (n <= 0)
+		return -1;
+
+	return (long)size;
+}
+
+int
+shveu_pyramid_init(
+	struct shveu_pyramid *pyr,
+	unsigned long pool_py,
+	unsigned long pool_size,
+	unsigned long src_width,
+	unsigned long src_height,
+	shveu_format_t format,
+	int nr_levels)
+{
+	unsigned long size;
+	int n;
+
+	if ((src_width > MAX_SRC_SIZE) || (src_height > MAX_SRC_SIZE))
+		return -1;
+
+	memset(pyr, 0, sizeof(*pyr));
+
+	n = layout(pyr, pool_py, src_width, src_height, format, nr_levels, &size);
+	if (n <= 0 || size > pool_size)
+		return -1;
+
+	pyr->format = format;
+	pyr->nr_levels = n;
+	pyr->pool_py = pool_py;
+	pyr->pool_size = size;
+
+	return n;
+}
+
+int
+shveu_pyramid_generate(
+	unsigned int veu_index,
+	const struct shveu_pyramid *pyr,
+	unsigned long src_py,
+	unsigned long src_pc,
+	unsigned long src_width,
+	unsigned long src_height,
+	unsigned long src_pitch,
+	shveu_format_t src_fmt)
+{
+	const struct shveu_pyramid_level *lvl;
+	int i, ret;
+
+	if (pyr->nr_levels <= 0)
+		return -1;
+
+	/* The pyramid layout was calculated for this source size */
+	if (((src_width / 2) & ~1UL) != pyr->level[0].width ||
+	    ((src_height / 2) & ~1UL) != pyr->level[0].height)
+		return -1;
+
+	/* Each level depends on the previous one, so the levels are issued
+	 * back to back with no CPU work between completion and next start */
+	for (i = 0; i < pyr->nr_levels; i++) {
+		lvl = &pyr->level[i];
+
+		ret = shveu_start(veu_index,
+			src_py, src_pc, src_width, src_height, src_pitch, src_fmt,
+			lvl->py, lvl->pc, lvl->width, lvl->height, lvl->pitch,
+			pyr->format, SHVEU_NO_ROT);
+		if (ret < 0)
+			return ret;
+
+		shveu_wait(veu_index);
+
+		/* The next level is scaled from this one */
+		src_py = lvl->py;
+		src_pc = lvl->pc;
+		src_width = lvl->width;
+		src_height = lvl->height;
+		src_pitch = lvl->pitch;
+		src_fmt = pyr->format;
+	}
+
+	return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * VEU arbitration between threads
+ *
+ * The thread holding the VEU hands it directly to the most urgent waiter
+ * when it is done. Waiters are ordered by effective priority class, then
+ * by deadline, then by order of arrival. Operations without a deadline are
+ * given an implicit one so that they are ordered fairly once promoted.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_queue.h"
+
+#include "shveu_internal.h"
+
+/* Waiting this long promotes an operation by one priority class */
+#define AGING_US 100000.0
+
+struct waiter {
+	struct waiter *next;
+	int priority;
+	double submitted;
+	double deadline;	/* explicit or implicit, absolute time in us */
+	unsigned long seq;
+	int granted;
+};
+
+struct queue_state {
+	int busy;
+	struct waiter *head;
+	unsigned long seq;
+	struct shveu_queue_stats stats;
+};
+
+/* Ignore veu_index as we only support one VEU at the moment */
+static struct queue_state queue;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
+double sh_veu_now_us(void)
+{
+	struct timespec ts;
+
+	/* Unaffected by changes to the time of day */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static int effective_priority(const struct waiter *w, double now)
+{
+	int prio = w->priority - (int)((now - w->submitted) / AGING_US);
+
+	return prio < 0 ? 0 : prio;
+}
+
+/* Returns non-zero if a is more urgent than b */
+static int before(const struct waiter *a, const struct waiter *b, double now)
+{
+	int pa = effective_priority(a, now), pb = effective_priority(b, now);
+
+	if (pa != pb)
+		return pa < pb;
+	if (a->deadline != b->deadline)
+		return a->deadline < b->deadline;
+	return a->seq < b->seq;
+}
+
+void sh_veu_acquire(unsigned int veu_index, int priority, double deadline)
+{
+	struct waiter w, **pp;
+	double now;
+
+	if (priority < 0 || priority >= SHVEU_NR_PRIORITIES)
+		priority = SHVEU_PRIORITY_NORMAL;
+
+	pthread_mutex_lock(&queue_lock);
+
+	if (!queue.busy) {
+		queue.busy = 1;
+		pthread_mutex_unlock(&queue_lock);
+		return;
+	}
+
+	now = sh_veu_now_us();
+
+	memset(&w, 0, sizeof(w));
+	w.priority = priority;
+	w.submitted = now;
+	w.deadline = deadline > 0.0 ? deadline :
+		     now + (priority + 1) * AGING_US;
+	w.seq = queue.seq++;
+
+	for (pp = &queue.head; *pp; pp = &(*pp)->next)
+		;
+	*pp = &w;
+
+	while (!w.granted)
+		pthread_cond_wait(&queue_cond, &queue_lock);
+
+	if (effective_priority(&w, sh_veu_now_us()) < w.priority)
+		queue.stats.promoted++;
+
+	pthread_mutex_unlock(&queue_lock);
+}
+
+void sh_veu_release(unsigned int veu_index)
+{
+	struct waiter **pp, **best = NULL;
+	double now;
+
+	pthread_mutex_lock(&queue_lock);
+
+	now = sh_veu_now_us();
+	for (pp = &queue.head; *pp; pp = &(*pp)->next) {
+		if (best == NULL || before(*pp, *best, now))
+			best = pp;
+	}
+
+	if (best) {
+		struct waiter *w = *best;
+
+		/* Hand over directly; the VEU stays busy */
+		*best = w->next;
+		w->granted = 1;
+		pthread_cond_broadcast(&queue_cond);
+	} else {
+		queue.busy = 0;
+	}
+
+	pthread_mutex_unlock(&queue_lock);
+}
+
+int sh_veu_exec(void *arg, const struct shveu_op *op)
+{
+	unsigned int veu_index = *(unsigned int *)arg;
+
+	return sh_veu_operation(veu_index, op, SHVEU_PRIORITY_NORMAL, 0.0);
+}
+
+int
+shveu_submit(
+	unsigned int veu_index,
+	const struct shveu_op *op,
+	shveu_priority_t priority,
+	unsigned long deadline_us)
+{
+	double deadline = 0.0;
+	int ret;
+
+	if (priority >= SHVEU_NR_PRIORITIES)
+		priority = SHVEU_PRIORITY_NORMAL;
+
+	if (deadline_us)
+		deadline = sh_veu_now_us() + deadline_us;
+
+	ret = sh_veu_operation(veu_index, op, priority, deadline);
+
+	pthread_mutex_lock(&queue_lock);
+	if (ret == 0) {
+		queue.stats.completed[priority]++;
+		if (deadline_us && sh_veu_now_us() > deadline)
+			queue.stats.missed[priority]++;
+	}
+	pthread_mutex_unlock(&queue_lock);
+
+	return ret;
+}
+
+void
+shveu_queue_get_stats(unsigned int veu_index, struct shveu_queue_stats *stats)
+{
+	pthread_mutex_lock(&queue_lock);
+	*stats = queue.stats;
+	pthread_mutex_unlock(&queue_lock);
+}
@@ -0,0 +1,408 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Submission rings and the dispatcher thread
+ *
+ * A ring is an array of entries with three free-running indices. The
+ * producer fills entries at tail, the dispatcher performs them in order and
+ * advances done, and the producer reaps results up to done:
+ *
+ *	reaped <= done <= tail <= reaped + size
+ *
+ * Results are written back into the entry they came from, so the return
+ * ring shares storage with the submission ring and can never overflow.
+ *
+ * Each index has a single writer, so no atomic read-modify-write is needed;
+ * a barrier before publishing an index is enough. The indices sit on their
+ * own cache lines to avoid ping-ponging between the two threads.
+ *
+ * When there is no work the dispatcher polls for a while (on SMP only),
+ * then sets 'sleeping' and waits on the 'wake' futex. A producer only makes
+ * the wake-up syscall if it sees that flag after publishing its entry. Once
+ * woken, the dispatcher yields so that the producer can finish queueing a
+ * burst without waking it again.
+ *
+ * A ring may also have a pipe, written after each operation is completed,
+ * so that the producer can wait for results with poll() alongside other
+ * file descriptors. The producer empties it when it finds nothing to reap,
+ * then checks again: 'done' is always published before the pipe is
+ * written, so no completion can be missed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_ring.h"
+
+#include "shveu_internal.h"
+
+#define CACHE_LINE 64
+
+/* Number of polls for new work before sleeping, on SMP */
+#define SPIN_POLLS 4096
+
+struct ring_entry {
+	struct shveu_op op;
+	void *cookie;
+	int result;
+};
+
+struct shveu_ring {
+	struct shveu_dispatcher *dispatcher;
+	struct ring_entry *entry;
+	uint32_t mask;
+
+	/* Completion pipe: read end, write end (-1 if not created) */
+	int fd[2];
+	volatile int notify;
+
+	/* Written by the producer */
+	volatile uint32_t tail __attribute__ ((aligned (CACHE_LINE)));
+	uint32_t reaped;
+
+	/* Written by the dispatcher */
+	volatile uint32_t done __attribute__ ((aligned (CACHE_LINE)));
+};
+
+struct shveu_dispatcher {
+	pthread_t thread;
+	pthread_mutex_t lock;	/* protects ring[] against create/destroy */
+	struct shveu_ring *ring[SHVEU_MAX_RINGS];
+	unsigned int veu_index;
+	shveu_exec_t exec;
+	void *arg;
+	volatile int quit;
+	int spin;
+
+	volatile uint32_t sleeping __attribute__ ((aligned (CACHE_LINE)));
+	volatile uint32_t wake;
+};
+
+static void notify_done(struct shveu_ring *ring)
+{
+	char c = 0;
+	ssize_t n;
+
+	/* If the pipe is full, it is readable anyway */
+	if (ring->notify)
+		n = write(ring->fd[1], &c, 1);
+}
+
+/* Perform everything queued on one ring. Returns the number of operations */
+static int drain(struct shveu_dispatcher *d, struct shveu_ring *ring)
+{
+	struct ring_entry *e;
+	uint32_t done = ring->done, tail = ring->tail;
+	int n = 0;
+
+	__sync_synchronize();
+
+	while (done != tail) {
+		e = &ring->entry[done & ring->mask];
+		e->result = d->exec(d->arg, &e->op);
+		done++;
+		n++;
+
+		/* Let the producer see each result as soon as it is ready */
+		__sync_synchronize();
+		ring->done = done;
+		notify_done(ring);
+	}
+
+	return n;
+}
+
+static int pending(struct shveu_dispatcher *d)
+{
+	int i;
+
+	for (i = 0; i < SHVEU_MAX_RINGS; i++) {
+		if (d->ring[i] && d->ring[i]->done != d->ring[i]->tail)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void *dispatch_thread(void *arg)
+{
+	struct shveu_dispatcher *d = arg;
+	uint32_t wake;
+	int i, n, spin;
+
+	pthread_mutex_lock(&d->lock);
+
+	while (!d->quit) {
+		n = 0;
+		for (i = 0; i < SHVEU_MAX_RINGS; i++) {
+			if (d->ring[i])
+				n += drain(d, d->ring[i]);
+		}
+		if (n > 0) {
+			/* Give ring create/destroy a chance */
+			pthread_mutex_unlock(&d->lock);
+			pthread_mutex_lock(&d->lock);
+			continue;
+		}
+
+		for (spin = d->spin; spin > 0 && !d->quit; spin--) {
+			if (pending(d))
+				break;
+		}
+		if (spin > 0)
+			continue;
+
+		/* Announce that we are about to sleep, then check again so
+		 * that an entry published meanwhile is not missed */
+		wake = d->wake;
+		d->sleeping = 1;
+		__sync_synchronize();
+		if (!pending(d) && !d->quit) {
+			pthread_mutex_unlock(&d->lock);
+			sh_veu_futex_wait(&d->wake, wake, -1);
+			d->sleeping = 0;
+			sched_yield();
+			pthread_mutex_lock(&d->lock);
+		}
+		d->sleeping = 0;
+	}
+
+	pthread_mutex_unlock(&d->lock);
+
+	return NULL;
+}
+
+static void kick(struct shveu_dispatcher *d)
+{
+	__sync_synchronize();
+	if (d->sleeping) {
+		__sync_fetch_and_add(&d->wake, 1);
+		sh_veu_futex_wake(&d->wake, 1);
+	}
+}
+
+struct shveu_dispatcher *
+shveu_dispatcher_start(unsigned int veu_index, shveu_exec_t exec, void *arg)
+{
+	struct shveu_dispatcher *d;
+
+	if (posix_memalign((void **)&d, CACHE_LINE, sizeof(*d)) != 0)
+		return NULL;
+	memset(d, 0, sizeof(*d));
+
+	pthread_mutex_init(&d->lock, NULL);
+	d->veu_index = veu_index;
+	if (sysconf(_SC_NPROCESSORS_ONLN) > 1)
+		d->spin = SPIN_POLLS;
+	if (exec) {
+		d->exec = exec;
+		d->arg = arg;
+	} else {
+		d->exec = sh_veu_exec;
+		d->arg = &d->veu_index;
+	}
+
+	if (pthread_create(&d->thread, NULL, dispatch_thread, d) != 0) {
+		pthread_mutex_destroy(&d->lock);
+		free(d);
+		return NULL;
+	}
+
+	return d;
+}
+
+void
+shveu_dispatcher_stop(struct shveu_dispatcher *d)
+{
+	if (d == NULL)
+		return;
+
+	d->quit = 1;
+	__sync_fetch_and_add(&d->wake, 1);
+	sh_veu_futex_wake(&d->wake, 1);
+
+	pthread_join(d->thread, NULL);
+	pthread_mutex_destroy(&d->lock);
+	free(d);
+}
+
+struct shveu_ring *
+shveu_ring_create(struct shveu_dispatcher *d, unsigned int size)
+{
+	struct shveu_ring *ring;
+	uint32_t n = 1;
+	int i;
+
+	if (size == 0 || size > (1U << 16))
+		return NULL;
+	while (n < size)
+		n <<= 1;
+
+	if (posix_memalign((void **)&ring, CACHE_LINE, sizeof(*ring)) != 0)
+		return NULL;
+	memset(ring, 0, sizeof(*ring));
+
+	ring->entry = calloc(n, sizeof(struct ring_entry));
+	if (ring->entry == NULL) {
+		free(ring);
+		return NULL;
+	}
+	ring->mask = n - 1;
+	ring->dispatcher = d;
+	ring->fd[0] = ring->fd[1] = -1;
+
+	pthread_mutex_lock(&d->lock);
+	for (i = 0; i < SHVEU_MAX_RINGS; i++) {
+		if (d->ring[i] == NULL) {
+			d->ring[i] = ring;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&d->lock);
+
+	if (i == SHVEU_MAX_RINGS) {
+		free(ring->entry);
+		free(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+void
+shveu_ring_destroy(struct shveu_ring *ring)
+{
+	struct shveu_dispatcher *d;
+	int i;
+
+	if (ring == NULL)
+		return;
+	d = ring->dispatcher;
+
+	while (ring->done != ring->tail) {
+		kick(d);
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&d->lock);
+	for (i = 0; i < SHVEU_MAX_RINGS; i++) {
+		if (d->ring[i] == ring)
+			d->ring[i] = NULL;
+	}
+	pthread_mutex_unlock(&d->lock);
+
+	if (ring->fd[0] >= 0) {
+		close(ring->fd[0]);
+		close(ring->fd[1]);
+	}
+	free(ring->entry);
+	free(ring);
+}
+
+int
+shveu_ring_fd(struct shveu_ring *ring)
+{
+	int i;
+
+	if (ring->fd[0] >= 0)
+		return ring->fd[0];
+
+	if (pipe(ring->fd) < 0) {
+		ring->fd[0] = ring->fd[1] = -1;
+		return -1;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl(ring->fd[i], F_SETFL, O_NONBLOCK);
+		fcntl(ring->fd[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	__sync_synchronize();
+	ring->notify = 1;
+	__sync_synchronize();
+
+	/* Results completed before the dispatcher saw the pipe */
+	if (ring->done != ring->reaped)
+		notify_done(ring);
+
+	return ring->fd[0];
+}
+
+int
+shveu_ring_submit(struct shveu_ring *ring, const struct shveu_op *op,
+		  void *cookie)
+{
+	struct ring_entry *e;
+	uint32_t tail = ring->tail;
+
+	if (tail - ring->reaped > ring->mask)
+		return -1;
+
+	e = &ring->entry[tail & ring->mask];
+	e->op = *op;
+	e->cookie = cookie;
+
+	__sync_synchronize();
+	ring->tail = tail + 1;
+
+	kick(ring->dispatcher);
+
+	return 0;
+}
+
+int
+shveu_ring_reap(struct shveu_ring *ring, void **cookie, int *result)
+{
+	struct ring_entry *e;
+	uint32_t reaped = ring->reaped;
+	char buf[64];
+
+	if (reaped == ring->done) {
+		if (!ring->notify)
+			return 0;
+
+		/* Empty the pipe, then look again for results completed
+		 * meanwhile, whose notifications may have been discarded */
+		while (read(ring->fd[0], buf, sizeof(buf)) == sizeof(buf))
+			;
+		__sync_synchronize();
+		if (reaped == ring->done)
+			return 0;
+	}
+
+	__sync_synchronize();
+	e = &ring->entry[reaped & ring->mask];
+	if (cookie)
+		*cookie = e->cookie;
+	if (result)
+		*result = e->result;
+	ring->reaped = reaped + 1;
+
+	return 1;
+}
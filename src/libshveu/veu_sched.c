@@ -0,0 +1,400 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Cost model driven scheduling between the VEU and the CPU
+ *
+ * The cost of an operation on each path is modelled as a fixed setup cost
+ * plus a cost per output pixel. Both terms are fitted to measured
+ * completion times by an exponentially weighted least squares fit, so the
+ * model tracks changes in bus load and clock speed.
+ *
+ * The CPU is modelled separately for images in cached memory and for
+ * images only reachable through the uncached VEU memory mapping, which
+ * the CPU reads and writes several times more slowly.
+ *
+ * Only the path that performs an operation is measured, so a path whose
+ * cost is overestimated would otherwise never be chosen to correct it.
+ * When one path has been passed over for EXPLORE_INTERVAL operations in
+ * a row, the next operation is given to it instead.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_dedup.h"
+#include "shveu/veu_overlay.h"
+#include "shveu/veu_queue.h"
+#include "shveu/veu_sched.h"
+#include "shveu/veu_stats.h"
+
+#include "shveu_internal.h"
+
+/* Weight of each new measurement in the cost model */
+#define MODEL_ALPHA 0.1
+
+/* Use the initial estimates until this many measurements were taken */
+#define MODEL_MIN_SAMPLES 4
+
+/* With SHVEU_SCHED_PREFER_HW, the CPU must be this much faster */
+#define PREFER_HW_FACTOR 2.0
+
+/* Give a path passed over this many times in a row the next operation */
+#define EXPLORE_INTERVAL 64
+
+struct cost_model {
+	unsigned long samples;
+	double x, y, xx, xy;	/* weighted means of pixels, us, pixels^2, pixels*us */
+	double setup0, slope0;	/* initial estimates */
+	unsigned long idle;	/* operations given to the other path since last used */
+};
+
+struct sched_state {
+	pthread_mutex_t lock;	/* protects everything below */
+	shveu_sched_policy_t policy;
+	double hw_backlog;	/* estimated us of work waiting for the VEU */
+	struct cost_model hw, cpu, cpu_uncached;
+	unsigned long hw_ops, cpu_ops;
+};
+
+/* Ignore veu_index as we only support one VEU at the moment */
+static struct sched_state sched = {
+	PTHREAD_MUTEX_INITIALIZER,
+	SHVEU_SCHED_PREFER_HW,
+	0.0,
+	{ 0, 0.0, 0.0, 0.0, 0.0, 200.0, 0.02, 0 },
+	{ 0, 0.0, 0.0, 0.0, 0.0, 5.0, 0.10, 0 },
+	{ 0, 0.0, 0.0, 0.0, 0.0, 5.0, 0.40, 0 },
+	0, 0
+};
+
+static void model_update(struct cost_model *m, double x, double y)
+{
+	if (m->samples++ == 0) {
+		m->x = x;
+		m->y = y;
+		m->xx = x * x;
+		m->xy = x * y;
+		return;
+	}
+
+	m->x  += MODEL_ALPHA * (x - m->x);
+	m->y  += MODEL_ALPHA * (y - m->y);
+	m->xx += MODEL_ALPHA * (x * x - m->xx);
+	m->xy += MODEL_ALPHA * (x * y - m->xy);
+}
+
+static void model_params(const struct cost_model *m, double *setup,
+			 double *slope)
+{
+	double var;
+
+	if (m->samples < MODEL_MIN_SAMPLES) {
+		*setup = m->setup0;
+		*slope = m->slope0;
+		return;
+	}
+
+	var = m->xx - m->x * m->x;
+	if (var > 1.0)
+		*slope = (m->xy - m->x * m->y) / var;
+	else
+		*slope = -1.0;
+
+	/* All measurements of one size: keep the initial split */
+	if (*slope < 0.0)
+		*slope = (m->x > 0.0) ? (m->y - m->setup0) / m->x : m->slope0;
+	if (*slope < 0.0)
+		*slope = 0.0;
+
+	*setup = m->y - *slope * m->x;
+	if (*setup < 0.0)
+		*setup = 0.0;
+}
+
+static double model_predict(const struct cost_model *m, double pixels)
+{
+	double setup, slope;
+
+	model_params(m, &setup, &slope);
+
+	return setup + slope * pixels;
+}
+
+/* Map an image for the CPU. Returns -1 if not possible. Sets *cached if
+ * every plane is in a cached range. */
+static int map_image(unsigned long py, unsigned long pc, unsigned long pitch,
+		     unsigned long height, shveu_format_t fmt, void **y,
+		     void **c, int *cached)
+{
+	unsigned long y_size, c_size;
+
+	if (sh_veu_plane_sizes(fmt, pitch, height, &y_size, &c_size) < 0)
+		return -1;
+	*y = sh_veu_phys_to_virt(py, y_size);
+	*c = c_size ? sh_veu_phys_to_virt(pc, c_size) : NULL;
+	if (*y == NULL || (c_size && *c == NULL))
+		return -1;
+	*cached = sh_veu_cache_virt(py, y_size) != NULL &&
+		  (!c_size || sh_veu_cache_virt(pc, c_size) != NULL);
+
+	return 0;
+}
+
+void sh_veu_sched_route(unsigned int veu_index, int hw_ok, int cpu_ok,
+			struct sh_veu_route *route)
+{
+	struct cost_model *cpu, *other;
+	double hw_est, cpu_est;
+	int use_cpu, explore = 0;
+
+	pthread_mutex_lock(&sched.lock);
+
+	cpu = route->cached ? &sched.cpu : &sched.cpu_uncached;
+	hw_est = model_predict(&sched.hw, route->pixels);
+	cpu_est = model_predict(cpu, route->pixels);
+
+	if (!hw_ok) {
+		use_cpu = 1;
+	} else if (!cpu_ok) {
+		use_cpu = 0;
+	} else {
+		switch (sched.policy) {
+		case SHVEU_SCHED_LATENCY:
+			use_cpu = cpu_est < sched.hw_backlog + hw_est;
+			explore = 1;
+			break;
+		case SHVEU_SCHED_HW_ONLY:
+			use_cpu = 0;
+			break;
+		case SHVEU_SCHED_CPU_ONLY:
+			use_cpu = 1;
+			break;
+		case SHVEU_SCHED_PREFER_HW:
+		default:
+			use_cpu = cpu_est * PREFER_HW_FACTOR <
+				  sched.hw_backlog + hw_est;
+			explore = 1;
+			break;
+		}
+
+		if (explore) {
+			other = use_cpu ? &sched.hw : cpu;
+			if (other->idle >= EXPLORE_INTERVAL)
+				use_cpu = !use_cpu;
+		}
+
+		if (use_cpu) {
+			cpu->idle = 0;
+			sched.hw.idle++;
+		} else {
+			sched.hw.idle = 0;
+			cpu->idle++;
+		}
+	}
+
+	route->cpu = use_cpu;
+	if (use_cpu) {
+		route->estimate = cpu_est;
+	} else {
+		route->estimate = hw_est;
+		sched.hw_backlog += hw_est;
+	}
+
+	pthread_mutex_unlock(&sched.lock);
+}
+
+void sh_veu_sched_done(unsigned int veu_index, const struct sh_veu_route *route,
+		       double elapsed, int ret)
+{
+	struct cost_model *m;
+
+	pthread_mutex_lock(&sched.lock);
+
+	if (route->cpu) {
+		m = route->cached ? &sched.cpu : &sched.cpu_uncached;
+		if (ret == 0)
+			sched.cpu_ops++;
+	} else {
+		m = &sched.hw;
+		sched.hw_backlog -= route->estimate;
+		if (sched.hw_backlog < 0.0)
+			sched.hw_backlog = 0.0;
+		if (ret == 0)
+			sched.hw_ops++;
+	}
+
+	if (ret == 0)
+		model_update(m, route->pixels, elapsed);
+
+	pthread_mutex_unlock(&sched.lock);
+}
+
+static int run_cpu(unsigned int veu_index, const struct shveu_op *op,
+		   const void *src_y, const void *src_c, void *dst_y,
+		   void *dst_c, const struct sh_veu_route *route,
+		   const struct shveu_layer *layers, int nr_layers,
+		   struct shveu_stats *stats)
+{
+	double start, elapsed;
+	int ret;
+
+	start = sh_veu_now_us();
+	ret = sh_veu_cpu_operation(op, src_y, src_c, dst_y, dst_c, layers,
+				   nr_layers, stats);
+	elapsed = sh_veu_now_us() - start;
+
+	/* The destination was written behind the VEU's back */
+	shveu_invalidate_duplicates(veu_index);
+
+	sh_veu_sched_done(veu_index, route, elapsed, ret);
+
+	return ret;
+}
+
+static int run_hw(unsigned int veu_index, const struct shveu_op *op,
+		  const struct sh_veu_route *route)
+{
+	double start, elapsed;
+	int ret;
+
+	start = sh_veu_now_us();
+	ret = sh_veu_operation(veu_index, op, SHVEU_PRIORITY_NORMAL, 0.0);
+	elapsed = sh_veu_now_us() - start;
+
+	sh_veu_sched_done(veu_index, route, elapsed, ret);
+
+	return ret;
+}
+
+void
+shveu_sched_set_policy(unsigned int veu_index, shveu_sched_policy_t policy)
+{
+	pthread_mutex_lock(&sched.lock);
+	sched.policy = policy;
+	pthread_mutex_unlock(&sched.lock);
+}
+
+/* Perform op, blend layers onto its output, and gather the statistics
+ * of the result if stats is set */
+static int
+sched_operation(unsigned int veu_index, const struct shveu_op *op,
+		const struct shveu_layer *layers, int nr_layers,
+		unsigned int step, struct shveu_stats *stats)
+{
+	void *src_y = NULL, *src_c = NULL, *dst_y = NULL, *dst_c = NULL;
+	struct sh_veu_route route;
+	int hw_ok, cpu_ok, dst_ok, src_cached = 0, dst_cached = 0;
+
+	hw_ok = (sh_veu_check_op(op) == 0);
+	dst_ok = (map_image(op->dst_py, op->dst_pc, op->dst_pitch,
+			    op->dst_height, op->dst_fmt, &dst_y, &dst_c,
+			    &dst_cached) == 0);
+	cpu_ok = dst_ok &&
+		 (map_image(op->src_py, op->src_pc, op->src_pitch,
+			    op->src_height, op->src_fmt, &src_y, &src_c,
+			    &src_cached) == 0);
+
+	if (!hw_ok && !cpu_ok)
+		return -1;
+
+	/* Statistics are read back by the CPU */
+	if (stats && (!cpu_ok || step == 0))
+		return -1;
+
+	/* Layers are blended by the CPU */
+	if (nr_layers > 0 && !dst_ok)
+		return -1;
+
+	route.pixels = (double)op->dst_width * op->dst_height;
+	route.cached = src_cached && dst_cached;
+	sh_veu_sched_route(veu_index, hw_ok, cpu_ok, &route);
+
+	if (route.cpu)
+		return run_cpu(veu_index, op, src_y, src_c, dst_y, dst_c, &route,
+			       layers, nr_layers, stats);
+
+	if (run_hw(veu_index, op, &route) < 0)
+		return -1;
+
+	if (nr_layers > 0) {
+		shveu_blend(dst_y, op->dst_width, op->dst_height, op->dst_pitch,
+			    op->dst_fmt, layers, nr_layers);
+
+		/* The destination no longer holds the VEU's output, so the
+		 * next operation must not be skipped as a duplicate of this */
+		shveu_invalidate_duplicates(veu_index);
+	}
+
+	if (stats)
+		return shveu_stats_surface(dst_y, dst_c, op->dst_width,
+					   op->dst_height, op->dst_pitch,
+					   op->dst_fmt, step, stats);
+
+	return 0;
+}
+
+int
+shveu_sched_operation(unsigned int veu_index, const struct shveu_op *op)
+{
+	return sched_operation(veu_index, op, NULL, 0, 1, NULL);
+}
+
+int
+shveu_sched_operation_stats(unsigned int veu_index, const struct shveu_op *op,
+			    unsigned int step, struct shveu_stats *stats)
+{
+	return sched_operation(veu_index, op, NULL, 0, step, stats);
+}
+
+int sh_veu_sched_composite(unsigned int veu_index, const struct shveu_op *op,
+			   const struct shveu_layer *layers, int nr_layers)
+{
+	return sched_operation(veu_index, op, layers, nr_layers, 1, NULL);
+}
+
+void
+shveu_sched_get_stats(unsigned int veu_index, struct shveu_sched_stats *stats)
+{
+	double setup, slope;
+
+	pthread_mutex_lock(&sched.lock);
+
+	stats->hw_ops = sched.hw_ops;
+	stats->cpu_ops = sched.cpu_ops;
+
+	model_params(&sched.hw, &setup, &slope);
+	stats->hw_setup_us = (unsigned long)setup;
+	stats->hw_ns_per_pixel = (unsigned long)(slope * 1000.0);
+
+	model_params(&sched.cpu, &setup, &slope);
+	stats->cpu_setup_us = (unsigned long)setup;
+	stats->cpu_ns_per_pixel = (unsigned long)(slope * 1000.0);
+
+	model_params(&sched.cpu_uncached, &setup, &slope);
+	stats->cpu_uncached_setup_us = (unsigned long)setup;
+	stats->cpu_uncached_ns_per_pixel = (unsigned long)(slope * 1000.0);
+
+	pthread_mutex_unlock(&sched.lock);
+}
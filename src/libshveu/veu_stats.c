@@ -0,0 +1,198 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Image statistics
+ *
+ * Statistics are gathered a line at a time, so that the CPU conversion
+ * kernels can add each line of their output right after writing it. Each
+ * line is walked one grid block at a time, so that the block of a pixel
+ * is known without a division per pixel.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_stats.h"
+
+#include "shveu_internal.h"
+#include "shveu_pixel.h"
+
+#define GRID SHVEU_STATS_GRID
+
+static int is_rgb(shveu_format_t fmt)
+{
+	return (fmt == SHVEU_RGB565) || (fmt == SHVEU_RGB565_BE);
+}
+
+int sh_veu_stats_begin(struct sh_veu_stats_acc *acc, struct shveu_stats *stats,
+		       unsigned long width, unsigned long height,
+		       unsigned int step)
+{
+	if (width == 0 || height == 0 || step == 0)
+		return -1;
+
+	memset(acc, 0, sizeof(*acc));
+	memset(stats, 0, sizeof(*stats));
+	memset(stats->min, 0xff, sizeof(stats->min));
+
+	acc->stats = stats;
+	acc->width = width;
+	acc->height = height;
+	acc->step = step;
+
+	return 0;
+}
+
+static ALWAYS_INLINE void row_kernel(struct sh_veu_stats_acc *acc,
+				     const unsigned char *py,
+				     const unsigned char *pc,
+				     unsigned long pitch, shveu_format_t fmt,
+				     unsigned long y)
+{
+	struct shveu_stats *stats = acc->stats;
+	unsigned long step = acc->step;
+	unsigned long by = y * GRID / acc->height;
+	unsigned long bx, x, x1, n, bsum;
+	unsigned long sum0 = 0, sum1 = 0, sum2 = 0;
+	int min0 = stats->min[0], min1 = stats->min[1], min2 = stats->min[2];
+	int max0 = stats->max[0], max1 = stats->max[1], max2 = stats->max[2];
+	struct pixel p;
+	int l;
+
+	for (bx = 0; bx < GRID; bx++) {
+		/* First sampled pixel of this block */
+		x = (bx * acc->width / GRID + step - 1) / step * step;
+		x1 = (bx + 1) * acc->width / GRID;
+		n = 0;
+		bsum = 0;
+
+		for (; x < x1; x += step) {
+			get_pixel(py, pc, pitch, fmt, x, y, &p);
+
+			if (is_rgb(fmt))
+				l = (77 * p.y + 150 * p.cb + 29 * p.cr + 128) >> 8;
+			else
+				l = p.y;
+
+			stats->histogram[l]++;
+			bsum += l;
+			n++;
+
+			sum0 += p.y;
+			sum1 += p.cb;
+			sum2 += p.cr;
+			if (p.y < min0) min0 = p.y;
+			if (p.y > max0) max0 = p.y;
+			if (p.cb < min1) min1 = p.cb;
+			if (p.cb > max1) max1 = p.cb;
+			if (p.cr < min2) min2 = p.cr;
+			if (p.cr > max2) max2 = p.cr;
+		}
+
+		acc->block_sum[by][bx] += bsum;
+		acc->block_samples[by][bx] += n;
+		stats->samples += n;
+	}
+
+	acc->sum[0] += sum0;
+	acc->sum[1] += sum1;
+	acc->sum[2] += sum2;
+	stats->min[0] = min0; stats->max[0] = max0;
+	stats->min[1] = min1; stats->max[1] = max1;
+	stats->min[2] = min2; stats->max[2] = max2;
+}
+
+#define ROW(fmt)							\
+	case SHVEU_##fmt:						\
+		row_kernel(acc, py, pc, pitch, SHVEU_##fmt, y);		\
+		break;
+
+void sh_veu_stats_row(struct sh_veu_stats_acc *acc, const unsigned char *py,
+		      const unsigned char *pc, unsigned long pitch,
+		      shveu_format_t fmt, unsigned long y)
+{
+	if (y % acc->step)
+		return;
+
+	switch (fmt & SHVEU_FORMAT_MASK) {
+	ROW(RGB565)
+	ROW(YCbCr420)
+	ROW(YCbCr422)
+	ROW(YCrCb420)
+	ROW(YUYV)
+	ROW(UYVY)
+	ROW(RGB565_BE)
+	ROW(YCbCr444)
+	}
+}
+
+void sh_veu_stats_end(struct sh_veu_stats_acc *acc)
+{
+	struct shveu_stats *stats = acc->stats;
+	unsigned long n;
+	int i, j;
+
+	if (stats->samples == 0) {
+		memset(stats->min, 0, sizeof(stats->min));
+		return;
+	}
+
+	for (i = 0; i < 3; i++)
+		stats->mean[i] = (acc->sum[i] + stats->samples / 2) / stats->samples;
+
+	for (i = 0; i < GRID; i++) {
+		for (j = 0; j < GRID; j++) {
+			n = acc->block_samples[i][j];
+			if (n)
+				stats->blocks[i][j] = (acc->block_sum[i][j] + n / 2) / n;
+		}
+	}
+}
+
+int
+shveu_stats_surface(
+	const void *py,
+	const void *pc,
+	unsigned long width,
+	unsigned long height,
+	unsigned long pitch,
+	shveu_format_t fmt,
+	unsigned int step,
+	struct shveu_stats *stats)
+{
+	struct sh_veu_stats_acc acc;
+	unsigned long y, y_size, c_size;
+
+	if (sh_veu_plane_sizes(fmt, pitch, height, &y_size, &c_size) < 0)
+		return -1;
+	if (sh_veu_stats_begin(&acc, stats, width, height, step) < 0)
+		return -1;
+
+	for (y = 0; y < height; y += step)
+		sh_veu_stats_row(&acc, py, pc, pitch, fmt, y);
+
+	sh_veu_stats_end(&acc);
+
+	return 0;
+}
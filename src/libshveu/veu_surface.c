@@ -0,0 +1,141 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/veu_colorspace.h"
+#include "shveu/veu_surface.h"
+
+#include "shveu_internal.h"
+
+#define ALIGN_UP(x, a) (((x) + (a) - 1) & ~((unsigned long)(a) - 1))
+
+/* Alignment of a plane of the given size */
+static unsigned long plane_align(unsigned long size, int policy)
+{
+	if ((policy & SHVEU_ALIGN_PAGES) && size >= SHVEU_LARGE_PLANE)
+		return SHVEU_PAGE_ALIGN;
+	if (policy & SHVEU_ALIGN_LINES)
+		return SHVEU_LINE_ALIGN;
+	return 1;
+}
+
+int sh_veu_surface_pitch(struct shveu_surface *s, shveu_format_t format,
+			 unsigned long width, unsigned long height,
+			 unsigned long pitch)
+{
+	unsigned long bpp, y_size, c_size;
+
+	if (pitch == 0 || height == 0 ||
+	    sh_veu_plane_sizes(format, pitch, height, &y_size, &c_size) < 0)
+		return -1;
+
+	bpp = y_size / (pitch * height);
+
+	memset(s, 0, sizeof(*s));
+	s->format = format;
+	s->width = width;
+	s->height = height;
+	s->pitch = pitch;
+	s->y_line = width * bpp;
+	s->y_stride = pitch * bpp;
+	s->size = y_size;
+	s->align = 1;
+
+	if (c_size) {
+		/* CbCr pairs; 4:4:4 has a pair for every pixel */
+		s->c_line = width;
+		s->c_stride = pitch;
+		if ((format & SHVEU_FORMAT_MASK) == SHVEU_YCbCr444) {
+			s->c_line *= 2;
+			s->c_stride *= 2;
+		}
+		s->c_lines = c_size / s->c_stride;
+		s->c_offset = y_size;
+		s->size += c_size;
+	}
+
+	return 0;
+}
+
+int
+shveu_surface_init(
+	struct shveu_surface *s,
+	shveu_format_t format,
+	unsigned long width,
+	unsigned long height,
+	int policy)
+{
+	unsigned long bpp, pitch, y_size, c_size, c_align;
+
+	if (policy & ~SHVEU_ALIGN_DEFAULT)
+		return -1;
+
+	switch (format & SHVEU_FORMAT_MASK) {
+	case SHVEU_RGB565:
+	case SHVEU_RGB565_BE:
+	case SHVEU_YUYV:
+	case SHVEU_UYVY:
+		bpp = 2;
+		break;
+	default:
+		bpp = 1;
+		break;
+	}
+
+	pitch = width;
+	if (policy & SHVEU_ALIGN_LINES)
+		pitch = ALIGN_UP(width * bpp, SHVEU_LINE_ALIGN) / bpp;
+
+	if (width == 0 ||
+	    sh_veu_surface_pitch(s, format, width, height, pitch) < 0)
+		return -1;
+
+	y_size = s->y_stride * height;
+	s->align = plane_align(y_size, policy);
+
+	if (s->c_lines) {
+		c_size = s->size - y_size;
+		c_align = plane_align(c_size, policy);
+		s->c_offset = ALIGN_UP(y_size, c_align);
+		s->size = s->c_offset + c_size;
+		if (c_align > s->align)
+			s->align = c_align;
+	}
+
+	/* Let surfaces be placed one after another */
+	s->size = ALIGN_UP(s->size, plane_align(0, policy));
+
+	return 0;
+}
+
+int
+shveu_surface_is_packed(const struct shveu_surface *s)
+{
+	if (s->y_stride != s->y_line)
+		return 0;
+	if (s->c_lines && (s->c_stride != s->c_line ||
+			   s->c_offset != s->y_stride * s->height))
+		return 0;
+	return 1;
+}
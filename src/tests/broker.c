@@ -0,0 +1,261 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Broker: ownership of the queue file, slots of clients that die, clients
+ * killed at any point of a submission, and operations on memory the VEU
+ * may not access. Clients are child processes; the broker runs in this
+ * process.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+/* More than the number of job slots */
+#define DEAD_CLIENTS 160
+
+/* Clients submitting jobs until they are killed */
+#define BUSY_CLIENTS 4
+#define KILLED_CLIENTS 200
+
+static char path[64];
+
+static int jobs = 0;
+
+/* Client killed by exec_kill() while waiting for its job */
+static pid_t victim = 0;
+
+static int
+exec_count (void * arg, const struct shveu_op * op)
+{
+	jobs++;
+	return 0;
+}
+
+static int
+exec_kill (void * arg, const struct shveu_op * op)
+{
+	int status;
+
+	kill (victim, SIGKILL);
+	waitpid (victim, &status, 0);
+	victim = 0;
+
+	return 0;
+}
+
+/* Fork a client submitting op, exiting with 0 if the result is expected */
+static pid_t
+client (const struct shveu_op * op, int expected)
+{
+	struct shveu_client * c;
+	pid_t pid;
+	int ret;
+
+	pid = fork ();
+	if (pid != 0)
+		return pid;
+
+	c = shveu_client_connect (path);
+	if (c == NULL)
+		_exit (2);
+
+	ret = shveu_client_operation (c, op);
+	shveu_client_disconnect (c);
+
+	_exit (ret == expected ? 0 : 1);
+}
+
+/* Fork a client submitting op over and over until it is killed */
+static pid_t
+busy_client (const struct shveu_op * op)
+{
+	struct shveu_client * c;
+	pid_t pid;
+
+	pid = fork ();
+	if (pid != 0)
+		return pid;
+
+	c = shveu_client_connect (path);
+	if (c == NULL)
+		_exit (2);
+
+	for (;;)
+		shveu_client_operation (c, op);
+}
+
+/* Dispatch jobs until the client pid exits, and return its exit status */
+static int
+run_client (struct shveu_broker * broker, pid_t pid)
+{
+	int status;
+
+	while (waitpid (pid, &status, WNOHANG) == 0)
+		shveu_broker_dispatch (broker, 10);
+
+	return WIFEXITED (status) ? WEXITSTATUS (status) : -1;
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct shveu_broker * broker;
+	struct shveu_op op;
+	struct stat st;
+	pid_t busy[BUSY_CLIENTS];
+	int i, status, fd;
+
+	snprintf (path, sizeof (path), "/dev/shm/shveu-test.%d", (int)getpid ());
+	memset (&op, 0, sizeof (op));
+
+	INFO ("Queue file left over by a broker that died");
+	fd = open (path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0 || write (fd, "junk", 4) != 4)
+		FAIL ("cannot create queue file");
+	close (fd);
+
+	broker = shveu_broker_open (path, 0600, 0, exec_count, NULL);
+	if (broker == NULL)
+		FAIL ("cannot take over a left over queue file");
+
+	if (stat (path, &st) < 0 || (st.st_mode & 0777) != 0600)
+		FAIL ("queue file does not have the requested mode");
+
+	INFO ("Queue file of a running broker");
+	if (shveu_broker_open (path, 0600, 0, exec_count, NULL) != NULL)
+		FAIL ("second broker opened the queue of a running one");
+	if (access (path, F_OK) < 0)
+		FAIL ("queue file of the running broker removed");
+
+	if (run_client (broker, client (&op, 0)) != 0 || jobs != 1)
+		FAIL ("job not performed");
+
+	shveu_broker_close (broker);
+
+	INFO ("Slots of clients killed while waiting");
+	broker = shveu_broker_open (path, 0600, 0, exec_kill, NULL);
+	if (broker == NULL)
+		FAIL ("cannot reopen queue");
+
+	for (i = 0; i < DEAD_CLIENTS; i++) {
+		victim = client (&op, 0);
+		while (victim != 0) {
+			shveu_broker_dispatch (broker, 10);
+			if (victim != 0 && waitpid (victim, &status, WNOHANG) != 0)
+				FAIL ("client could not claim a slot");
+		}
+	}
+
+	shveu_broker_close (broker);
+
+	INFO ("Clients killed at any point of a submission");
+	broker = shveu_broker_open (path, 0600, 0, exec_count, NULL);
+	if (broker == NULL)
+		FAIL ("cannot reopen queue");
+
+	/* A queue held up by a dead client would never complete the last
+	 * job */
+	alarm (60);
+	for (i = 0; i < BUSY_CLIENTS; i++)
+		busy[i] = busy_client (&op);
+	for (i = 0; i < KILLED_CLIENTS; i++) {
+		shveu_broker_dispatch (broker, 0);
+		usleep (rand () % 500);
+		kill (busy[i % BUSY_CLIENTS], SIGKILL);
+		waitpid (busy[i % BUSY_CLIENTS], &status, 0);
+		busy[i % BUSY_CLIENTS] = busy_client (&op);
+	}
+	for (i = 0; i < BUSY_CLIENTS; i++) {
+		kill (busy[i], SIGKILL);
+		waitpid (busy[i], &status, 0);
+	}
+
+	jobs = 0;
+	if (run_client (broker, client (&op, 0)) != 0 || jobs == 0)
+		FAIL ("job not performed after clients were killed");
+	alarm (0);
+
+	shveu_broker_close (broker);
+
+	INFO ("Operations outside the VEU memory region");
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	broker = shveu_broker_open (path, 0600, 0, exec_count, NULL);
+	if (broker == NULL)
+		FAIL ("cannot reopen queue");
+
+	op.src_py = SIM_MEM_PHYS;
+	op.src_pc = SIM_MEM_PHYS + 176 * 144;
+	op.src_width = op.src_pitch = 176;
+	op.src_height = 144;
+	op.src_fmt = SHVEU_YCbCr420;
+	op.dst_py = SIM_MEM_PHYS + 176 * 144 * 2;
+	op.dst_width = op.dst_pitch = 176;
+	op.dst_height = 144;
+	op.dst_fmt = SHVEU_RGB565;
+
+	jobs = 0;
+	if (run_client (broker, client (&op, 0)) != 0 || jobs != 1)
+		FAIL ("operation within the memory region not performed");
+
+	/* Destination runs past the end of the region */
+	op.dst_py = SIM_MEM_PHYS + SIM_MEM_SIZE - 176 * 2;
+	if (run_client (broker, client (&op, -1)) != 0)
+		FAIL ("operation past the memory region not refused");
+
+	/* Source CbCr plane outside the region */
+	op.dst_py = SIM_MEM_PHYS + 176 * 144 * 2;
+	op.src_pc = 0x80000000UL;
+	if (run_client (broker, client (&op, -1)) != 0)
+		FAIL ("operation outside the memory region not refused");
+
+	/* Size overflowing an unsigned long */
+	op.src_pc = SIM_MEM_PHYS + 176 * 144;
+	op.src_pitch = -2UL;
+	if (run_client (broker, client (&op, -1)) != 0)
+		FAIL ("operation with overflowing size not refused");
+
+	if (jobs != 1)
+		FAIL ("refused operation performed");
+
+	shveu_broker_close (broker);
+	sim_veu_close ();
+
+	if (access (path, F_OK) == 0)
+		FAIL ("queue file not removed");
+
+	exit (0);
+}
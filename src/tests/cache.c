@@ -0,0 +1,221 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Cache maintenance: the ranges written back before the VEU starts and
+ * discarded once it has finished, registration of cached ranges, and the
+ * CPU using the cached mapping, on a simulated non-coherent VEU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_regs.h"
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define W 64
+#define H 32
+
+#define SRC_Y SIM_MEM_PHYS
+#define SRC_C (SIM_MEM_PHYS + W * H)
+#define DST (SIM_MEM_PHYS + 0x10000)
+
+/* The cached mapping of SIM_MEM_PHYS to DST + W * H * 2 */
+#define CACHED_LEN (DST - SIM_MEM_PHYS + W * H * 2)
+static unsigned char cached[CACHED_LEN];
+
+#define MAX_CALLS 64
+
+struct call {
+	int writeback;
+	void *virt;
+	unsigned long phys, len;
+	int started, acked;
+};
+
+static struct call calls[MAX_CALLS];
+static int nr_calls;
+
+static void
+record (int writeback, void *virt, unsigned long phys, unsigned long len)
+{
+	struct call *c;
+
+	if (nr_calls == MAX_CALLS)
+		FAIL ("too many maintenance operations");
+
+	c = &calls[nr_calls++];
+	c->writeback = writeback;
+	c->virt = virt;
+	c->phys = phys;
+	c->len = len;
+	c->started = sim_veu_reg (VESTR) != 0;
+	c->acked = sim_veu_reg (VEVTR) != 0;
+}
+
+static void
+writeback (void *virt, unsigned long phys, unsigned long len, void *data)
+{
+	record (1, virt, phys, len);
+}
+
+static void
+invalidate (void *virt, unsigned long phys, unsigned long len, void *data)
+{
+	record (0, virt, phys, len);
+}
+
+static void
+operation (unsigned long src_w, unsigned long src_h)
+{
+	nr_calls = 0;
+	sim_veu_clear ();
+
+	if (shveu_operation (0, SRC_Y, SRC_C, src_w, src_h, W, SHVEU_YCbCr420,
+			     DST, 0, src_w, src_h, W, SHVEU_RGB565,
+			     SHVEU_NO_ROT) < 0)
+		FAIL ("operation refused");
+}
+
+/* Find a recorded operation on the range, which was performed at the
+ * right time and through the cached mapping */
+static void
+expect (int writeback, unsigned long phys, unsigned long len)
+{
+	int i;
+
+	for (i = 0; i < nr_calls; i++) {
+		if (calls[i].writeback == writeback && calls[i].phys == phys &&
+		    calls[i].len == len)
+			break;
+	}
+	if (i == nr_calls)
+		FAIL ("range not maintained");
+
+	if (calls[i].virt != cached + (phys - SIM_MEM_PHYS))
+		FAIL ("range maintained at the wrong virtual address");
+	if (writeback && calls[i].started)
+		FAIL ("range written back after the VEU started");
+	if (!writeback && !calls[i].acked)
+		FAIL ("range discarded before the VEU finished");
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct shveu_cache_ops ops;
+	struct shveu_op op;
+	unsigned long i;
+
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	ops.writeback = writeback;
+	ops.invalidate = invalidate;
+	ops.data = NULL;
+	shveu_cache_set_ops (&ops);
+
+	INFO ("No maintenance without cached ranges");
+	operation (W, H);
+	if (nr_calls != 0)
+		FAIL ("uncached memory maintained");
+
+	INFO ("Registration");
+	if (shveu_cache_register (cached, SIM_MEM_PHYS, CACHED_LEN) < 0)
+		FAIL ("range refused");
+	if (shveu_cache_register (cached, DST, 16) == 0)
+		FAIL ("overlapping range accepted");
+	if (shveu_cache_unregister (DST) == 0)
+		FAIL ("unknown range removed");
+
+	INFO ("Whole planes");
+	operation (W, H);
+	if (nr_calls != 4)
+		FAIL ("wrong number of maintenance operations");
+	expect (1, SRC_Y, W * H);
+	expect (1, SRC_C, W * H / 2);
+	expect (1, DST, W * H * 2);
+	expect (0, DST, W * H * 2);
+
+	INFO ("Narrow planes line by line");
+	operation (16, 16);
+	if (nr_calls != 16 + 8 + 16 + 16)
+		FAIL ("wrong number of maintenance operations");
+	for (i = 0; i < 16; i++) {
+		expect (1, SRC_Y + i * W, 16);
+		expect (1, DST + i * W * 2, 32);
+		expect (0, DST + i * W * 2, 32);
+	}
+	for (i = 0; i < 8; i++)
+		expect (1, SRC_C + i * W, 16);
+
+	INFO ("Only the cached part of an image");
+	shveu_cache_unregister (SIM_MEM_PHYS);
+	if (shveu_cache_register (cached + (DST - SIM_MEM_PHYS) + W * 2, DST + W * 2,
+				  W * 2) < 0)
+		FAIL ("range refused");
+	operation (W, H);
+	if (nr_calls != 2)
+		FAIL ("wrong number of maintenance operations");
+	expect (1, DST + W * 2, W * 2);
+	expect (0, DST + W * 2, W * 2);
+	shveu_cache_unregister (DST + W * 2);
+
+	INFO ("CPU using the cached mapping");
+	if (shveu_cache_register (cached, SIM_MEM_PHYS, CACHED_LEN) < 0)
+		FAIL ("range refused");
+	for (i = 0; i < W * H * 3 / 2; i++)
+		cached[i] = i * 7;
+	memset (sim_veu_virt (SRC_Y), 0, W * H * 3 / 2);
+
+	memset (&op, 0, sizeof (op));
+	op.src_py = SRC_Y;
+	op.src_pc = SRC_C;
+	op.src_width = op.src_pitch = op.dst_width = op.dst_pitch = W;
+	op.src_height = op.dst_height = H;
+	op.src_fmt = SHVEU_YCbCr420;
+	op.dst_py = DST;
+	op.dst_fmt = SHVEU_RGB565;
+
+	shveu_sched_set_policy (0, SHVEU_SCHED_CPU_ONLY);
+	nr_calls = 0;
+	if (shveu_sched_operation (0, &op) < 0)
+		FAIL ("operation failed");
+	if (nr_calls != 0)
+		FAIL ("memory maintained for the CPU");
+
+	if (shveu_cpu_operation (cached, cached + W * H, W, H, W, SHVEU_YCbCr420,
+				 sim_veu_virt (DST), NULL, W, H, W, SHVEU_RGB565,
+				 SHVEU_NO_ROT) < 0)
+		FAIL ("conversion refused");
+	if (memcmp (cached + (DST - SIM_MEM_PHYS), sim_veu_virt (DST), W * H * 2))
+		FAIL ("CPU did not use the cached mapping");
+
+	shveu_cache_unregister (SIM_MEM_PHYS);
+	shveu_cache_set_ops (NULL);
+	sim_veu_close ();
+
+	exit (0);
+}
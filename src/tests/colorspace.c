@@ -0,0 +1,288 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Colour spaces: the VEU matrix and offsets for BT.601 and BT.709 in
+ * limited and full range, known colours converted on the CPU, and YCbCr
+ * 4:4:4 converted both ways and rotated
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_internal.h"
+#include "shveu_regs.h"
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define W 32
+#define H 32
+
+#define SRC_Y SIM_MEM_PHYS
+#define SRC_C (SIM_MEM_PHYS + 0x4000)
+#define DST_Y (SIM_MEM_PHYS + 0x10000)
+#define DST_C (SIM_MEM_PHYS + 0x14000)
+
+static const int flags[4] = {
+	0, SHVEU_FULL_RANGE, SHVEU_BT709, SHVEU_BT709 | SHVEU_FULL_RANGE
+};
+
+static uint16_t rgb[W * H], rgb2[W * H];
+static unsigned char y[W * H], c[W * H * 2], y2[W * H], c2[W * H * 2];
+
+/* Luma weights of red and blue */
+static void
+weights (int f, double * kr, double * kb)
+{
+	*kr = (f & SHVEU_BT709) ? 0.2126 : 0.299;
+	*kb = (f & SHVEU_BT709) ? 0.0722 : 0.114;
+}
+
+/* Nearest integer */
+static long
+nearest (double v)
+{
+	return (long)(v < 0 ? v - 0.5 : v + 0.5);
+}
+
+/* The VEU matrix coefficient v is within 1 of c, in 14-bit two's
+ * complement with 11 fractional bits */
+static int
+near_coeff (uint32_t v, double c)
+{
+	long d = ((long)v - nearest (c * 2048)) & 0x3fff;
+
+	return d <= 1 || d >= 0x3fff;
+}
+
+static void
+check_veu (void)
+{
+	double kr, kb, kg, sy, sc, m[9];
+	uint32_t vtrcr;
+	int i, f;
+
+	for (f = 0; f < 4; f++) {
+		weights (flags[f], &kr, &kb);
+		kg = 1 - kr - kb;
+		sy = (flags[f] & SHVEU_FULL_RANGE) ? 1 : 255.0 / 219;
+		sc = (flags[f] & SHVEU_FULL_RANGE) ? 1 : 255.0 / 224;
+
+		/* Rows R, G, B; columns Cr, Y, Cb */
+		m[0] = 2 * (1 - kr) * sc;
+		m[1] = m[4] = m[7] = sy;
+		m[2] = m[6] = 0;
+		m[3] = -2 * (1 - kr) * kr / kg * sc;
+		m[5] = -2 * (1 - kb) * kb / kg * sc;
+		m[8] = 2 * (1 - kb) * sc;
+
+		sim_veu_clear ();
+		if (shveu_operation (0, SRC_Y, SRC_C, W, H, W,
+				     SHVEU_YCbCr420 | flags[f], DST_Y, 0, W, H, W,
+				     SHVEU_RGB565, SHVEU_NO_ROT) < 0)
+			FAIL ("operation refused");
+
+		for (i = 0; i < 9; i++)
+			if (!near_coeff (sim_veu_reg (VMCR00 + 4 * i), m[i]))
+				FAIL ("wrong VEU matrix");
+		if (sim_veu_reg (VCOFFR) !=
+		    ((flags[f] & SHVEU_FULL_RANGE) ? 0x00800000 : 0x00800010))
+			FAIL ("wrong VEU offsets");
+
+		vtrcr = sim_veu_reg (VTRCR);
+		if (!(vtrcr & VTRCR_BT709) != !(flags[f] & SHVEU_BT709) ||
+		    !(vtrcr & VTRCR_FULL_COLOR_CONV) != !(flags[f] & SHVEU_FULL_RANGE))
+			FAIL ("wrong VEU conversion mode");
+
+		/* The flags describe the YCbCr side in either direction */
+		sim_veu_clear ();
+		if (shveu_operation (0, SRC_Y, 0, W, H, W, SHVEU_RGB565,
+				     DST_Y, DST_C, W, H, W,
+				     SHVEU_YCbCr420 | flags[f], SHVEU_NO_ROT) < 0)
+			FAIL ("operation refused");
+		vtrcr = sim_veu_reg (VTRCR);
+		if (!(vtrcr & VTRCR_BT709) != !(flags[f] & SHVEU_BT709) ||
+		    !(vtrcr & VTRCR_FULL_COLOR_CONV) != !(flags[f] & SHVEU_FULL_RANGE))
+			FAIL ("wrong VEU conversion mode from RGB");
+	}
+}
+
+static void
+to_ycbcr (const uint16_t * in, unsigned char * out_y, unsigned char * out_c,
+	  shveu_format_t fmt, shveu_rotation_t rotate)
+{
+	if (shveu_cpu_operation (in, NULL, W, H, W, SHVEU_RGB565,
+				 out_y, out_c, W, H, W, fmt, rotate) < 0)
+		FAIL ("conversion refused");
+}
+
+static void
+to_rgb (const unsigned char * in_y, const unsigned char * in_c,
+	shveu_format_t fmt, uint16_t * out)
+{
+	if (shveu_cpu_operation (in_y, in_c, W, H, W, fmt,
+				 out, NULL, W, H, W, SHVEU_RGB565, SHVEU_NO_ROT) < 0)
+		FAIL ("conversion refused");
+}
+
+/* Every pixel of a YCbCr 4:4:4 image is y, cb, cr within 1 */
+static int
+solid (int vy, int vcb, int vcr)
+{
+	int i;
+
+	for (i = 0; i < W * H; i++) {
+		if (y[i] < vy - 1 || y[i] > vy + 1 ||
+		    c[i * 2] < vcb - 1 || c[i * 2] > vcb + 1 ||
+		    c[i * 2 + 1] < vcr - 1 || c[i * 2 + 1] > vcr + 1)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Convert a grey of luma vy to RGB, returning the first pixel */
+static uint16_t
+grey (int vy, int f)
+{
+	memset (y, vy, sizeof (y));
+	memset (c, 128, sizeof (c));
+	to_rgb (y, c, SHVEU_YCbCr444 | f, rgb);
+
+	return rgb[0];
+}
+
+/* a and b are within one step of each channel of each other */
+static int
+close_rgb (uint16_t a, uint16_t b)
+{
+	int ra = a >> 11, ga = (a >> 5) & 0x3f, ba = a & 0x1f;
+	int rb = b >> 11, gb = (b >> 5) & 0x3f, bb = b & 0x1f;
+
+	return ra - rb <= 1 && rb - ra <= 1 && ga - gb <= 1 && gb - ga <= 1 &&
+	       ba - bb <= 1 && bb - ba <= 1;
+}
+
+static void
+check_cpu (void)
+{
+	double kr, kb, sy, sc, r = 248;
+	unsigned long i, seed = 1;
+	int f, off;
+
+	INFO ("Red from RGB on the CPU");
+	for (i = 0; i < W * H; i++)
+		rgb[i] = 0xf800;
+	for (f = 0; f < 4; f++) {
+		weights (flags[f], &kr, &kb);
+		sy = (flags[f] & SHVEU_FULL_RANGE) ? 255 : 219;
+		sc = (flags[f] & SHVEU_FULL_RANGE) ? 255 : 224;
+		off = (flags[f] & SHVEU_FULL_RANGE) ? 0 : 16;
+
+		to_ycbcr (rgb, y, c, SHVEU_YCbCr444 | flags[f], SHVEU_NO_ROT);
+		if (!solid (off + nearest (sy * kr * r / 255),
+			    128 - nearest (sc * kr / (2 - 2 * kb) * r / 255),
+			    128 + nearest (sc / 2 * r / 255)))
+			FAIL ("wrong YCbCr for red");
+	}
+
+	INFO ("Black and white to RGB on the CPU");
+	if (grey (235, 0) != 0xffff || grey (16, 0) != 0x0000)
+		FAIL ("limited range black or white wrong");
+	if (grey (255, SHVEU_FULL_RANGE) != 0xffff ||
+	    grey (0, SHVEU_FULL_RANGE) != 0x0000 ||
+	    grey (16, SHVEU_FULL_RANGE) != 0x1082)
+		FAIL ("full range black or white wrong");
+	if (grey (128, SHVEU_BT709) != grey (128, 0))
+		FAIL ("grey depends on the matrix");
+
+	INFO ("YCbCr 4:4:4 round trip on the CPU");
+	for (i = 0; i < W * H; i++) {
+		seed = seed * 1103515245 + 12345;
+		rgb2[i] = seed >> 16;
+	}
+	for (f = 0; f < 4; f++) {
+		to_ycbcr (rgb2, y, c, SHVEU_YCbCr444 | flags[f], SHVEU_NO_ROT);
+		to_rgb (y, c, SHVEU_YCbCr444 | flags[f], rgb);
+		for (i = 0; i < W * H; i++)
+			if (!close_rgb (rgb[i], rgb2[i]))
+				FAIL ("colour changed by the round trip");
+	}
+
+	INFO ("YCbCr 4:4:4 rotated on the CPU");
+	if (shveu_cpu_operation (rgb2, NULL, W, H, W, SHVEU_RGB565,
+				 rgb, NULL, H, W, H, SHVEU_RGB565, SHVEU_ROT_90) < 0)
+		FAIL ("rotation refused");
+	to_ycbcr (rgb, y2, c2, SHVEU_YCbCr444, SHVEU_NO_ROT);
+	to_ycbcr (rgb2, y, c, SHVEU_YCbCr444, SHVEU_ROT_90);
+	if (memcmp (y, y2, sizeof (y)) || memcmp (c, c2, sizeof (c)))
+		FAIL ("rotated YCbCr 4:4:4 differs");
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct shveu_sched_stats before, after;
+	struct shveu_op op;
+
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	INFO ("VEU matrix and offsets");
+	check_veu ();
+
+	check_cpu ();
+
+	INFO ("YCbCr 4:4:4 rotated on the VEU rejected");
+	if (SHVEU_FORMATS_VALID (SHVEU_YCbCr444, SHVEU_RGB565, 1) ||
+	    SHVEU_FORMATS_VALID (SHVEU_RGB565, SHVEU_YCbCr444, 1) ||
+	    !SHVEU_FORMATS_VALID (SHVEU_YCbCr444, SHVEU_RGB565, 0))
+		FAIL ("wrong formats valid for rotation");
+
+	memset (&op, 0, sizeof (op));
+	op.src_py = SRC_Y;
+	op.src_pc = SRC_C;
+	op.src_width = op.src_height = op.src_pitch = W;
+	op.src_fmt = SHVEU_YCbCr444;
+	op.dst_py = DST_Y;
+	op.dst_width = op.dst_height = op.dst_pitch = W;
+	op.dst_fmt = SHVEU_RGB565;
+	if (sh_veu_check_op (&op) < 0)
+		FAIL ("YCbCr 4:4:4 refused by the VEU");
+	op.rotate = SHVEU_ROT_90;
+	if (sh_veu_check_op (&op) == 0)
+		FAIL ("rotated YCbCr 4:4:4 accepted by the VEU");
+
+	shveu_sched_set_policy (0, SHVEU_SCHED_HW_ONLY);
+	shveu_sched_get_stats (0, &before);
+	if (shveu_sched_operation (0, &op) < 0)
+		FAIL ("operation failed");
+	shveu_sched_get_stats (0, &after);
+	if (after.cpu_ops != before.cpu_ops + 1 || after.hw_ops != before.hw_ops)
+		FAIL ("rotated YCbCr 4:4:4 not performed on the CPU");
+
+	sim_veu_close ();
+
+	exit (0);
+}
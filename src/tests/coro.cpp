@@ -0,0 +1,118 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * C++20 coroutines awaiting operations on a ring: many more coroutines
+ * than ring entries, driven by an event loop polling the ring's file
+ * descriptor, with operations performed by a simulated VEU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstring>
+#include <poll.h>
+
+#include "shveu/shveu.hpp"
+
+extern "C" {
+#include "shveu_tests.h"
+}
+
+using namespace shveu;
+
+#define RING_SIZE 16
+#define NR_TASKS 1000
+#define OPS_PER_TASK 3
+
+/* A coroutine started straight away, which nothing waits for */
+struct Task {
+	struct promise_type {
+		Task get_return_object () { return Task (); }
+		std::suspend_never initial_suspend () noexcept { return {}; }
+		std::suspend_never final_suspend () noexcept { return {}; }
+		void return_void () {}
+		void unhandled_exception () {}
+	};
+};
+
+/* The simulated VEU reports the source width as the result */
+static int
+exec_width (void * arg, const struct shveu_op * op)
+{
+	return (int)op->src_width;
+}
+
+static int finished = 0, wrong = 0;
+
+static Task
+task (Ring & ring, int id)
+{
+	struct shveu_op op;
+	int i;
+
+	std::memset (&op, 0, sizeof (op));
+
+	for (i = 0; i < OPS_PER_TASK; i++) {
+		op.src_width = id * OPS_PER_TASK + i;
+		if (co_await ring (op) != (int)op.src_width)
+			wrong++;
+	}
+
+	finished++;
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct pollfd pfd;
+	int i, resumed = 0;
+
+	Dispatcher dispatcher (0, exec_width);
+	if (!dispatcher)
+		FAIL ("cannot start dispatcher");
+
+	{
+		Ring ring (dispatcher, RING_SIZE);
+		if (!ring || (pfd.fd = ring.fd ()) < 0)
+			FAIL ("cannot create ring");
+		pfd.events = POLLIN;
+
+		INFO ("Starting coroutines");
+		for (i = 0; i < NR_TASKS; i++)
+			task (ring, i);
+		if (finished != 0)
+			FAIL ("coroutine finished before its operations completed");
+
+		INFO ("Event loop");
+		while (finished < NR_TASKS) {
+			if (poll (&pfd, 1, 5000) != 1)
+				FAIL ("timed out waiting for results");
+			resumed += ring.complete ();
+		}
+
+		if (resumed != NR_TASKS * OPS_PER_TASK)
+			FAIL ("coroutines not resumed once per operation");
+		if (wrong)
+			FAIL ("coroutine resumed with the result of another operation");
+	}
+
+	exit (0);
+}
@@ -0,0 +1,139 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * C++ interface: conversions allowed at compile time, ownership of
+ * buffers, and prepared conversions on a simulated VEU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <utility>
+
+#include "shveu/shveu.hpp"
+
+extern "C" {
+#include "shveu_regs.h"
+#include "shveu_tests.h"
+#include "sim_veu.h"
+}
+
+using namespace shveu;
+
+typedef Image<NV12, 176, 144> QcifNV12;
+typedef Image<RGB565, 176, 144> QcifRGB;
+typedef Image<RGB565, 144, 176> QcifRGBRotated;
+
+/* Formats */
+static_assert (can_convert<Image<NV12>, Image<RGB565> >::value, "NV12 to RGB565");
+static_assert (can_convert<Image<NV21>, Image<RGB565BE> >::value, "NV21 to RGB");
+static_assert (!can_convert<Image<NV12>, Image<NV21> >::value, "NV21 written");
+static_assert (!can_convert<Image<NV21>, Image<NV12> >::value, "NV21 to YCbCr");
+static_assert (!can_convert<Image<NV24>, Image<RGB565>, SHVEU_ROT_90>::value, "NV24 rotated");
+
+/* Fixed geometry */
+static_assert (can_convert<QcifNV12, QcifRGB>::value, "QCIF");
+static_assert (can_convert<QcifNV12, QcifRGBRotated, SHVEU_ROT_90>::value, "rotation");
+static_assert (!can_convert<QcifNV12, QcifRGB, SHVEU_ROT_90>::value, "rotation of a non-square size");
+static_assert (!can_convert<QcifNV12, Image<RGB565, 352, 288>, SHVEU_ROT_90>::value,
+	       "rotation with scaling");
+static_assert (can_convert<QcifNV12, Image<RGB565, 1408, 1152> >::value, "8x upscale");
+static_assert (!can_convert<QcifNV12, Image<RGB565, 1410, 1152> >::value, "9x upscale");
+static_assert (!can_convert<Image<NV12, 8, 8>, Image<RGB565, 16, 16> >::value, "tiny source");
+
+/* Geometry known only at run time is checked when preparing */
+static_assert (can_convert<Image<NV12>, QcifRGB, SHVEU_ROT_90>::value, "run-time geometry");
+
+/* The same rules in C */
+SHVEU_STATIC_CHECK_OP (176, 144, 176, SHVEU_YCbCr420, 352, 288, 352, SHVEU_RGB565, SHVEU_NO_ROT);
+
+static int released = 0;
+
+static void
+release (void * ctx, void * virt, std::size_t size)
+{
+	released++;
+}
+
+#define QCIF_NV12_SIZE (176 * 144 * 3 / 2)
+
+int
+main (int argc, char * argv[])
+{
+	static char mem[2][4096];
+
+	INFO ("Buffer ownership");
+	{
+		Buffer a (mem[0], SIM_MEM_PHYS, 4096, release);
+		Buffer b (std::move (a));
+
+		if (a || !b || b.phys () != SIM_MEM_PHYS)
+			FAIL ("buffer not moved");
+
+		a = Buffer (mem[1], SIM_MEM_PHYS + 4096, 4096, release);
+		a = std::move (b);
+		if (released != 1)
+			FAIL ("buffer not released when replaced");
+	}
+	if (released != 2)
+		FAIL ("buffers not released exactly once");
+
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	Buffer src_buf (sim_veu_virt (SIM_MEM_PHYS), SIM_MEM_PHYS, QCIF_NV12_SIZE);
+	Buffer dst_buf (sim_veu_virt (SIM_MEM_PHYS + 0x10000), SIM_MEM_PHYS + 0x10000, 176 * 144 * 2);
+
+	INFO ("Image layout in a buffer");
+	QcifNV12 src (src_buf);
+	QcifRGB dst (dst_buf);
+	if (src.pc () != SIM_MEM_PHYS + 176 * 144 || src.pitch () != 176)
+		FAIL ("wrong image layout");
+
+	INFO ("Prepared conversion");
+	Conversion<QcifNV12, QcifRGB> conv (0, src, dst);
+	if (!conv)
+		FAIL ("valid conversion refused");
+
+	sim_veu_clear ();
+	conv (QcifNV12 (SIM_MEM_PHYS + 0x20000, SIM_MEM_PHYS + 0x28000),
+	      QcifRGB (SIM_MEM_PHYS + 0x30000, SIM_MEM_PHYS + 0x38000));
+	if (sim_veu_reg (VSAYR) != SIM_MEM_PHYS + 0x20000 ||
+	    sim_veu_reg (VSACR) != SIM_MEM_PHYS + 0x28000 ||
+	    sim_veu_reg (VDAYR) != SIM_MEM_PHYS + 0x30000 ||
+	    sim_veu_reg (VDACR) != SIM_MEM_PHYS + 0x38000)
+		FAIL ("conversion not performed on the images given");
+
+	INFO ("Geometry checked at run time");
+	Image<NV12> odd (SIM_MEM_PHYS, SIM_MEM_PHYS + 176 * 144, 176, 144, 175);
+	Conversion<Image<NV12>, QcifRGB> bad (0, odd, dst);
+	if (bad)
+		FAIL ("conversion with an odd pitch accepted");
+
+	if (convert<SHVEU_ROT_90> (0, Image<NV12> (src_buf, 176, 144, 176), dst) == 0)
+		FAIL ("rotation with scaling accepted");
+	if (convert (0, src, dst) != 0)
+		FAIL ("valid conversion refused");
+
+	sim_veu_close ();
+
+	exit (0);
+}
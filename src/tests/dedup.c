@@ -0,0 +1,120 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Duplicate detection: every byte of the source image, and only those,
+ * takes part in the hash. The source is made reachable without a VEU by
+ * registering it as a cached range.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_internal.h"
+#include "shveu_tests.h"
+
+#define PHYS 0x10000000UL
+#define W 60
+#define H 33			/* odd, so the last CbCr line covers one Y line */
+#define PITCH 64
+
+static unsigned char buf[PITCH * (H + 1) * 2];
+
+static struct shveu_op op = {
+	PHYS, PHYS + PITCH * H, W, H, PITCH, SHVEU_YCbCr420,
+	PHYS + PITCH * (H + 1) * 3 / 2, 0, W, H, PITCH, SHVEU_RGB565,
+	SHVEU_NO_ROT
+};
+
+/* Returns 1 if op would be skipped, and records it if not */
+static int
+skipped (void)
+{
+	if (sh_veu_dedup_skip (0, &op))
+		return 1;
+
+	sh_veu_dedup_started (0);
+	sh_veu_dedup_done (0, 0);
+
+	return 0;
+}
+
+static void
+expect_change (const char * what, unsigned long offset)
+{
+	if (!skipped ())
+		FAIL ("unchanged frame not skipped");
+
+	INFO (what);
+	buf[offset] ^= 0xff;
+	if (skipped ())
+		FAIL ("changed frame skipped");
+}
+
+static void
+expect_no_change (const char * what, unsigned long offset)
+{
+	INFO (what);
+	buf[offset] ^= 0xff;
+	if (!skipped ())
+		FAIL ("frame skipped only for a change outside the image");
+}
+
+int
+main (int argc, char * argv[])
+{
+	unsigned long c = PITCH * H;
+
+	memset (buf, 0x55, sizeof (buf));
+
+	if (shveu_cache_register (buf, PHYS, sizeof (buf)) < 0)
+		FAIL ("cannot register source range");
+
+	shveu_set_skip_duplicates (0, 1);
+
+	INFO ("First frame");
+	if (skipped ())
+		FAIL ("first frame skipped");
+
+	expect_change ("Change in first Y byte", 0);
+	expect_change ("Change in last Y byte", (H - 1) * PITCH + W - 1);
+	expect_change ("Change in first CbCr byte", c);
+	expect_change ("Change in last CbCr byte of odd height", c + (H / 2) * PITCH + W - 1);
+
+	expect_no_change ("Change in Y pitch padding", PITCH - 1);
+	expect_no_change ("Change in CbCr pitch padding", c + PITCH - 1);
+
+	INFO ("Invalidation");
+	shveu_invalidate_duplicates (0);
+	if (skipped ())
+		FAIL ("frame skipped after invalidation");
+
+	if (shveu_get_skipped_frames (0) != 6)
+		FAIL ("wrong number of skipped frames");
+
+	shveu_set_skip_duplicates (0, 0);
+	shveu_cache_unregister (PHYS);
+
+	exit (0);
+}
@@ -0,0 +1,125 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Dirty rectangles: alignment, clipping and merging of the regions, and
+ * falling back to a full-frame conversion, on a simulated VEU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shveu/shveu.h"
+
+#include "shveu_regs.h"
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define W 320
+#define H 240
+#define PITCH_IN 336
+#define PITCH_OUT 320
+
+#define Y_IN SIM_MEM_PHYS
+#define C_IN (SIM_MEM_PHYS + PITCH_IN * H)
+#define OUT (SIM_MEM_PHYS + 0x40000)
+
+/* Convert rects, returning 1 if any operation was started */
+static int
+convert (const struct shveu_rect * rects, int n)
+{
+	sim_veu_clear ();
+
+	if (shveu_nv12_to_rgb565_rects (Y_IN, C_IN, OUT, W, H, PITCH_IN, PITCH_OUT,
+					rects, n) < 0)
+		FAIL ("conversion failed");
+
+	return sim_veu_reg (VESTR) != 0;
+}
+
+/* The last operation converted the region at x, y of w by h pixels */
+static int
+converted (unsigned long x, unsigned long y, unsigned long w, unsigned long h)
+{
+	return sim_veu_reg (VSAYR) == Y_IN + y * PITCH_IN + x &&
+	       sim_veu_reg (VSACR) == C_IN + (y / 2) * PITCH_IN + x &&
+	       sim_veu_reg (VDAYR) == OUT + (y * PITCH_OUT + x) * 2 &&
+	       sim_veu_reg (VESSR) == ((h << 16) | w);
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct shveu_rect r[SHVEU_MAX_DIRTY_RECTS + 1];
+	int i;
+
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	INFO ("Small region grown to the alignment and VEU minimum");
+	r[0].x = 13; r[0].y = 7; r[0].width = 3; r[0].height = 3;
+	if (!convert (r, 1) || !converted (8, 6, 16, 16))
+		FAIL ("wrong region converted");
+
+	INFO ("Region in the corner kept inside the frame");
+	r[0].x = W - 2; r[0].y = H - 1; r[0].width = 1; r[0].height = 1;
+	if (!convert (r, 1) || !converted (W - 16, H - 16, 16, 16))
+		FAIL ("wrong region converted");
+
+	INFO ("Region running off the frame clipped");
+	r[0].x = 200; r[0].y = 100; r[0].width = 1000; r[0].height = 20;
+	if (!convert (r, 1) || !converted (200, 100, W - 200, 20))
+		FAIL ("wrong region converted");
+
+	INFO ("Regions outside the frame or empty ignored");
+	r[0].x = W; r[0].y = 0; r[0].width = 16; r[0].height = 16;
+	r[1].x = 0; r[1].y = 0; r[1].width = 0; r[1].height = 16;
+	if (convert (r, 2))
+		FAIL ("region outside the frame converted");
+
+	INFO ("Touching regions merged");
+	r[0].x = 0; r[0].y = 0; r[0].width = 16; r[0].height = 16;
+	r[1].x = 16; r[1].y = 0; r[1].width = 16; r[1].height = 16;
+	r[2].x = 24; r[2].y = 16; r[2].width = 16; r[2].height = 16;
+	if (!convert (r, 3) || !converted (0, 0, 40, 32))
+		FAIL ("touching regions not merged");
+
+	INFO ("Separate regions converted separately");
+	r[1].x = 100; r[1].y = 100;
+	if (!convert (r, 2) || !converted (96, 100, 24, 16))
+		FAIL ("separate regions not converted separately");
+
+	INFO ("Full frame when most of it changed");
+	r[0].x = 0; r[0].y = 0; r[0].width = W; r[0].height = H * 3 / 4;
+	if (!convert (r, 1) || !converted (0, 0, W, H))
+		FAIL ("full frame not converted");
+
+	INFO ("Full frame for too many regions");
+	for (i = 0; i <= SHVEU_MAX_DIRTY_RECTS; i++) {
+		r[i].x = i * 16; r[i].y = (i % 2) * 100;
+		r[i].width = r[i].height = 1;
+	}
+	if (!convert (r, SHVEU_MAX_DIRTY_RECTS + 1) || !converted (0, 0, W, H))
+		FAIL ("full frame not converted");
+
+	sim_veu_close ();
+
+	exit (0);
+}
@@ -0,0 +1,135 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Framebuffer formats and layouts accepted for output, and the stand-in
+ * file
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <linux/fb.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_internal.h"
+#include "shveu_tests.h"
+
+#define W 320
+#define H 240
+
+static struct fb_fix_screeninfo fix;
+static struct fb_var_screeninfo var;
+
+/* A double height RGB565 framebuffer showing its first half */
+static void
+reset (void)
+{
+	memset (&fix, 0, sizeof (fix));
+	memset (&var, 0, sizeof (var));
+
+	fix.smem_start = 0x10000000;
+	fix.line_length = W * 2;
+	fix.smem_len = 2 * H * fix.line_length;
+	fix.ypanstep = 1;
+
+	var.xres = var.xres_virtual = W;
+	var.yres = H;
+	var.yres_virtual = 2 * H;
+	var.bits_per_pixel = 16;
+	var.red.offset = 11; var.red.length = 5;
+	var.green.offset = 5; var.green.length = 6;
+	var.blue.offset = 0; var.blue.length = 5;
+}
+
+static void
+expect_refused (const char * what)
+{
+	struct shveu_fb fb;
+
+	INFO (what);
+	if (sh_veu_fb_setup (&fb, &fix, &var, 1) == 0)
+		FAIL ("framebuffer accepted");
+	reset ();
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct shveu_fb fb, * file;
+	unsigned long py;
+	struct stat st;
+	char path[64];
+
+	INFO ("RGB565 with room for two buffers");
+	reset ();
+	if (sh_veu_fb_setup (&fb, &fix, &var, 1) < 0)
+		FAIL ("RGB565 framebuffer refused");
+	if (fb.nr_buffers != 2 || fb.back != 1 || fb.pitch != W)
+		FAIL ("wrong layout of double buffered framebuffer");
+
+	fb.virt = NULL;
+	shveu_fb_get_buffer (&fb, &py);
+	if (py != fix.smem_start + H * W * 2)
+		FAIL ("back buffer not in the bottom half");
+
+	if (sh_veu_fb_setup (&fb, &fix, &var, 0) < 0 || fb.nr_buffers != 1)
+		FAIL ("page flipping when not asked for");
+
+	INFO ("Virtual resolution larger than the framebuffer memory");
+	fix.smem_len = 2 * H * fix.line_length - 1;
+	if (sh_veu_fb_setup (&fb, &fix, &var, 1) < 0)
+		FAIL ("single buffered framebuffer refused");
+	if (fb.nr_buffers != 1 || fb.back != 0)
+		FAIL ("page flipping beyond the framebuffer memory");
+	reset ();
+
+	fix.smem_len = H * fix.line_length - 1;
+	expect_refused ("Framebuffer memory smaller than one screen");
+
+	var.green.length = 5;
+	expect_refused ("RGB555");
+
+	var.red.offset = 0; var.blue.offset = 11;
+	expect_refused ("BGR565");
+
+	var.bits_per_pixel = 32;
+	expect_refused ("32bpp");
+
+	fix.line_length = W;
+	expect_refused ("Lines shorter than the screen width");
+
+	INFO ("Stand-in file");
+	snprintf (path, sizeof (path), "/tmp/shveu-fb.%d", (int)getpid ());
+	umask (0);
+	file = shveu_fb_open_file (path, W, H, 2);
+	if (file == NULL)
+		FAIL ("cannot create stand-in file");
+	if (stat (path, &st) < 0 || (st.st_mode & 0777) != 0644)
+		FAIL ("stand-in file writable by other users");
+	shveu_fb_close (file);
+	unlink (path);
+
+	exit (0);
+}
@@ -0,0 +1,215 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Alternate layouts: NV21 read by the VEU as NV12 with the Cb and Cr
+ * columns of the matrix exchanged, byte-swapped RGB565 on the VEU, packed
+ * 4:2:2 left to the CPU, and every layout of the same image converted to
+ * the same colours on the CPU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_internal.h"
+#include "shveu_regs.h"
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define W 32
+#define H 16
+
+#define SRC_Y SIM_MEM_PHYS
+#define SRC_C (SIM_MEM_PHYS + W * H)
+#define DST (SIM_MEM_PHYS + 0x10000)
+
+/* NV16 source, the same image in other layouts, and outputs */
+static unsigned char y[W * H], c[W * H];
+static unsigned char nv21[W * H / 2], yuyv[W * H * 2], uyvy[W * H * 2];
+static uint16_t ref[W * H], out[W * H];
+
+static void
+registers (shveu_format_t src_fmt, shveu_format_t dst_fmt, uint32_t * vmcr,
+	   uint32_t * vtrcr, uint32_t * vswpr)
+{
+	int i;
+
+	sim_veu_clear ();
+	if (shveu_operation (0, SRC_Y, SRC_C, W, H, W, src_fmt,
+			     DST, 0, W, H, W, dst_fmt, SHVEU_NO_ROT) < 0)
+		FAIL ("operation refused");
+
+	for (i = 0; i < 9; i++)
+		vmcr[i] = sim_veu_reg (VMCR00 + 4 * i);
+	*vtrcr = sim_veu_reg (VTRCR);
+	*vswpr = sim_veu_reg (VSWPR);
+}
+
+static void
+check_veu (void)
+{
+	uint32_t nv12_vmcr[9], nv21_vmcr[9], nv12_vtrcr, nv21_vtrcr, le, be, dummy;
+	struct shveu_op op;
+	int i;
+
+	INFO ("NV21 on the VEU");
+	registers (SHVEU_YCbCr420, SHVEU_RGB565, nv12_vmcr, &nv12_vtrcr, &dummy);
+	registers (SHVEU_YCrCb420, SHVEU_RGB565, nv21_vmcr, &nv21_vtrcr, &dummy);
+	if (nv21_vtrcr != nv12_vtrcr)
+		FAIL ("NV21 not read as NV12");
+
+	/* Each row of the matrix is Cr, Y, Cb */
+	for (i = 0; i < 9; i += 3) {
+		if (nv21_vmcr[i] != nv12_vmcr[i + 2] ||
+		    nv21_vmcr[i + 1] != nv12_vmcr[i + 1] ||
+		    nv21_vmcr[i + 2] != nv12_vmcr[i])
+			FAIL ("Cb and Cr columns not exchanged for NV21");
+	}
+	if (nv12_vmcr[0] == nv12_vmcr[2])
+		FAIL ("matrix does not tell Cb from Cr");
+
+	INFO ("Byte-swapped RGB565 on the VEU");
+	registers (SHVEU_YCbCr420, SHVEU_RGB565, nv12_vmcr, &dummy, &le);
+	registers (SHVEU_YCbCr420, SHVEU_RGB565_BE, nv12_vmcr, &dummy, &be);
+	if ((le & 0x70) != 0x60 || (be & 0x70) != 0x70)
+		FAIL ("destination bytes not swapped for big-endian RGB565");
+	registers (SHVEU_RGB565_BE, SHVEU_YCbCr420, nv12_vmcr, &dummy, &be);
+	if ((be & 0x7) != 0x7)
+		FAIL ("source bytes not swapped for big-endian RGB565");
+
+	INFO ("Layouts the VEU cannot handle");
+	memset (&op, 0, sizeof (op));
+	op.src_py = SRC_Y;
+	op.src_pc = SRC_C;
+	op.src_width = op.src_pitch = op.dst_width = op.dst_pitch = W;
+	op.src_height = op.dst_height = H;
+	op.dst_py = DST;
+
+	op.src_fmt = SHVEU_YUYV;
+	op.dst_fmt = SHVEU_RGB565;
+	if (sh_veu_check_op (&op) == 0)
+		FAIL ("packed 4:2:2 source accepted by the VEU");
+	op.src_fmt = SHVEU_RGB565;
+	op.dst_fmt = SHVEU_UYVY;
+	if (sh_veu_check_op (&op) == 0)
+		FAIL ("packed 4:2:2 destination accepted by the VEU");
+	op.dst_fmt = SHVEU_YCrCb420;
+	if (sh_veu_check_op (&op) == 0)
+		FAIL ("NV21 destination accepted by the VEU");
+}
+
+static void
+convert (const void * src_y, const void * src_c, shveu_format_t fmt,
+	 shveu_format_t dst_fmt)
+{
+	memset (out, 0, sizeof (out));
+	if (shveu_cpu_operation (src_y, src_c, W, H, W, fmt,
+				 out, NULL, W, H, W, dst_fmt, SHVEU_NO_ROT) < 0)
+		FAIL ("conversion refused");
+}
+
+static void
+check_cpu (void)
+{
+	unsigned long i, j;
+
+	/* NV16, with NV21 from every other chroma line */
+	for (i = 0; i < W * H; i++) {
+		y[i] = i * 7;
+		c[i] = i * 13 + 5;
+	}
+	for (i = 0; i < H / 2; i++) {
+		for (j = 0; j < W; j += 2) {
+			nv21[i * W + j] = c[2 * i * W + j + 1];
+			nv21[i * W + j + 1] = c[2 * i * W + j];
+			/* The same chroma on both lines, as 4:2:0 */
+			c[(2 * i + 1) * W + j] = c[2 * i * W + j];
+			c[(2 * i + 1) * W + j + 1] = c[2 * i * W + j + 1];
+		}
+	}
+	for (i = 0; i < W * H; i += 2) {
+		yuyv[i * 2] = uyvy[i * 2 + 1] = y[i];
+		yuyv[i * 2 + 1] = uyvy[i * 2] = c[i];
+		yuyv[i * 2 + 2] = uyvy[i * 2 + 3] = y[i + 1];
+		yuyv[i * 2 + 3] = uyvy[i * 2 + 2] = c[i + 1];
+	}
+
+	convert (y, c, SHVEU_YCbCr422, SHVEU_RGB565);
+	memcpy (ref, out, sizeof (ref));
+
+	INFO ("NV21 on the CPU");
+	convert (y, nv21, SHVEU_YCrCb420, SHVEU_RGB565);
+	if (memcmp (out, ref, sizeof (out)))
+		FAIL ("NV21 converted to different colours");
+
+	INFO ("Packed 4:2:2 on the CPU");
+	convert (yuyv, NULL, SHVEU_YUYV, SHVEU_RGB565);
+	if (memcmp (out, ref, sizeof (out)))
+		FAIL ("YUYV converted to different colours");
+	convert (uyvy, NULL, SHVEU_UYVY, SHVEU_RGB565);
+	if (memcmp (out, ref, sizeof (out)))
+		FAIL ("UYVY converted to different colours");
+
+	INFO ("Byte-swapped RGB565 on the CPU");
+	convert (y, c, SHVEU_YCbCr422, SHVEU_RGB565_BE);
+	for (i = 0; i < W * H; i++)
+		if (out[i] != (uint16_t)((ref[i] << 8) | (ref[i] >> 8)))
+			FAIL ("big-endian RGB565 not byte-swapped");
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct shveu_sched_stats stats;
+	struct shveu_op op;
+
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	check_veu ();
+	check_cpu ();
+
+	INFO ("Packed 4:2:2 scheduled on the CPU");
+	memset (&op, 0, sizeof (op));
+	op.src_py = SRC_Y;
+	op.src_width = op.src_pitch = op.dst_width = op.dst_pitch = W;
+	op.src_height = op.dst_height = H;
+	op.src_fmt = SHVEU_YUYV;
+	op.dst_py = DST;
+	op.dst_fmt = SHVEU_RGB565;
+
+	memcpy (sim_veu_virt (SRC_Y), yuyv, sizeof (yuyv));
+	memset (sim_veu_virt (DST), 0, sizeof (out));
+	if (shveu_sched_operation (0, &op) < 0)
+		FAIL ("operation failed");
+	shveu_sched_get_stats (0, &stats);
+	if (stats.cpu_ops != 1 || stats.hw_ops != 0)
+		FAIL ("packed 4:2:2 not converted on the CPU");
+	if (memcmp (sim_veu_virt (DST), ref, sizeof (ref)))
+		FAIL ("packed 4:2:2 converted to different colours");
+
+	sim_veu_close ();
+
+	exit (0);
+}
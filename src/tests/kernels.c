@@ -0,0 +1,158 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * CPU kernels: every combination of formats, scaled by nearest neighbour
+ * or rotated, is bit-identical to a plain loop over the pixels with the
+ * formats only known at run time and the BT.601 limited range matrix
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_pixel.h"
+#include "shveu_tests.h"
+
+#define NR_FORMATS 8
+
+#define MAX_SIZE 64
+#define PITCH 72
+
+static const char * names[NR_FORMATS] = {
+	"RGB565", "NV12", "NV16", "NV21", "YUYV", "UYVY", "RGB565 BE", "NV24"
+};
+
+static unsigned char src_y[PITCH * MAX_SIZE * 2], src_c[PITCH * MAX_SIZE * 2];
+static unsigned char ref_y[PITCH * MAX_SIZE * 2], ref_c[PITCH * MAX_SIZE * 2];
+static unsigned char out_y[PITCH * MAX_SIZE * 2], out_c[PITCH * MAX_SIZE * 2];
+
+static int
+is_rgb (shveu_format_t fmt)
+{
+	return fmt == SHVEU_RGB565 || fmt == SHVEU_RGB565_BE;
+}
+
+static int
+clip (int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static void
+convert_pixel (shveu_format_t src_fmt, shveu_format_t dst_fmt,
+	       const struct pixel * in, struct pixel * out)
+{
+	int c = 298 * (in->y - 16), d = in->cb - 128, e = in->cr - 128;
+	int r = in->y, g = in->cb, b = in->cr;
+
+	if (!is_rgb (src_fmt) && is_rgb (dst_fmt)) {
+		out->y  = clip ((c + 409 * e + 128) >> 8);
+		out->cb = clip ((c - 100 * d - 208 * e + 128) >> 8);
+		out->cr = clip ((c + 516 * d + 128) >> 8);
+	} else if (is_rgb (src_fmt) && !is_rgb (dst_fmt)) {
+		out->y  = clip (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+		out->cb = clip (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+		out->cr = clip (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+	} else {
+		*out = *in;
+	}
+}
+
+static void
+reference (shveu_format_t src_fmt, unsigned long src_w, unsigned long src_h,
+	   shveu_format_t dst_fmt, unsigned long dst_w, unsigned long dst_h,
+	   shveu_rotation_t rotate)
+{
+	unsigned long x, y, sx, sy;
+	struct pixel in, out;
+
+	for (y = 0; y < dst_h; y++) {
+		for (x = 0; x < dst_w; x++) {
+			if (rotate) {
+				sx = y;
+				sy = src_h - 1 - x;
+			} else {
+				sx = x * src_w / dst_w;
+				sy = y * src_h / dst_h;
+			}
+			get_pixel (src_y, src_c, PITCH, src_fmt, sx, sy, &in);
+			convert_pixel (src_fmt, dst_fmt, &in, &out);
+			put_pixel (ref_y, ref_c, PITCH, dst_fmt, x, y, &out);
+		}
+	}
+}
+
+static void
+check (unsigned long src_w, unsigned long src_h, unsigned long dst_w,
+       unsigned long dst_h, shveu_rotation_t rotate)
+{
+	shveu_format_t s, d;
+
+	for (s = 0; s < NR_FORMATS; s++) {
+		for (d = 0; d < NR_FORMATS; d++) {
+			memset (ref_y, 0xaa, sizeof (ref_y));
+			memset (ref_c, 0xaa, sizeof (ref_c));
+			memset (out_y, 0xaa, sizeof (out_y));
+			memset (out_c, 0xaa, sizeof (out_c));
+
+			reference (s, src_w, src_h, d, dst_w, dst_h, rotate);
+			if (shveu_cpu_operation (src_y, src_c, src_w, src_h, PITCH, s,
+						 out_y, out_c, dst_w, dst_h, PITCH,
+						 d | SHVEU_FILTER_FAST, rotate) < 0)
+				FAIL ("conversion refused");
+
+			if (memcmp (out_y, ref_y, sizeof (out_y)) ||
+			    memcmp (out_c, ref_c, sizeof (out_c))) {
+				printf ("from %s to %s: ", names[s], names[d]);
+				FAIL ("output differs from the reference");
+			}
+		}
+	}
+}
+
+int
+main (int argc, char * argv[])
+{
+	unsigned long i, seed = 1;
+
+	for (i = 0; i < sizeof (src_y); i++) {
+		seed = seed * 1103515245 + 12345;
+		src_y[i] = seed >> 16;
+		src_c[i] = seed >> 8;
+	}
+
+	INFO ("Same size");
+	check (48, 32, 48, 32, SHVEU_NO_ROT);
+
+	INFO ("Scaling down by an uneven ratio");
+	check (62, 46, 36, 26, SHVEU_NO_ROT);
+
+	INFO ("Scaling up by an uneven ratio");
+	check (26, 18, 64, 44, SHVEU_NO_ROT);
+
+	INFO ("Rotation");
+	check (40, 24, 24, 40, SHVEU_ROT_90);
+
+	exit (0);
+}
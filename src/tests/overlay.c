@@ -0,0 +1,270 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Overlay blending: the packed blend against each channel blended on its
+ * own, blending during a CPU conversion against blending afterwards, and
+ * composited frames with duplicate detection on a simulated VEU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define W 64
+#define H 48
+#define PITCH 72
+
+/* Source images, up to twice the size of the destination */
+#define SRC_PITCH (W * 2)
+
+#define LW 40
+#define LH 30
+
+static uint32_t argb[LH * LW];
+static uint16_t ref[H * PITCH], out[H * PITCH];
+static unsigned char src[H * 2 * SRC_PITCH * 2];
+
+static uint32_t seed = 1;
+
+static uint32_t
+rnd (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static uint16_t
+swab16 (uint16_t v)
+{
+	return (v << 8) | (v >> 8);
+}
+
+/* One channel of width bits at shift, blended with 5-bit alpha a */
+static unsigned int
+channel (unsigned int c, unsigned int v, unsigned int a, int shift, int bits)
+{
+	unsigned int mask = (1 << bits) - 1;
+
+	c = (c >> shift) & mask;
+	v = (v >> shift) & mask;
+
+	return ((c * a + v * (32 - a)) >> 5) << shift;
+}
+
+/* A layer pixel blended onto a destination pixel, a channel at a time */
+static uint16_t
+blend_pixel (uint16_t d, uint32_t p, unsigned int alpha)
+{
+	unsigned int a, c;
+
+	a = (((p >> 24) * alpha + 255) >> 8);
+	a = (a + 4) >> 3;
+	if (a == 0)
+		return d;
+
+	c = ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+	if (a == 32)
+		return c;
+
+	return channel (c, d, a, 11, 5) | channel (c, d, a, 5, 6) | channel (c, d, a, 0, 5);
+}
+
+static void
+reference_blend (uint16_t * dst, const struct shveu_layer * l, int swap)
+{
+	long x, y;
+	uint16_t d;
+
+	for (y = 0; y < H; y++) {
+		for (x = 0; x < W; x++) {
+			if (x < l->x || x >= l->x + (long)l->width ||
+			    y < l->y || y >= l->y + (long)l->height)
+				continue;
+
+			d = swap ? swab16 (dst[y * PITCH + x]) : dst[y * PITCH + x];
+			d = blend_pixel (d, argb[(y - l->y) * l->pitch + (x - l->x)], l->alpha);
+			dst[y * PITCH + x] = swap ? swab16 (d) : d;
+		}
+	}
+}
+
+static void
+fill (void)
+{
+	unsigned long i;
+
+	for (i = 0; i < LW * LH; i++)
+		argb[i] = rnd () | (rnd () << 24);
+	/* Fully transparent and fully opaque pixels */
+	argb[0] &= 0x00ffffff;
+	argb[1] |= 0xff000000;
+
+	for (i = 0; i < H * PITCH; i++)
+		ref[i] = rnd ();
+	for (i = 0; i < sizeof (src); i++)
+		src[i] = rnd ();
+}
+
+static struct shveu_layer layers[2] = {
+	{ argb, LW, LH, LW, -7, -5, 255 },
+	{ argb, LW, LH, LW, 35, 25, 160 },
+};
+
+static void
+check_blend (shveu_format_t fmt)
+{
+	int i;
+
+	fill ();
+	memcpy (out, ref, sizeof (out));
+
+	for (i = 0; i < 2; i++)
+		reference_blend (ref, &layers[i], fmt == SHVEU_RGB565_BE);
+	if (shveu_blend (out, W, H, PITCH, fmt, layers, 2) < 0)
+		FAIL ("blend refused");
+
+	if (memcmp (out, ref, sizeof (out)))
+		FAIL ("blended pixels differ from each channel blended on its own");
+}
+
+/* Blending during a CPU conversion gives the same result as converting
+ * and then blending */
+static void
+check_fused (unsigned long src_w, unsigned long src_h, shveu_format_t src_fmt,
+	     shveu_format_t dst_fmt, shveu_rotation_t rotate)
+{
+	const unsigned char * src_c = src + src_h * SRC_PITCH;
+
+	fill ();
+	memset (ref, 0, sizeof (ref));
+	memset (out, 0, sizeof (out));
+
+	if (shveu_cpu_operation (src, src_c, src_w, src_h, SRC_PITCH, src_fmt,
+				 ref, NULL, W, H, PITCH, dst_fmt, rotate) < 0)
+		FAIL ("conversion refused");
+	if (shveu_blend (ref, W, H, PITCH, dst_fmt, layers, 2) < 0)
+		FAIL ("blend refused");
+
+	if (shveu_cpu_composite (src, src_c, src_w, src_h, SRC_PITCH, src_fmt,
+				 out, W, H, PITCH, dst_fmt, rotate, layers, 2) < 0)
+		FAIL ("composite refused");
+
+	if (memcmp (out, ref, sizeof (out)))
+		FAIL ("blending during conversion differs from blending afterwards");
+}
+
+/* Composite on the simulated VEU, which does not write the destination */
+static void
+check_duplicates (void)
+{
+	struct shveu_op op;
+	unsigned char * p;
+
+	memset (&op, 0, sizeof (op));
+	op.src_py = SIM_MEM_PHYS;
+	op.src_pc = SIM_MEM_PHYS + 176 * 144;
+	op.src_width = op.src_pitch = 176;
+	op.src_height = 144;
+	op.src_fmt = SHVEU_YCbCr420;
+	op.dst_py = SIM_MEM_PHYS + 176 * 144 * 2;
+	op.dst_width = op.dst_pitch = 176;
+	op.dst_height = 144;
+	op.dst_fmt = SHVEU_RGB565;
+
+	p = sim_veu_virt (SIM_MEM_PHYS);
+	memset (p, 0x80, 176 * 144 * 3 / 2);
+	memset (p + 176 * 144 * 2, 0, 176 * 144 * 2);
+
+	shveu_sched_set_policy (0, SHVEU_SCHED_HW_ONLY);
+	shveu_set_skip_duplicates (0, 1);
+
+	if (shveu_sched_operation (0, &op) < 0 || shveu_sched_operation (0, &op) < 0)
+		FAIL ("operation failed");
+	if (shveu_get_skipped_frames (0) != 1)
+		FAIL ("repeated operation not skipped");
+
+	/* The destination holds the VEU's output, so only the blend is needed */
+	if (shveu_composite (0, &op, layers, 2) < 0)
+		FAIL ("composite failed");
+	if (shveu_get_skipped_frames (0) != 2)
+		FAIL ("operation repeating the VEU's output not skipped");
+
+	if (shveu_composite (0, &op, layers, 2) < 0)
+		FAIL ("composite failed");
+	if (shveu_get_skipped_frames (0) != 2)
+		FAIL ("operation skipped after blending onto its output");
+
+	INFO ("Composite on the CPU");
+	shveu_sched_set_policy (0, SHVEU_SCHED_CPU_ONLY);
+	if (shveu_composite (0, &op, layers, 2) < 0)
+		FAIL ("composite failed");
+	if (shveu_sched_operation (0, &op) < 0)
+		FAIL ("operation failed");
+	if (shveu_get_skipped_frames (0) != 2)
+		FAIL ("operation skipped after blending onto its output on the CPU");
+
+	shveu_set_skip_duplicates (0, 0);
+}
+
+int
+main (int argc, char * argv[])
+{
+	INFO ("Blending RGB565");
+	check_blend (SHVEU_RGB565);
+
+	INFO ("Blending byte-swapped RGB565");
+	check_blend (SHVEU_RGB565_BE);
+
+	INFO ("Blending during conversion: nearest neighbour scaling");
+	check_fused (W / 2, H / 2, SHVEU_YCbCr420, SHVEU_RGB565 | SHVEU_FILTER_FAST, SHVEU_NO_ROT);
+
+	INFO ("Blending during conversion: bilinear scaling");
+	check_fused (W / 2, H / 2, SHVEU_YCbCr422, SHVEU_RGB565_BE, SHVEU_NO_ROT);
+
+	INFO ("Blending during conversion: area averaging");
+	check_fused (W * 2, H * 2, SHVEU_YCbCr420, SHVEU_RGB565 | SHVEU_FILTER_SMOOTH, SHVEU_NO_ROT);
+
+	INFO ("Blending during conversion: RGB565 source");
+	check_fused (W, H, SHVEU_RGB565_BE, SHVEU_RGB565, SHVEU_NO_ROT);
+
+	INFO ("Blending during conversion: rotation");
+	check_fused (H, W, SHVEU_YCbCr420, SHVEU_RGB565, SHVEU_ROT_90);
+
+	INFO ("Layers refused for YCbCr output");
+	if (shveu_cpu_composite (src, NULL, W, H, SRC_PITCH, SHVEU_RGB565,
+				 out, W, H, PITCH, SHVEU_YCbCr420, SHVEU_NO_ROT, layers, 2) == 0)
+		FAIL ("layers blended onto YCbCr");
+
+	INFO ("Composite with duplicate detection on the VEU");
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+	check_duplicates ();
+	sim_veu_close ();
+
+	exit (0);
+}
@@ -0,0 +1,115 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Image pyramids: layout of the levels in the pool, and each level scaled
+ * from the one before it on a simulated VEU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shveu/shveu.h"
+
+#include "shveu_regs.h"
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define W 640
+#define H 480
+
+/* Source image, followed by the pool */
+#define SRC_Y SIM_MEM_PHYS
+#define SRC_C (SIM_MEM_PHYS + W * H)
+#define POOL (SIM_MEM_PHYS + 0x80000)
+
+int
+main (int argc, char * argv[])
+{
+	struct shveu_pyramid pyr;
+	const struct shveu_pyramid_level * l, * prev;
+	unsigned long w = W, h = H, end = POOL;
+	long size;
+	int i, n;
+
+	INFO ("Layout");
+	size = shveu_pyramid_size (W, H, SHVEU_YCbCr420, SHVEU_PYRAMID_MAX_LEVELS);
+	if (size <= 0)
+		FAIL ("no pool size");
+
+	if (shveu_pyramid_init (&pyr, POOL, size - 1, W, H, SHVEU_YCbCr420,
+				SHVEU_PYRAMID_MAX_LEVELS) >= 0)
+		FAIL ("pyramid laid out in a pool too small for it");
+
+	n = shveu_pyramid_init (&pyr, POOL, size, W, H, SHVEU_YCbCr420,
+				SHVEU_PYRAMID_MAX_LEVELS);
+	if (n < 2 || n != pyr.nr_levels || (long)pyr.pool_size != size)
+		FAIL ("pyramid not laid out");
+
+	for (i = 0; i < n; i++) {
+		l = &pyr.level[i];
+
+		/* Every level but the last is the source of another */
+		if (w < 16 || h < 16)
+			FAIL ("level scaled from a source smaller than 16x16");
+		if (l->width != ((w / 2) & ~1UL) || l->height != ((h / 2) & ~1UL))
+			FAIL ("level not half the size of the one before it");
+		if (l->py < end || l->pc < l->py + l->pitch * l->height)
+			FAIL ("overlapping planes");
+		if ((l->py - POOL) % 32 || (l->pc - POOL) % 32 || l->pitch % 32)
+			FAIL ("plane or line not aligned to the cache line");
+
+		end = l->pc + l->pitch * l->height / 2;
+		w = l->width;
+		h = l->height;
+	}
+	if (end > POOL + size)
+		FAIL ("level outside the pool");
+	if (n < SHVEU_PYRAMID_MAX_LEVELS && w >= 16 && h >= 16)
+		FAIL ("pyramid stopped while its last level was large enough");
+
+	if (shveu_pyramid_init (&pyr, POOL, size, W, H, SHVEU_YCbCr420, 2) != 2)
+		FAIL ("wrong number of levels when fewer are requested");
+	n = shveu_pyramid_init (&pyr, POOL, size, W, H, SHVEU_YCbCr420,
+				SHVEU_PYRAMID_MAX_LEVELS);
+
+	INFO ("Generation");
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	if (shveu_pyramid_generate (0, &pyr, SRC_Y, SRC_C, W / 2, H, W / 2,
+				    SHVEU_YCbCr420) == 0)
+		FAIL ("source of a different size accepted");
+
+	if (shveu_pyramid_generate (0, &pyr, SRC_Y, SRC_C, W, H, W, SHVEU_YCbCr420) < 0)
+		FAIL ("generation failed");
+
+	/* The last level was scaled from the one before it */
+	prev = &pyr.level[n - 2];
+	l = &pyr.level[n - 1];
+	if (sim_veu_reg (VSAYR) != prev->py || sim_veu_reg (VSACR) != prev->pc ||
+	    sim_veu_reg (VESSR) != ((prev->height << 16) | prev->width) ||
+	    sim_veu_reg (VDAYR) != l->py || sim_veu_reg (VDACR) != l->pc)
+		FAIL ("last level not scaled from the level before it");
+
+	sim_veu_close ();
+
+	exit (0);
+}
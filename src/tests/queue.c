@@ -0,0 +1,190 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+
+/*
+ * VEU arbitration between threads: order of hand over, aging, and the
+ * entry points that wait for the VEU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_internal.h"
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define MS 1000
+
+struct waiter {
+	int priority;
+	double deadline;	/* from now, in us, or 0 for none */
+	int id;
+};
+
+static int order[8];
+static int nr_granted;
+static pthread_mutex_t order_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *
+waiter_thread (void * arg)
+{
+	struct waiter * w = arg;
+	double deadline = 0.0;
+
+	if (w->deadline > 0.0)
+		deadline = sh_veu_now_us () + w->deadline;
+
+	sh_veu_acquire (0, w->priority, deadline);
+
+	pthread_mutex_lock (&order_lock);
+	order[nr_granted++] = w->id;
+	pthread_mutex_unlock (&order_lock);
+
+	sh_veu_release (0);
+
+	return NULL;
+}
+
+/* While this thread holds the VEU, queue each waiter gap_ms after the
+ * one before, then let them through and check the order in which they
+ * got the VEU */
+static void
+check_order (struct waiter * w, int n, const int * expected, int gap_ms)
+{
+	pthread_t threads[8];
+	int i;
+
+	nr_granted = 0;
+
+	sh_veu_acquire (0, SHVEU_PRIORITY_NORMAL, 0.0);
+	for (i = 0; i < n; i++) {
+		pthread_create (&threads[i], NULL, waiter_thread, &w[i]);
+		usleep ((i < n - 1 ? gap_ms : 5) * MS);
+	}
+	sh_veu_release (0);
+
+	for (i = 0; i < n; i++)
+		pthread_join (threads[i], NULL);
+
+	for (i = 0; i < n; i++) {
+		if (order[i] != expected[i])
+			FAIL ("VEU handed over in the wrong order");
+	}
+}
+
+static volatile int op_done;
+
+static void *
+operation_thread (void * arg)
+{
+	struct shveu_op * op = arg;
+
+	if (shveu_operation (0, op->src_py, op->src_pc, op->src_width,
+			     op->src_height, op->src_pitch, op->src_fmt,
+			     op->dst_py, op->dst_pc, op->dst_width,
+			     op->dst_height, op->dst_pitch, op->dst_fmt,
+			     op->rotate) < 0)
+		FAIL ("operation failed");
+	op_done = 1;
+
+	return NULL;
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct waiter classes[] = {
+		{ SHVEU_PRIORITY_BACKGROUND, 0.0, 0 },
+		{ SHVEU_PRIORITY_NORMAL, 50 * MS, 1 },
+		{ SHVEU_PRIORITY_NORMAL, 20 * MS, 2 },
+		{ SHVEU_PRIORITY_REALTIME, 0.0, 3 },
+		{ SHVEU_PRIORITY_NORMAL, 0.0, 4 },
+	};
+	int by_class[] = { 3, 2, 1, 4, 0 };
+	struct waiter aging[] = {
+		{ SHVEU_PRIORITY_BACKGROUND, 0.0, 0 },
+		{ SHVEU_PRIORITY_NORMAL, 0.0, 1 },
+	};
+	int by_age[] = { 0, 1 };
+	struct shveu_queue_stats stats;
+	struct shveu_op op = {
+		SIM_MEM_PHYS, SIM_MEM_PHYS + 64 * 64, 64, 64, 64, SHVEU_YCbCr420,
+		SIM_MEM_PHYS + 0x10000, 0, 64, 64, 64, SHVEU_RGB565,
+		SHVEU_NO_ROT
+	};
+	pthread_t thread;
+	struct timespec ts;
+	double now;
+
+	INFO ("Monotonic time");
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	now = sh_veu_now_us ();
+	if (now < ts.tv_sec * 1e6 || now > ts.tv_sec * 1e6 + 2e6)
+		FAIL ("time not taken from the monotonic clock");
+
+	INFO ("Order by class, then deadline, then arrival");
+	check_order (classes, 5, by_class, 5);
+
+	INFO ("Promotion after waiting");
+	check_order (aging, 2, by_age, 250);
+	shveu_queue_get_stats (0, &stats);
+	if (stats.promoted != 1)
+		FAIL ("aged operation not counted as promoted");
+
+	if (sim_veu_open () < 0)
+		FAIL ("cannot set up simulated VEU");
+
+	INFO ("shveu_start() holds the VEU until shveu_wait()");
+	if (shveu_start (0, op.src_py, op.src_pc, op.src_width, op.src_height,
+			 op.src_pitch, op.src_fmt, op.dst_py, op.dst_pc,
+			 op.dst_width, op.dst_height, op.dst_pitch, op.dst_fmt,
+			 op.rotate) < 0)
+		FAIL ("cannot start operation");
+	pthread_create (&thread, NULL, operation_thread, &op);
+	usleep (50 * MS);
+	if (op_done)
+		FAIL ("operation performed while the VEU was in use");
+	shveu_wait (0);
+	pthread_join (thread, NULL);
+	if (!op_done)
+		FAIL ("operation not performed");
+
+	INFO ("An invalid operation does not hold the VEU");
+	op.src_width = 8;
+	if (shveu_start (0, op.src_py, op.src_pc, op.src_width, op.src_height,
+			 op.src_pitch, op.src_fmt, op.dst_py, op.dst_pc,
+			 op.dst_width, op.dst_height, op.dst_pitch, op.dst_fmt,
+			 op.rotate) == 0)
+		FAIL ("invalid operation started");
+	sh_veu_acquire (0, SHVEU_PRIORITY_NORMAL, 0.0);
+	sh_veu_release (0);
+
+	sim_veu_close ();
+
+	exit (0);
+}
@@ -0,0 +1,88 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Registers programmed for an operation on a simulated VEU: each register
+ * holds its own value, the lowpass filter registers are never written, and
+ * smooth scaling is left to the CPU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shveu/shveu.h"
+
+#include "shveu_regs.h"
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define SRC_Y SIM_MEM_PHYS
+#define SRC_C (SIM_MEM_PHYS + 0x20000)
+#define DST_Y (SIM_MEM_PHYS + 0x40000)
+
+/* Left in the lowpass registers by an earlier operation */
+#define STALE 0x5a5a5a5a
+
+static int
+convert (unsigned long src_w, unsigned long src_h, unsigned long dst_w,
+	 unsigned long dst_h, shveu_format_t dst_fmt)
+{
+	sim_veu_clear ();
+	sim_veu_set_reg (VVTCR, STALE);
+	sim_veu_set_reg (VHTCR, STALE);
+
+	return shveu_operation (0, SRC_Y, SRC_C, src_w, src_h, src_w, SHVEU_YCbCr420,
+				DST_Y, 0, dst_w, dst_h, dst_w, dst_fmt, SHVEU_NO_ROT);
+}
+
+int
+main (int argc, char * argv[])
+{
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	INFO ("Addresses and sizes");
+	if (convert (352, 288, 176, 144, SHVEU_RGB565) < 0)
+		FAIL ("operation refused");
+	if (sim_veu_reg (VSAYR) != SRC_Y || sim_veu_reg (VSACR) != SRC_C ||
+	    sim_veu_reg (VDAYR) != DST_Y)
+		FAIL ("plane address overwritten by a neighbouring register");
+	if (sim_veu_reg (VESSR) != ((288 << 16) | 352) ||
+	    sim_veu_reg (VESWR) != 352 || sim_veu_reg (VEDWR) != 176 * 2)
+		FAIL ("wrong source or destination size");
+
+	INFO ("Lowpass filter left as reset");
+	if (sim_veu_reg (VVTCR) != STALE || sim_veu_reg (VHTCR) != STALE)
+		FAIL ("lowpass filter written");
+	if (convert (352, 288, 176, 144, SHVEU_RGB565 | SHVEU_FILTER_FAST) < 0)
+		FAIL ("fast scaling refused");
+	if (sim_veu_reg (VVTCR) != STALE || sim_veu_reg (VHTCR) != STALE)
+		FAIL ("lowpass filter written for fast scaling");
+
+	INFO ("Smooth scaling refused by the VEU");
+	if (convert (352, 288, 176, 144, SHVEU_RGB565 | SHVEU_FILTER_SMOOTH) == 0)
+		FAIL ("smooth scaling accepted");
+	if (sim_veu_reg (VVTCR) != STALE || sim_veu_reg (VHTCR) != STALE)
+		FAIL ("lowpass filter written for smooth scaling");
+
+	sim_veu_close ();
+
+	exit (0);
+}
@@ -0,0 +1,178 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Submission rings: a full ring, results in order of submission, the
+ * completion descriptor, and several producer threads sharing a
+ * dispatcher
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <poll.h>
+#include <sched.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_tests.h"
+
+#define NR_THREADS 4
+#define OPS_PER_THREAD 5000
+
+static sem_t go;
+static int blocking = 0;
+static int executed = 0;
+
+/* Reports the source width as the result, waiting for go if blocking */
+static int
+exec_width (void * arg, const struct shveu_op * op)
+{
+	if (blocking)
+		sem_wait (&go);
+	executed++;
+
+	return (int)op->src_width;
+}
+
+static int
+readable (struct shveu_ring * ring, int timeout_ms)
+{
+	struct pollfd pfd;
+
+	pfd.fd = shveu_ring_fd (ring);
+	pfd.events = POLLIN;
+
+	return poll (&pfd, 1, timeout_ms) == 1;
+}
+
+static void *
+producer (void * arg)
+{
+	struct shveu_dispatcher * dispatcher = arg;
+	struct shveu_ring * ring;
+	struct shveu_op op;
+	unsigned long submitted = 0, reaped = 0;
+	void * cookie;
+	int result;
+
+	memset (&op, 0, sizeof (op));
+
+	ring = shveu_ring_create (dispatcher, 32);
+	if (ring == NULL)
+		FAIL ("cannot create ring");
+
+	while (reaped < OPS_PER_THREAD) {
+		op.src_width = submitted;
+		if (submitted < OPS_PER_THREAD &&
+		    shveu_ring_submit (ring, &op, (void *)submitted) == 0) {
+			submitted++;
+			continue;
+		}
+
+		/* Full, or all submitted: let the dispatcher run */
+		if (shveu_ring_reap (ring, &cookie, &result) == 0) {
+			sched_yield ();
+			continue;
+		}
+
+		do {
+			if ((unsigned long)cookie != reaped || result != (int)reaped)
+				FAIL ("result out of order");
+			reaped++;
+		} while (shveu_ring_reap (ring, &cookie, &result) == 1);
+	}
+
+	shveu_ring_destroy (ring);
+
+	return NULL;
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct shveu_dispatcher * dispatcher;
+	struct shveu_ring * ring;
+	struct shveu_op op;
+	pthread_t threads[NR_THREADS];
+	void * cookie;
+	int i, result;
+
+	memset (&op, 0, sizeof (op));
+	sem_init (&go, 0, 0);
+
+	dispatcher = shveu_dispatcher_start (0, exec_width, NULL);
+	if (dispatcher == NULL)
+		FAIL ("cannot start dispatcher");
+
+	INFO ("Full ring");
+	ring = shveu_ring_create (dispatcher, 5);
+	if (ring == NULL || shveu_ring_fd (ring) < 0)
+		FAIL ("cannot create ring");
+
+	blocking = 1;
+	for (i = 0; i < 8; i++) {
+		op.src_width = i;
+		if (shveu_ring_submit (ring, &op, (void *)(long)i) < 0)
+			FAIL ("operation refused by a ring with room for it");
+	}
+	if (shveu_ring_submit (ring, &op, NULL) == 0)
+		FAIL ("operation accepted by a full ring");
+	if (shveu_ring_reap (ring, &cookie, &result) != 0 || readable (ring, 0))
+		FAIL ("result reaped before the operation completed");
+
+	INFO ("Results in order of submission");
+	for (i = 0; i < 8; i++)
+		sem_post (&go);
+	for (i = 0; i < 8; ) {
+		if (!readable (ring, 5000))
+			FAIL ("completion descriptor not readable");
+		while (shveu_ring_reap (ring, &cookie, &result) == 1) {
+			if (cookie != (void *)(long)i || result != i)
+				FAIL ("result out of order");
+			i++;
+		}
+	}
+	if (shveu_ring_reap (ring, &cookie, &result) != 0 || readable (ring, 0))
+		FAIL ("result reaped twice");
+	blocking = 0;
+
+	INFO ("Operations in flight completed on destroy");
+	for (i = 0; i < 4; i++)
+		if (shveu_ring_submit (ring, &op, NULL) < 0)
+			FAIL ("operation refused");
+	shveu_ring_destroy (ring);
+	if (executed != 12)
+		FAIL ("operation in flight dropped");
+
+	INFO ("Producer threads");
+	for (i = 0; i < NR_THREADS; i++)
+		if (pthread_create (&threads[i], NULL, producer, dispatcher) != 0)
+			FAIL ("cannot create thread");
+	for (i = 0; i < NR_THREADS; i++)
+		pthread_join (threads[i], NULL);
+
+	shveu_dispatcher_stop (dispatcher);
+
+	exit (0);
+}
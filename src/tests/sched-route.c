@@ -0,0 +1,123 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Routing decisions of the scheduler, fed with simulated completion times
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shveu/shveu.h"
+
+#include "shveu_internal.h"
+#include "shveu_tests.h"
+
+#define QCIF (176 * 144)
+
+/* Simulated cost in us of an operation on each path */
+static double hw_setup = 200.0, hw_slope = 0.02;
+static double cpu_setup = 1.0, cpu_slope = 0.001;
+
+/* Route an operation, complete it, and return 1 if the CPU performed it */
+static int
+route (int hw_ok, int cpu_ok, int cached)
+{
+	struct sh_veu_route r;
+	double elapsed;
+
+	r.pixels = QCIF;
+	r.cached = cached;
+	sh_veu_sched_route (0, hw_ok, cpu_ok, &r);
+
+	if (r.cpu)
+		elapsed = cpu_setup + cpu_slope * r.pixels;
+	else
+		elapsed = hw_setup + hw_slope * r.pixels;
+	sh_veu_sched_done (0, &r, elapsed, 0);
+
+	return r.cpu;
+}
+
+static int
+count_cpu (int n, int cached)
+{
+	int i, cpu = 0;
+
+	for (i = 0; i < n; i++)
+		cpu += route (1, 1, cached);
+
+	return cpu;
+}
+
+int
+main (int argc, char * argv[])
+{
+	struct sh_veu_route r[8];
+	struct shveu_sched_stats stats;
+	int i, cpu;
+
+	INFO ("Backlog of the VEU");
+	shveu_sched_set_policy (0, SHVEU_SCHED_LATENCY);
+	for (i = 0; i < 8; i++) {
+		r[i].pixels = QCIF;
+		r[i].cached = 1;
+		sh_veu_sched_route (0, 1, 1, &r[i]);
+		if (r[i].cpu)
+			break;
+	}
+	/* Initial estimates: VEU 707 us, CPU 2539 us */
+	if (i != 3)
+		FAIL ("CPU not chosen once the VEU backlog exceeds its cost");
+	while (i >= 0)
+		sh_veu_sched_done (0, &r[i--], 0.0, -1);
+
+	INFO ("Exploration of a path overestimated at first");
+	shveu_sched_set_policy (0, SHVEU_SCHED_PREFER_HW);
+	cpu = count_cpu (1000, 1);
+	if (cpu < 500)
+		FAIL ("scheduler did not learn that the CPU is faster");
+
+	/* Once the CPU wins, the VEU gets one operation in 65 */
+	cpu = count_cpu (650, 1);
+	if (cpu < 635 || cpu > 645)
+		FAIL ("VEU not measured once every EXPLORE_INTERVAL operations");
+
+	shveu_sched_get_stats (0, &stats);
+	if (stats.cpu_setup_us + stats.cpu_ns_per_pixel * QCIF / 1000 > 30)
+		FAIL ("CPU model does not match measurements");
+
+	INFO ("Fixed policies");
+	shveu_sched_set_policy (0, SHVEU_SCHED_HW_ONLY);
+	if (count_cpu (200, 1) != 0)
+		FAIL ("CPU used with SHVEU_SCHED_HW_ONLY");
+	shveu_sched_set_policy (0, SHVEU_SCHED_CPU_ONLY);
+	if (count_cpu (200, 1) != 200)
+		FAIL ("VEU used with SHVEU_SCHED_CPU_ONLY");
+	if (route (0, 1, 1) != 1 || route (1, 0, 1) != 0)
+		FAIL ("operation routed to a path that cannot perform it");
+
+	INFO ("Separate model for uncached images");
+	shveu_sched_set_policy (0, SHVEU_SCHED_PREFER_HW);
+	if (route (1, 1, 0) != 0)
+		FAIL ("uncached CPU estimated from cached measurements");
+
+	exit (0);
+}
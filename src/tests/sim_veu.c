@@ -0,0 +1,98 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "shveu_internal.h"
+#include "sim_veu.h"
+
+/* Size of the VEU2H register block, which identifies it */
+#define VEU2H_MMIO_SIZE 0x27c
+
+static unsigned char regs[VEU2H_MMIO_SIZE];
+
+int
+sim_veu_open (void)
+{
+	/* Reads as a pending interrupt; writes are accepted */
+	sh_veu_uio_dev.fd = open ("/dev/zero", O_RDWR);
+	if (sh_veu_uio_dev.fd < 0)
+		return -1;
+
+	sh_veu_uio_mmio.address = 0xfe920000;
+	sh_veu_uio_mmio.size = VEU2H_MMIO_SIZE;
+	sh_veu_uio_mmio.iomem = regs;
+
+	sh_veu_uio_mem.address = SIM_MEM_PHYS;
+	sh_veu_uio_mem.size = SIM_MEM_SIZE;
+	sh_veu_uio_mem.iomem = calloc (1, SIM_MEM_SIZE);
+	if (sh_veu_uio_mem.iomem == NULL) {
+		close (sh_veu_uio_dev.fd);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+sim_veu_close (void)
+{
+	close (sh_veu_uio_dev.fd);
+	free (sh_veu_uio_mem.iomem);
+
+	memset (&sh_veu_uio_dev, 0, sizeof (sh_veu_uio_dev));
+	memset (&sh_veu_uio_mmio, 0, sizeof (sh_veu_uio_mmio));
+	memset (&sh_veu_uio_mem, 0, sizeof (sh_veu_uio_mem));
+}
+
+uint32_t
+sim_veu_reg (int reg)
+{
+	uint32_t v;
+
+	memcpy (&v, regs + reg, sizeof (v));
+
+	return v;
+}
+
+void
+sim_veu_set_reg (int reg, uint32_t value)
+{
+	memcpy (regs + reg, &value, sizeof (value));
+}
+
+void
+sim_veu_clear (void)
+{
+	memset (regs, 0, sizeof (regs));
+}
+
+void *
+sim_veu_virt (unsigned long phys)
+{
+	return (char *)sh_veu_uio_mem.iomem + (phys - SIM_MEM_PHYS);
+}
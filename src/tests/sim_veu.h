@@ -0,0 +1,53 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+
+/*
+ * A VEU simulated in memory, so that operations can be started without
+ * the hardware. Registers are plain memory, the VEU memory region is a
+ * buffer, and the interrupt is always pending, so an operation completes
+ * as soon as it is started, without writing its destination.
+ */
+
+#ifndef __SIM_VEU_H__
+#define __SIM_VEU_H__
+
+#include <inttypes.h>
+
+/* Physical address and size of the simulated VEU memory region */
+#define SIM_MEM_PHYS 0x0c000000UL
+#define SIM_MEM_SIZE 0x200000UL
+
+/* Stand in for a VEU2H, as if found by shveu_open() */
+int sim_veu_open (void);
+void sim_veu_close (void);
+
+/* Value last written to the register at offset reg */
+uint32_t sim_veu_reg (int reg);
+
+/* Set a register, as if by the VEU */
+void sim_veu_set_reg (int reg, uint32_t value);
+
+/* Clear the registers, so that only registers written afterwards are set */
+void sim_veu_clear (void);
+
+/* Virtual address of a physical address in the memory region */
+void * sim_veu_virt (unsigned long phys);
+
+#endif /* __SIM_VEU_H__ */
@@ -0,0 +1,202 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Image statistics: known images, sampling, and the statistics gathered
+ * during a conversion matching those of its output, on the CPU and on a
+ * simulated VEU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_tests.h"
+#include "sim_veu.h"
+
+#define W 64
+#define H 32
+
+#define SRC_Y SIM_MEM_PHYS
+#define SRC_C (SIM_MEM_PHYS + 0x4000)
+#define DST (SIM_MEM_PHYS + 0x10000)
+
+static unsigned char y[W * H], c[W * H];
+static uint16_t rgb[W * H], out[W * H];
+
+static void
+same_stats (const struct shveu_stats * a, const struct shveu_stats * b,
+	    const char * msg)
+{
+	if (a->samples != b->samples ||
+	    memcmp (a->histogram, b->histogram, sizeof (a->histogram)) ||
+	    memcmp (a->min, b->min, sizeof (a->min)) ||
+	    memcmp (a->max, b->max, sizeof (a->max)) ||
+	    memcmp (a->mean, b->mean, sizeof (a->mean)) ||
+	    memcmp (a->blocks, b->blocks, sizeof (a->blocks)))
+		FAIL (msg);
+}
+
+static void
+check_known (void)
+{
+	struct shveu_stats stats;
+	unsigned long i, j, v, total;
+
+	INFO ("Known YCbCr image");
+	/* Each block of the grid is a single luma */
+	for (i = 0; i < H; i++)
+		for (j = 0; j < W; j++)
+			y[i * W + j] = 10 + 20 * (i * SHVEU_STATS_GRID / H) +
+				       2 * (j * SHVEU_STATS_GRID / W);
+	for (i = 0; i < W * H / 2; i += 2) {
+		c[i] = 100;
+		c[i + 1] = 200;
+	}
+
+	if (shveu_stats_surface (y, c, W, H, W, SHVEU_YCbCr420, 1, &stats) < 0)
+		FAIL ("statistics refused");
+
+	if (stats.samples != W * H)
+		FAIL ("wrong number of samples");
+	total = 0;
+	for (v = 0; v < 256; v++)
+		total += stats.histogram[v];
+	if (total != W * H)
+		FAIL ("histogram does not count every sample");
+	for (i = 0; i < SHVEU_STATS_GRID; i++) {
+		for (j = 0; j < SHVEU_STATS_GRID; j++) {
+			v = 10 + 20 * i + 2 * j;
+			if (stats.blocks[i][j] != v)
+				FAIL ("wrong block mean");
+			if (stats.histogram[v] != W * H / (SHVEU_STATS_GRID * SHVEU_STATS_GRID))
+				FAIL ("wrong histogram");
+		}
+	}
+	if (stats.min[0] != 10 || stats.max[0] != 10 + 20 * 7 + 2 * 7 ||
+	    stats.mean[0] != 10 + 70 + 7)
+		FAIL ("wrong luma range or mean");
+	if (stats.min[1] != 100 || stats.max[1] != 100 || stats.mean[1] != 100 ||
+	    stats.min[2] != 200 || stats.max[2] != 200 || stats.mean[2] != 200)
+		FAIL ("wrong chroma range or mean");
+
+	INFO ("Sampling");
+	if (shveu_stats_surface (y, c, W - 1, H - 1, W, SHVEU_YCbCr420, 4, &stats) < 0)
+		FAIL ("statistics refused");
+	if (stats.samples != ((W - 1 + 3) / 4) * ((H - 1 + 3) / 4))
+		FAIL ("wrong number of samples");
+	if (stats.min[0] != 10 || stats.blocks[0][0] != 10)
+		FAIL ("wrong sampled statistics");
+	if (shveu_stats_surface (y, c, W, H, W, SHVEU_YCbCr420, 0, &stats) == 0)
+		FAIL ("step of 0 accepted");
+
+	INFO ("Known RGB image");
+	for (i = 0; i < W * H; i++)
+		rgb[i] = 0xf800;
+	if (shveu_stats_surface (rgb, NULL, W, H, W, SHVEU_RGB565, 1, &stats) < 0)
+		FAIL ("statistics refused");
+	/* Red of 248, weighted by 0.299 */
+	if (stats.histogram[74] + stats.histogram[75] != W * H)
+		FAIL ("wrong luma of red");
+	if (stats.min[0] != 248 || stats.max[0] != 248 ||
+	    stats.max[1] != 0 || stats.max[2] != 0)
+		FAIL ("wrong RGB range");
+}
+
+static void
+check_cpu (void)
+{
+	struct shveu_stats during, after;
+	unsigned long i, seed = 1;
+
+	for (i = 0; i < W * H; i++) {
+		seed = seed * 1103515245 + 12345;
+		y[i] = seed >> 16;
+		c[i] = seed >> 8;
+		rgb[i] = seed >> 12;
+	}
+
+	INFO ("Statistics during a conversion to RGB");
+	if (shveu_cpu_operation_stats (y, c, W, H, W, SHVEU_YCbCr420,
+				       out, NULL, W - 8, H - 6, W, SHVEU_RGB565,
+				       SHVEU_NO_ROT, &during) < 0)
+		FAIL ("conversion refused");
+	shveu_stats_surface (out, NULL, W - 8, H - 6, W, SHVEU_RGB565, 1, &after);
+	same_stats (&during, &after, "statistics differ from those of the output");
+
+	INFO ("Statistics during a rotation to YCbCr");
+	if (shveu_cpu_operation_stats (rgb, NULL, H, H, W, SHVEU_RGB565,
+				       y, c, H, H, W, SHVEU_YCbCr422,
+				       SHVEU_ROT_90, &during) < 0)
+		FAIL ("conversion refused");
+	shveu_stats_surface (y, c, H, H, W, SHVEU_YCbCr422, 1, &after);
+	same_stats (&during, &after, "statistics differ from those of the output");
+}
+
+static void
+check_sched (shveu_sched_policy_t policy, unsigned int step)
+{
+	struct shveu_stats during, after;
+	struct shveu_op op;
+
+	memset (&op, 0, sizeof (op));
+	op.src_py = SRC_Y;
+	op.src_pc = SRC_C;
+	op.src_width = op.src_pitch = op.dst_width = op.dst_pitch = W;
+	op.src_height = op.dst_height = H;
+	op.src_fmt = SHVEU_YCbCr420;
+	op.dst_py = DST;
+	op.dst_fmt = SHVEU_RGB565;
+
+	memcpy (sim_veu_virt (SRC_Y), y, sizeof (y));
+	memcpy (sim_veu_virt (SRC_C), c, sizeof (c));
+	/* The simulated VEU leaves the destination as it is */
+	memcpy (sim_veu_virt (DST), rgb, sizeof (rgb));
+
+	shveu_sched_set_policy (0, policy);
+	if (shveu_sched_operation_stats (0, &op, step, &during) < 0)
+		FAIL ("operation failed");
+	shveu_stats_surface (sim_veu_virt (DST), NULL, W, H, W, SHVEU_RGB565,
+			     step, &after);
+	same_stats (&during, &after, "statistics differ from those of the output");
+}
+
+int
+main (int argc, char * argv[])
+{
+	check_known ();
+	check_cpu ();
+
+	if (sim_veu_open () < 0)
+		FAIL ("cannot simulate VEU");
+
+	INFO ("Statistics of a scheduled operation on the CPU");
+	check_sched (SHVEU_SCHED_CPU_ONLY, 1);
+
+	INFO ("Sampled statistics of a scheduled operation on the VEU");
+	check_sched (SHVEU_SCHED_HW_ONLY, 3);
+
+	sim_veu_close ();
+
+	exit (0);
+}
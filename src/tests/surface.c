@@ -0,0 +1,213 @@
+/*
+ * libshveu: A library for controlling SH-Mobile VEU
+ * Copyright (C) 2009 Renesas Technology Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA  02110-1301 USA
+ */
+
+/*
+ * Surface layout: pitch, plane offsets and alignment for each policy,
+ * and an image converted into a padded surface matching the packed one
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "shveu/shveu.h"
+
+#include "shveu_tests.h"
+
+#define NR_FORMATS 8
+
+static const int policies[4] = {
+	SHVEU_ALIGN_PACKED, SHVEU_ALIGN_LINES, SHVEU_ALIGN_PAGES,
+	SHVEU_ALIGN_DEFAULT
+};
+
+static unsigned char src[64 * 48 * 2];
+static unsigned char packed[64 * 48 * 3], padded[128 * 48 * 3];
+
+static void
+layout (struct shveu_surface * s, shveu_format_t fmt, unsigned long w,
+	unsigned long h, int policy)
+{
+	if (shveu_surface_init (s, fmt, w, h, policy) < 0)
+		FAIL ("surface refused");
+}
+
+/* Alignment of a plane of the given size under a policy */
+static unsigned long
+plane_align (unsigned long size, int policy)
+{
+	if ((policy & SHVEU_ALIGN_PAGES) && size >= SHVEU_LARGE_PLANE)
+		return SHVEU_PAGE_ALIGN;
+	if (policy & SHVEU_ALIGN_LINES)
+		return SHVEU_LINE_ALIGN;
+	return 1;
+}
+
+static void
+check_known (void)
+{
+	struct shveu_surface s;
+
+	INFO ("Packed");
+	layout (&s, SHVEU_YCbCr420, 100, 50, SHVEU_ALIGN_PACKED);
+	if (s.pitch != 100 || s.y_stride != 100 || s.c_offset != 5000 ||
+	    s.c_stride != 100 || s.c_lines != 25 || s.size != 7500 || s.align != 1)
+		FAIL ("wrong packed NV12 layout");
+	if (!shveu_surface_is_packed (&s))
+		FAIL ("packed surface has padding");
+
+	INFO ("Lines aligned");
+	layout (&s, SHVEU_YCbCr420, 100, 50, SHVEU_ALIGN_LINES);
+	if (s.pitch != 128 || s.y_line != 100 || s.y_stride != 128 ||
+	    s.c_offset != 6400 || s.c_line != 100 || s.c_stride != 128 ||
+	    s.size != 9600 || s.align != 32)
+		FAIL ("wrong line aligned NV12 layout");
+	if (shveu_surface_is_packed (&s))
+		FAIL ("padded surface packed");
+
+	layout (&s, SHVEU_RGB565, 100, 50, SHVEU_ALIGN_LINES);
+	if (s.pitch != 112 || s.y_line != 200 || s.y_stride != 224 ||
+	    s.c_offset != 0 || s.c_lines != 0 || s.size != 224 * 50)
+		FAIL ("wrong line aligned RGB565 layout");
+
+	layout (&s, SHVEU_YCbCr444, 50, 10, SHVEU_ALIGN_LINES);
+	if (s.pitch != 64 || s.c_line != 100 || s.c_stride != 128 ||
+	    s.c_lines != 10 || s.c_offset != 640 || s.size != 640 + 1280)
+		FAIL ("wrong line aligned NV24 layout");
+
+	/* Already aligned lines need no padding */
+	layout (&s, SHVEU_YCbCr422, 64, 16, SHVEU_ALIGN_LINES);
+	if (!shveu_surface_is_packed (&s))
+		FAIL ("aligned surface padded");
+
+	INFO ("Large planes page aligned");
+	layout (&s, SHVEU_YCbCr420, 650, 250, SHVEU_ALIGN_DEFAULT);
+	if (s.pitch != 672 || s.c_offset != 172032 || s.align != 4096 ||
+	    s.size != 172032 + 672 * 125)
+		FAIL ("wrong page aligned NV12 layout");
+
+	layout (&s, SHVEU_YCbCr420, 64, 64, SHVEU_ALIGN_DEFAULT);
+	if (s.c_offset != 4096 || s.align != 32 || s.size != 6144)
+		FAIL ("small planes page aligned");
+
+	INFO ("Invalid surfaces");
+	if (shveu_surface_init (&s, SHVEU_YCbCr420, 64, 64, 1 << 5) == 0)
+		FAIL ("unknown policy accepted");
+	if (shveu_surface_init (&s, SHVEU_YCbCr420, 0, 64, SHVEU_ALIGN_DEFAULT) == 0 ||
+	    shveu_surface_init (&s, SHVEU_YCbCr420, 64, 0, SHVEU_ALIGN_DEFAULT) == 0)
+		FAIL ("empty surface accepted");
+}
+
+static void
+check_all (void)
+{
+	static const unsigned long sizes[][2] = {
+		{ 16, 16 }, { 100, 50 }, { 176, 144 }, { 650, 250 }, { 1920, 1080 }
+	};
+	struct shveu_surface s;
+	unsigned long i, a;
+	shveu_format_t fmt;
+	int p;
+
+	INFO ("Every format and policy");
+	for (fmt = 0; fmt < NR_FORMATS; fmt++) {
+		for (p = 0; p < 4; p++) {
+			for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+				layout (&s, fmt, sizes[i][0], sizes[i][1], policies[p]);
+
+				if (s.y_line > s.y_stride || s.y_stride % s.pitch ||
+				    s.c_line > s.c_stride)
+					FAIL ("line larger than its stride");
+				if (s.c_lines && s.c_offset < s.y_stride * s.height)
+					FAIL ("planes overlap");
+				if (s.size < s.c_offset + s.c_stride * s.c_lines ||
+				    s.size < s.y_stride * s.height)
+					FAIL ("plane outside the buffer");
+
+				a = plane_align (s.y_stride * s.height, policies[p]);
+				if (s.align % a)
+					FAIL ("buffer less aligned than its first plane");
+				if (s.c_lines) {
+					a = plane_align (s.c_stride * s.c_lines,
+							 policies[p]);
+					if (s.c_offset % a || s.align % a)
+						FAIL ("CbCr plane not aligned");
+				}
+				if ((policies[p] & SHVEU_ALIGN_LINES) &&
+				    (s.y_stride % SHVEU_LINE_ALIGN ||
+				     s.c_stride % SHVEU_LINE_ALIGN ||
+				     s.size % SHVEU_LINE_ALIGN))
+					FAIL ("line not aligned");
+				if (policies[p] == SHVEU_ALIGN_PACKED &&
+				    !shveu_surface_is_packed (&s))
+					FAIL ("packed surface has padding");
+			}
+		}
+	}
+}
+
+static void
+convert (const struct shveu_surface * s, unsigned char * buf)
+{
+	if (shveu_cpu_operation (src, NULL, 60, 44, 64, SHVEU_RGB565,
+				 buf, s->c_lines ? buf + s->c_offset : NULL,
+				 s->width, s->height, s->pitch, s->format,
+				 SHVEU_NO_ROT) < 0)
+		FAIL ("conversion refused");
+}
+
+static void
+check_convert (void)
+{
+	struct shveu_surface p, a;
+	unsigned long i;
+	shveu_format_t fmt;
+
+	INFO ("Conversion into a padded surface");
+	for (i = 0; i < sizeof (src); i++)
+		src[i] = i * 37 + (i >> 7);
+
+	for (fmt = 0; fmt < NR_FORMATS; fmt++) {
+		layout (&p, fmt, 60, 44, SHVEU_ALIGN_PACKED);
+		layout (&a, fmt, 60, 44, SHVEU_ALIGN_LINES);
+		convert (&p, packed);
+		convert (&a, padded);
+
+		for (i = 0; i < p.height; i++)
+			if (memcmp (packed + i * p.y_stride, padded + i * a.y_stride,
+				    p.y_line))
+				FAIL ("line differs in the padded surface");
+		for (i = 0; i < p.c_lines; i++)
+			if (memcmp (packed + p.c_offset + i * p.c_stride,
+				    padded + a.c_offset + i * a.c_stride, p.c_line))
+				FAIL ("CbCr line differs in the padded surface");
+	}
+}
+
+int
+main (int argc, char * argv[])
+{
+	check_known ();
+	check_all ();
+	check_convert ();
+
+	exit (0);
+}
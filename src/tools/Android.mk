@@ -8,3 +8,21 @@ LOCAL_SRC_FILES := shveu-convert.c
 LOCAL_SHARED_LIBRARIES := libshveu
 LOCAL_MODULE := shveu-convert
 include $(BUILD_EXECUTABLE)
+
+# shveu-broker
+include $(CLEAR_VARS)
+LOCAL_C_INCLUDES := external/libshveu/include
+LOCAL_CFLAGS := -DVERSION=\"1.0.0\"
+LOCAL_SRC_FILES := shveu-broker.c
+LOCAL_SHARED_LIBRARIES := libshveu
+LOCAL_MODULE := shveu-broker
+include $(BUILD_EXECUTABLE)
+
+# shveu-bench
+include $(CLEAR_VARS)
+LOCAL_C_INCLUDES := external/libshveu/include
+LOCAL_CFLAGS := -DVERSION=\"1.0.0\"
+LOCAL_SRC_FILES := shveu-bench.c
+LOCAL_SHARED_LIBRARIES := libshveu
+LOCAL_MODULE := shveu-bench
+include $(BUILD_EXECUTABLE)
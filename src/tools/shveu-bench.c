@@ -0,0 +1,626 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <sched.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <uiomux/uiomux.h>
+
+#include "shveu/shveu.h"
+
+#define RING_SIZE 64
+#define BROKER_CLIENTS 4
+
+static unsigned long iterations = 1000000;
+
+static void
+usage (const char * progname)
+{
+        printf ("Usage: %s [options] [test ...]\n", progname);
+        printf ("Measure libshveu overheads. No VEU hardware is used except by 'open'.\n");
+	printf ("\n");
+        printf ("Tests\n");
+        printf ("  ring                   Submission ring: cost of a submit, and round trips\n");
+        printf ("                         through the dispatcher thread\n");
+        printf ("  poll                   Submission ring, waiting for results with poll()\n");
+        printf ("  broker                 Broker: round trips of %d client processes sharing\n", BROKER_CLIENTS);
+        printf ("                         a simulated VEU, iterations/10 ops in total\n");
+        printf ("  stats                  Statistics of a VGA NV12 frame converted on the CPU,\n");
+        printf ("                         gathered during and after the conversion\n");
+        printf ("  align                  CPU conversion of an odd sized frame between packed\n");
+        printf ("                         and between aligned buffers\n");
+        printf ("  dedup                  Duplicate frame detection: cost of hashing a VGA\n");
+        printf ("                         NV12 frame in VEU memory, against converting it to\n");
+        printf ("                         RGB565 on the VEU. Needs a VEU\n");
+        printf ("  open                   Startup: cost of shveu_open() and shveu_close(),\n");
+        printf ("                         run iterations/1000 times. Needs a VEU; set\n");
+        printf ("                         SHVEU_TOPOLOGY_CACHE to measure a cached open\n");
+        printf ("If no test is specified, all tests are run.\n");
+        printf ("\nOptions\n");
+        printf ("  -n, --iterations       Number of operations per test (default %lu)\n", iterations);
+        printf ("\nMiscellaneous options\n");
+        printf ("  -h, --help             Display this help and exit\n");
+        printf ("  -v, --version          Output version information and exit\n");
+	printf ("\n");
+        printf ("Please report bugs to <linux-sh@vger.kernel.org>\n");
+}
+
+static double
+now_ns (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Stands in for the VEU so that only the queueing overhead is measured */
+static int
+exec_nop (void * arg, const struct shveu_op * op)
+{
+	return 0;
+}
+
+static int
+bench_ring (void)
+{
+	struct shveu_dispatcher * d;
+	struct shveu_ring * ring;
+	struct shveu_op op;
+	unsigned long submitted = 0, reaped = 0, failed = 0;
+	double t, t0, submit_ns = 0.0, total_ns;
+	int result;
+
+	d = shveu_dispatcher_start (0, exec_nop, NULL);
+	if (d == NULL)
+		return -1;
+
+	ring = shveu_ring_create (d, RING_SIZE);
+	if (ring == NULL) {
+		shveu_dispatcher_stop (d);
+		return -1;
+	}
+
+	memset (&op, 0, sizeof (op));
+
+	t = now_ns ();
+	while (reaped < iterations) {
+		/* Time a burst of submits filling the ring */
+		t0 = now_ns ();
+		while (submitted < iterations && submitted - reaped < RING_SIZE) {
+			shveu_ring_submit (ring, &op, NULL);
+			submitted++;
+		}
+		submit_ns += now_ns () - t0;
+
+		if (shveu_ring_reap (ring, NULL, &result) == 0) {
+			/* Let the dispatcher run if it shares our CPU */
+			sched_yield ();
+			continue;
+		}
+
+		do {
+			if (result != 0) failed++;
+			reaped++;
+		} while (shveu_ring_reap (ring, NULL, &result) == 1);
+	}
+	total_ns = now_ns () - t;
+
+	shveu_ring_destroy (ring);
+	shveu_dispatcher_stop (d);
+
+	printf ("ring:\t\tsubmit %.1f ns, round trip %.1f ns (%lu ops)\n",
+		submit_ns / iterations, total_ns / iterations, iterations);
+
+	return failed ? -1 : 0;
+}
+
+static int
+bench_poll (void)
+{
+	struct shveu_dispatcher * d;
+	struct shveu_ring * ring;
+	struct shveu_op op;
+	struct pollfd pfd;
+	unsigned long submitted = 0, reaped = 0, failed = 0, polls = 0;
+	double t;
+	int result;
+
+	d = shveu_dispatcher_start (0, exec_nop, NULL);
+	if (d == NULL)
+		return -1;
+
+	ring = shveu_ring_create (d, RING_SIZE);
+	if (ring == NULL || (pfd.fd = shveu_ring_fd (ring)) < 0) {
+		shveu_ring_destroy (ring);
+		shveu_dispatcher_stop (d);
+		return -1;
+	}
+	pfd.events = POLLIN;
+
+	memset (&op, 0, sizeof (op));
+
+	t = now_ns ();
+	while (reaped < iterations) {
+		while (submitted < iterations && submitted - reaped < RING_SIZE) {
+			shveu_ring_submit (ring, &op, NULL);
+			submitted++;
+		}
+
+		if (poll (&pfd, 1, 1000) != 1) {
+			failed++;
+			break;
+		}
+		polls++;
+
+		while (shveu_ring_reap (ring, NULL, &result) == 1) {
+			if (result != 0) failed++;
+			reaped++;
+		}
+	}
+	t = now_ns () - t;
+
+	shveu_ring_destroy (ring);
+	shveu_dispatcher_stop (d);
+
+	printf ("poll:\t\tround trip %.1f ns, %.1f results per poll (%lu ops)\n",
+		t / iterations, (double)reaped / polls, iterations);
+
+	return failed ? -1 : 0;
+}
+
+/* Submit n operations through the broker, in a client process */
+static void
+broker_client (const char * path, unsigned long n)
+{
+	struct shveu_client * client;
+	struct shveu_op op;
+	unsigned long i;
+
+	client = shveu_client_connect (path);
+	if (client == NULL)
+		_exit (1);
+
+	memset (&op, 0, sizeof (op));
+	for (i = 0; i < n; i++) {
+		if (shveu_client_operation (client, &op) != 0)
+			_exit (1);
+	}
+
+	shveu_client_disconnect (client);
+	_exit (0);
+}
+
+static int
+bench_broker (void)
+{
+	struct shveu_broker * broker;
+	char path[64];
+	unsigned long n = iterations / 10, jobs = 0;
+	int i, status, running = 0, failed = 0;
+	pid_t pid;
+	double t;
+
+	if (n < BROKER_CLIENTS) n = BROKER_CLIENTS;
+
+	snprintf (path, sizeof (path), "/dev/shm/shveu-bench.%d", (int)getpid ());
+	broker = shveu_broker_open (path, 0600, 0, exec_nop, NULL);
+	if (broker == NULL)
+		return -1;
+
+	t = now_ns ();
+	for (i = 0; i < BROKER_CLIENTS; i++) {
+		pid = fork ();
+		if (pid == 0)
+			broker_client (path, n / BROKER_CLIENTS);
+		if (pid < 0)
+			failed++;
+		else
+			running++;
+	}
+
+	while (running > 0) {
+		jobs += shveu_broker_dispatch (broker, 10);
+		while ((pid = waitpid (-1, &status, WNOHANG)) > 0) {
+			if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+				failed++;
+			running--;
+		}
+	}
+	t = now_ns () - t;
+
+	shveu_broker_close (broker);
+
+	printf ("broker:		round trip %.1f ns with %d clients (%lu ops)\n",
+		t / jobs, BROKER_CLIENTS, jobs);
+
+	return failed ? -1 : 0;
+}
+
+#define STATS_W 640
+#define STATS_H 480
+
+static int
+bench_stats (void)
+{
+	unsigned char * src, * dst;
+	struct shveu_stats stats;
+	unsigned long i, n = iterations / 10000;
+	double t, convert_ns, fused_ns, after_ns, sampled_ns;
+	size_t size = STATS_W * STATS_H * 3 / 2;
+
+	if (n == 0) n = 1;
+
+	src = malloc (size);
+	dst = malloc (size);
+	if (src == NULL || dst == NULL) {
+		free (src);
+		free (dst);
+		return -1;
+	}
+	for (i = 0; i < size; i++)
+		src[i] = i * 7;
+
+#define CONVERT(fn, ...) \
+	fn (src, src + STATS_W * STATS_H, STATS_W, STATS_H, STATS_W, SHVEU_YCbCr420, \
+	    dst, dst + STATS_W * STATS_H, STATS_W, STATS_H, STATS_W, SHVEU_YCbCr420, \
+	    SHVEU_NO_ROT, ##__VA_ARGS__)
+
+	t = now_ns ();
+	for (i = 0; i < n; i++)
+		CONVERT (shveu_cpu_operation);
+	convert_ns = now_ns () - t;
+
+	t = now_ns ();
+	for (i = 0; i < n; i++)
+		CONVERT (shveu_cpu_operation_stats, &stats);
+	fused_ns = now_ns () - t;
+
+	t = now_ns ();
+	for (i = 0; i < n; i++) {
+		CONVERT (shveu_cpu_operation);
+		shveu_stats_surface (dst, dst + STATS_W * STATS_H, STATS_W, STATS_H,
+				     STATS_W, SHVEU_YCbCr420, 1, &stats);
+	}
+	after_ns = now_ns () - t;
+
+	t = now_ns ();
+	for (i = 0; i < n; i++)
+		shveu_stats_surface (dst, dst + STATS_W * STATS_H, STATS_W, STATS_H,
+				     STATS_W, SHVEU_YCbCr420, 4, &stats);
+	sampled_ns = now_ns () - t;
+
+#undef CONVERT
+
+	free (src);
+	free (dst);
+
+	printf ("stats:\t\tconvert %.1f us, +stats during %.1f us, after %.1f us;\n"
+		"\t\tsampled 1/16 %.1f us (%lu frames)\n",
+		convert_ns / n / 1000, (fused_ns - convert_ns) / n / 1000,
+		(after_ns - convert_ns) / n / 1000, sampled_ns / n / 1000, n);
+
+	return 0;
+}
+
+/* Neither lines nor the CbCr plane of a packed frame of this size start
+ * on cache lines */
+#define ALIGN_W 536
+#define ALIGN_H 402
+
+static double
+time_cpu_surfaces (const struct shveu_surface * s, const struct shveu_surface * d,
+		   unsigned long n)
+{
+	void * src, * dst;
+	unsigned long i;
+	double t;
+
+	if (posix_memalign (&src, s->align > 32 ? s->align : 32, s->size) != 0)
+		return -1;
+	if (posix_memalign (&dst, d->align > 32 ? d->align : 32, d->size) != 0) {
+		free (src);
+		return -1;
+	}
+	memset (src, 0x80, s->size);
+
+	t = now_ns ();
+	for (i = 0; i < n; i++) {
+		shveu_cpu_operation (src, (char *)src + s->c_offset, s->width, s->height,
+				     s->pitch, s->format,
+				     dst, (char *)dst + d->c_offset, d->width, d->height,
+				     d->pitch, d->format, SHVEU_NO_ROT);
+	}
+	t = now_ns () - t;
+
+	free (src);
+	free (dst);
+
+	return t / n;
+}
+
+static int
+bench_align (void)
+{
+	struct shveu_surface s, d;
+	unsigned long n = iterations / 10000;
+	double packed_ns, aligned_ns;
+
+	if (n == 0) n = 1;
+
+	shveu_surface_init (&s, SHVEU_YCbCr420, ALIGN_W, ALIGN_H, SHVEU_ALIGN_PACKED);
+	shveu_surface_init (&d, SHVEU_YCbCr422, ALIGN_W, ALIGN_H, SHVEU_ALIGN_PACKED);
+	packed_ns = time_cpu_surfaces (&s, &d, n);
+
+	shveu_surface_init (&s, SHVEU_YCbCr420, ALIGN_W, ALIGN_H, SHVEU_ALIGN_DEFAULT);
+	shveu_surface_init (&d, SHVEU_YCbCr422, ALIGN_W, ALIGN_H, SHVEU_ALIGN_DEFAULT);
+	aligned_ns = time_cpu_surfaces (&s, &d, n);
+
+	if (packed_ns < 0 || aligned_ns < 0)
+		return -1;
+
+	printf ("align:\t\t%dx%d NV12 to YCbCr422 packed %.1f us, aligned %.1f us (%lu frames)\n",
+		ALIGN_W, ALIGN_H, packed_ns / 1000, aligned_ns / 1000, n);
+
+	return 0;
+}
+
+#define DEDUP_W 640
+#define DEDUP_H 480
+
+static int
+bench_dedup (void)
+{
+	UIOMux * uiomux;
+	unsigned char * src, * dst;
+	unsigned long src_phys, dst_phys, i, n = iterations / 10000;
+	size_t src_size = DEDUP_W * DEDUP_H * 3 / 2, dst_size = DEDUP_W * DEDUP_H * 2;
+	double t, convert_ns, skip_ns;
+	int ret = -1;
+
+	if (n == 0) n = 1;
+
+	if (shveu_open () < 0) {
+		printf ("dedup:\t\tno VEU found, skipped\n");
+		return 0;
+	}
+
+	uiomux = uiomux_open ();
+	if (uiomux == NULL) {
+		shveu_close ();
+		return -1;
+	}
+
+	src = uiomux_malloc (uiomux, UIOMUX_SH_VEU, src_size, 32);
+	dst = uiomux_malloc (uiomux, UIOMUX_SH_VEU, dst_size, 32);
+	if (src == NULL || dst == NULL)
+		goto out;
+	memset (src, 0x80, src_size);
+	src_phys = uiomux_virt_to_phys (uiomux, UIOMUX_SH_VEU, src);
+	dst_phys = uiomux_virt_to_phys (uiomux, UIOMUX_SH_VEU, dst);
+
+#define CONVERT() \
+	shveu_operation (0, src_phys, src_phys + DEDUP_W * DEDUP_H, \
+			 DEDUP_W, DEDUP_H, DEDUP_W, SHVEU_YCbCr420, \
+			 dst_phys, 0, DEDUP_W, DEDUP_H, DEDUP_W, SHVEU_RGB565, \
+			 SHVEU_NO_ROT)
+
+	shveu_set_skip_duplicates (0, 0);
+	t = now_ns ();
+	for (i = 0; i < n; i++) {
+		if (CONVERT () < 0)
+			goto out;
+	}
+	convert_ns = now_ns () - t;
+
+	/* Only the first operation is performed; the others cost a hash of
+	 * the uncached source planes */
+	shveu_set_skip_duplicates (0, 1);
+	if (CONVERT () < 0)
+		goto out;
+	t = now_ns ();
+	for (i = 0; i < n; i++) {
+		if (CONVERT () < 0)
+			goto out;
+	}
+	skip_ns = now_ns () - t;
+
+#undef CONVERT
+
+	if (shveu_get_skipped_frames (0) != n)
+		goto out;
+
+	printf ("dedup:\t\tconvert %.1f us, hash %.1f us (%.0f%% of convert, %lu frames)\n",
+		convert_ns / n / 1000, skip_ns / n / 1000,
+		100.0 * skip_ns / convert_ns, n);
+
+	ret = 0;
+
+out:
+	shveu_set_skip_duplicates (0, 0);
+	if (src) uiomux_free (uiomux, UIOMUX_SH_VEU, src, src_size);
+	if (dst) uiomux_free (uiomux, UIOMUX_SH_VEU, dst, dst_size);
+	uiomux_close (uiomux);
+	shveu_close ();
+
+	return ret;
+}
+
+static int
+bench_open (void)
+{
+	unsigned long i, n = iterations / 1000;
+	double t, first_ns;
+
+	if (n == 0) n = 1;
+
+	/* The first open may populate the topology cache */
+	t = now_ns ();
+	if (shveu_open () < 0) {
+		printf ("open:\t\tno VEU found, skipped\n");
+		return 0;
+	}
+	first_ns = now_ns () - t;
+	shveu_close ();
+
+	t = now_ns ();
+	for (i = 0; i < n; i++) {
+		if (shveu_open () < 0)
+			return -1;
+		shveu_close ();
+	}
+	t = now_ns () - t;
+
+	printf ("open:\t\tfirst %.1f us, then %.1f us (%lu opens)\n",
+		first_ns / 1000, t / n / 1000, n);
+
+	return 0;
+}
+
+int main (int argc, char * argv[])
+{
+	int run_ring = 0, run_poll = 0, run_broker = 0, run_stats = 0, run_align = 0;
+	int run_dedup = 0, run_open = 0;
+
+        int show_version = 0;
+        int show_help = 0;
+        char * progname;
+
+        int c;
+        char * optstring = "n:hv";
+
+#ifdef HAVE_GETOPT_LONG
+        static struct option long_options[] = {
+                {"iterations", required_argument, 0, 'n'},
+                {"help", no_argument, 0, 'h'},
+                {"version", no_argument, 0, 'v'},
+                {NULL,0,0,0}
+        };
+#endif
+
+        progname = argv[0];
+
+        while (1) {
+#ifdef HAVE_GETOPT_LONG
+                c = getopt_long (argc, argv, optstring, long_options, NULL);
+#else
+                c = getopt (argc, argv, optstring);
+#endif
+                if (c == -1) break;
+
+                switch (c) {
+                case 'n': /* iterations */
+                        iterations = strtoul (optarg, NULL, 10);
+                        break;
+                case 'h': /* help */
+                        show_help = 1;
+                        break;
+                case 'v': /* version */
+                        show_version = 1;
+                        break;
+                default:
+                        usage (progname);
+                        goto exit_err;
+                }
+        }
+
+        if (show_version) {
+                printf ("%s version " VERSION "\n", progname);
+        }
+
+        if (show_help) {
+                usage (progname);
+        }
+
+        if (show_version || show_help) {
+                goto exit_ok;
+        }
+
+	if (iterations == 0) {
+		fprintf (stderr, "%s: invalid number of iterations\n", progname);
+		goto exit_err;
+	}
+
+	if (optind == argc) {
+		run_ring = 1;
+		run_poll = 1;
+		run_broker = 1;
+		run_stats = 1;
+		run_align = 1;
+		run_dedup = 1;
+		run_open = 1;
+	}
+
+	while (optind < argc) {
+		if (!strcmp (argv[optind], "ring")) {
+			run_ring = 1;
+		} else if (!strcmp (argv[optind], "poll")) {
+			run_poll = 1;
+		} else if (!strcmp (argv[optind], "broker")) {
+			run_broker = 1;
+		} else if (!strcmp (argv[optind], "stats")) {
+			run_stats = 1;
+		} else if (!strcmp (argv[optind], "align")) {
+			run_align = 1;
+		} else if (!strcmp (argv[optind], "dedup")) {
+			run_dedup = 1;
+		} else if (!strcmp (argv[optind], "open")) {
+			run_open = 1;
+		} else {
+			fprintf (stderr, "%s: unknown test %s\n", progname, argv[optind]);
+			goto exit_err;
+		}
+		optind++;
+	}
+
+	if (run_ring && bench_ring () < 0) {
+		fprintf (stderr, "%s: ring test failed\n", progname);
+		goto exit_err;
+	}
+
+	if (run_poll && bench_poll () < 0) {
+		fprintf (stderr, "%s: poll test failed\n", progname);
+		goto exit_err;
+	}
+
+	if (run_broker && bench_broker () < 0) {
+		fprintf (stderr, "%s: broker test failed\n", progname);
+		goto exit_err;
+	}
+
+	if (run_stats && bench_stats () < 0) {
+		fprintf (stderr, "%s: stats test failed\n", progname);
+		goto exit_err;
+	}
+
+	if (run_align && bench_align () < 0) {
+		fprintf (stderr, "%s: align test failed\n", progname);
+		goto exit_err;
+	}
+
+	if (run_dedup && bench_dedup () < 0) {
+		fprintf (stderr, "%s: dedup test failed\n", progname);
+		goto exit_err;
+	}
+
+	if (run_open && bench_open () < 0) {
+		fprintf (stderr, "%s: open test failed\n", progname);
+		goto exit_err;
+	}
+
+exit_ok:
+        exit (0);
+
+exit_err:
+        exit (1);
+}
@@ -0,0 +1,158 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/types.h>
+
+#include <uiomux/uiomux.h>
+
+#include "shveu/shveu.h"
+#include "shveu/veu_broker.h"
+
+#define DEFAULT_PATH "/dev/shm/shveu"
+#define DEFAULT_MODE 0600
+
+static volatile sig_atomic_t quit = 0;
+
+static void
+usage (const char * progname)
+{
+        printf ("Usage: %s [options] [queue-path]\n", progname);
+        printf ("Share the SH-Mobile VEU between processes.\n");
+	printf ("\n");
+        printf ("The VEU is held by this process, and operations submitted by other\n");
+        printf ("processes through the job queue at queue-path are performed back to back.\n");
+        printf ("The default queue-path is %s\n", DEFAULT_PATH);
+        printf ("\nOptions\n");
+        printf ("  -m, --mode             Permissions of the job queue, in octal (default %04o).\n", DEFAULT_MODE);
+        printf ("                         Processes allowed to open it may use the VEU\n");
+        printf ("\nMiscellaneous options\n");
+        printf ("  -h, --help             Display this help and exit\n");
+        printf ("  -v, --version          Output version information and exit\n");
+	printf ("\n");
+        printf ("Please report bugs to <linux-sh@vger.kernel.org>\n");
+}
+
+static void
+sig_quit (int sig)
+{
+	quit = 1;
+}
+
+int main (int argc, char * argv[])
+{
+	UIOMux * uiomux;
+	struct shveu_broker * broker;
+	char * path = DEFAULT_PATH;
+	mode_t mode = DEFAULT_MODE;
+	char * end;
+	unsigned long jobs = 0;
+	int veu_index = 0;
+
+        int show_version = 0;
+        int show_help = 0;
+        char * progname;
+
+        int c;
+        char * optstring = "m:hv";
+
+#ifdef HAVE_GETOPT_LONG
+        static struct option long_options[] = {
+                {"mode", required_argument, 0, 'm'},
+                {"help", no_argument, 0, 'h'},
+                {"version", no_argument, 0, 'v'},
+                {NULL,0,0,0}
+        };
+#endif
+
+        progname = argv[0];
+
+        while (1) {
+#ifdef HAVE_GETOPT_LONG
+                c = getopt_long (argc, argv, optstring, long_options, NULL);
+#else
+                c = getopt (argc, argv, optstring);
+#endif
+                if (c == -1) break;
+
+                switch (c) {
+                case 'm': /* mode */
+                        mode = strtoul (optarg, &end, 8);
+                        if (*end != '\0' || (mode & ~0777)) {
+                                fprintf (stderr, "%s: invalid mode %s\n", progname, optarg);
+                                goto exit_err;
+                        }
+                        break;
+                case 'h': /* help */
+                        show_help = 1;
+                        break;
+                case 'v': /* version */
+                        show_version = 1;
+                        break;
+                default:
+                        usage (progname);
+                        goto exit_err;
+                }
+        }
+
+        if (show_version) {
+                printf ("%s version " VERSION "\n", progname);
+        }
+
+        if (show_help) {
+                usage (progname);
+        }
+
+        if (show_version || show_help) {
+                goto exit_ok;
+        }
+
+        if (optind < argc) {
+                path = argv[optind++];
+        }
+
+	uiomux = uiomux_open ();
+
+	/* Hold the VEU for the lifetime of the broker */
+	uiomux_lock (uiomux, UIOMUX_SH_VEU);
+
+        if (shveu_open () < 0) {
+		fprintf (stderr, "Error opening VEU\n");
+		goto exit_err;
+	}
+
+	broker = shveu_broker_open (path, mode, veu_index, NULL, NULL);
+	if (broker == NULL) {
+		fprintf (stderr, "%s: unable to create job queue %s\n",
+			 progname, path);
+		goto exit_err;
+	}
+
+	signal (SIGINT, sig_quit);
+	signal (SIGTERM, sig_quit);
+
+	printf ("Job queue: %s\n", path);
+
+	while (!quit) {
+		jobs += shveu_broker_dispatch (broker, 500);
+	}
+
+	shveu_broker_close (broker);
+        shveu_close ();
+
+	uiomux_unlock (uiomux, UIOMUX_SH_VEU);
+	uiomux_close (uiomux);
+
+	printf ("Jobs:\t\t%lu\n", jobs);
+
+exit_ok:
+        exit (0);
+
+exit_err:
+        exit (1);
+}
@@ -2,6 +2,8 @@
 #include "config.h"
 #endif
 
+#define _GNU_SOURCE /* O_DIRECT */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,6 +11,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <glob.h>
+#include <sys/mman.h>
 
 #include <uiomux/uiomux.h>
 
@@ -21,9 +28,111 @@ static int output_h = -1;
 static int input_colorspace = -1;
 static int output_colorspace = -1;
 
+/* SHVEU_FULL_RANGE, SHVEU_BT709 and (output only) SHVEU_FILTER_* flags of
+ * each colorspace */
+static int input_flags = 0;
+static int output_flags = 0;
+
 /* Rotation: default none */
 static int rotation = SHVEU_NO_ROT;
 
+/* Skip conversion of frames identical to the previous frame */
+static int skip_duplicates = 0;
+
+/* Number of source/destination buffer pairs in the pipeline */
+#define DEFAULT_BUFFERS 3
+#define MAX_BUFFERS 16
+static int nr_buffers = -1;
+
+/* Frame range of each input file */
+static long skip_frames = 0;
+static long count_frames = -1;
+
+/* Framebuffer device (or stand-in file) to display output on */
+static char * fb_device = NULL;
+
+/* Overlay layers blended onto RGB output */
+#define MAX_OVERLAYS 8
+static struct shveu_layer overlays[MAX_OVERLAYS];
+static int nr_overlays = 0;
+
+/* Convert on the CPU instead of the VEU */
+static int cpu_only = 0;
+
+/* Number of workers converting segments of the file in parallel */
+#define MAX_JOBS MAX_BUFFERS
+static int nr_jobs = 1;
+
+/* Frames per segment handed to a worker at a time */
+#define SEGMENT_FRAMES 8
+
+/* Output filename template for batch mode */
+static char * output_template = NULL;
+
+/* Transfer frames directly between files and the VEU buffers */
+static int direct_io = 0;
+
+/* O_DIRECT transfers must be a multiple of this size */
+#define DIRECT_ALIGN 512
+
+/* Layout policy of the buffers that frames are converted in */
+static int align_policy = SHVEU_ALIGN_DEFAULT;
+
+/* YUV4MPEG2 input and output */
+static int input_y4m = 0;
+static int output_y4m = 0;
+#define Y4M_MAGIC "YUV4MPEG2"
+#define Y4M_LINE_MAX 256
+static char y4m_rate[32] = "25:1";
+static char y4m_aspect[32] = "1:1";
+static char y4m_interlace[8] = "p";
+
+/* A frame moves FREE -> READ -> CONVERTED -> FREE through the stages */
+#define FRAME_FREE      0
+#define FRAME_READ      1
+#define FRAME_CONVERTED 2
+
+struct pipeline;
+
+struct frame {
+	unsigned char * src_virt, * dest_virt;
+	unsigned long src_py, src_pc, dest_py, dest_pc;
+	int state;
+	int last; /* no more frames follow */
+	struct pipeline * pipeline; /* segment mode */
+};
+
+struct pipeline {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct frame frames[MAX_BUFFERS];
+	int nr_frames;
+	int error;
+
+	UIOMux * uiomux;
+	int veu_index;
+	size_t src_alloc, dest_alloc; /* allocated size of each buffer */
+	int buf_align;
+
+	FILE * infile, * outfile;
+	char * progname, * infilename, * outfilename;
+	int direct_in, direct_out; /* transfer with frame_io() */
+	off_t in_offset, out_offset; /* -1 if not seekable */
+	unsigned char * in_chroma, * out_chroma; /* planar Y4M chroma */
+	int count; /* maximum number of frames to convert, or -1 */
+
+	struct shveu_fb * fb;
+
+	/* Layout of frames in files, which are packed, and in the buffers */
+	struct shveu_surface in_file, out_file;
+	struct shveu_surface in_buf, out_buf;
+
+	/* Segment mode */
+	long nr_segment_frames, next_segment;
+	size_t input_size, output_size;
+	int frameno;
+};
+
 static void
 usage (const char * progname)
 {
@@ -35,26 +144,65 @@ usage (const char * progname)
 	printf ("\n");
         printf ("If no input filename is specified, data is read from stdin.\n");
         printf ("Specify '-' to force input to be read from stdin.\n");
+	printf ("\n");
+        printf ("       %s [options] -O template input-filename ...\n", progname);
+        printf ("Convert several files in one run. Each output filename is made by replacing\n");
+        printf ("%%s in the template with the name of the input file, without its extension\n");
+        printf ("and directory. Input filenames may be quoted wildcard patterns.\n");
         printf ("\nInput options\n");
-        printf ("  -c, --input-colorspace (RGB565, NV12, YCbCr420, YCbCr422)\n");
-        printf ("                         Specify input colorspace\n");
+        printf ("  -y, --input-y4m        Read YUV4MPEG2; geometry and colorspace are taken\n");
+        printf ("                         from the stream\n");
+        printf ("  -k n, --skip n         Skip the first n frames of each input file\n");
+        printf ("  -n n, --count n        Convert at most n frames of each input file\n");
+        printf ("  -c, --input-colorspace (RGB565, RGB565BE, NV12, NV21, YCbCr420,\n");
+        printf ("                         YCbCr422, YCbCr444, YUYV, UYVY) Specify input\n");
+        printf ("                         colorspace. Append ,bt709 and/or ,full for BT.709\n");
+        printf ("                         or full range YCbCr (default BT.601 limited range)\n");
         printf ("  -s, --input-size       Set the input image size (qcif, cif, qvga, vga, d1)\n");
         printf ("\nOutput options\n");
         printf ("  -o filename, --output filename\n");
         printf ("                         Specify output filename (default: stdout)\n");
-        printf ("  -C, --output-colorspace (RGB565, NV12, YCbCr420, YCbCr422)\n");
-        printf ("                         Specify output colorspace\n");
+        printf ("  -C, --output-colorspace (RGB565, RGB565BE, NV12, NV21, YCbCr420,\n");
+        printf ("                         YCbCr422, YCbCr444, YUYV, UYVY) Specify output\n");
+        printf ("                         colorspace, with flags as for --input-colorspace\n");
+        printf ("                         and ,fast or ,smooth to choose the scaling filter\n");
+        printf ("  -Y, --output-y4m       Write YUV4MPEG2\n");
+        printf ("  -F device, --fb device Display output on an RGB565 framebuffer, eg. /dev/fb0,\n");
+        printf ("                         scaled to fill the screen. If device is not a\n");
+        printf ("                         framebuffer, a file is created to stand in for one\n");
+        printf ("  -L spec, --overlay spec\n");
+        printf ("                         Blend an overlay onto RGB output. spec is\n");
+        printf ("                         filename:WxH+X+Y[@alpha], where the file holds raw\n");
+        printf ("                         native-endian ARGB8888 pixels. May be repeated\n");
+        printf ("  -O template, --output-template template\n");
+        printf ("                         Convert all input files, naming outputs after template\n");
         printf ("\nTransform options\n");
 	printf ("  Note that the VEU does not support combined rotation and scaling.\n");
         printf ("  -S, --output-size      Set the output image size (qcif, cif, qvga, vga, d1)\n");
 	printf ("                         [default is same as input size, ie. no rescaling]\n");
         printf ("  -r, --rotate           Rotate the image 90 degrees clockwise\n");
+        printf ("\nPerformance options\n");
+        printf ("  -d, --skip-duplicates  Skip conversion of frames identical to the previous frame\n");
+        printf ("  -b, --buffers n        Number of frames in flight between reading, conversion\n");
+        printf ("                         and writing (1-%d, default %d). 1 disables pipelining,\n",
+                MAX_BUFFERS, DEFAULT_BUFFERS);
+        printf ("                         and is the default with --skip-duplicates.\n");
+        printf ("  -p, --cpu              Convert on the CPU instead of the VEU. Seekable raw\n");
+        printf ("                         files are converted in place in memory-mapped files\n");
+        printf ("  -j n, --jobs n         Convert segments of a seekable raw file with n workers\n");
+        printf ("                         in parallel, on the VEU or the CPU (1-%d, default 1)\n", MAX_JOBS);
+        printf ("  -D, --direct-io        Read and write frames directly to and from the VEU\n");
+        printf ("                         buffers, bypassing stdio and if possible the page cache\n");
+        printf ("  -a policy, --align policy\n");
+        printf ("                         Layout of lines and planes in the buffers (packed,\n");
+        printf ("                         lines, pages; default pages)\n");
         printf ("\nMiscellaneous options\n");
         printf ("  -h, --help             Display this help and exit\n");
         printf ("  -v, --version          Output version information and exit\n");
         printf ("\nFile extensions are interpreted as follows unless otherwise specified:\n");
 	printf ("  .yuv    YCbCr420\n");
 	printf ("  .rgb    RGB565\n");
+	printf ("  .y4m    YUV4MPEG2\n");
 	printf ("\n");
         printf ("Please report bugs to <linux-sh@vger.kernel.org>\n");
 }
@@ -112,6 +260,56 @@ int set_size (char * arg, int * w, int * h)
 	return -1;
 }
 
+/* Load an overlay given as filename:WxH+X+Y[@alpha] */
+static int add_overlay (char * arg)
+{
+	struct shveu_layer * l;
+	char * geom;
+	void * pixels;
+	unsigned long w, h;
+	long x, y;
+	unsigned int alpha = 255;
+	size_t size;
+	FILE * file;
+	int n;
+
+	if (nr_overlays >= MAX_OVERLAYS)
+		return -1;
+
+	geom = strrchr (arg, ':');
+	if (geom == NULL)
+		return -1;
+
+	n = sscanf (geom + 1, "%lux%lu%ld%ld@%u", &w, &h, &x, &y, &alpha);
+	if (n < 4 || w == 0 || h == 0 || alpha > 255)
+		return -1;
+
+	size = w * h * 4;
+	if ((pixels = malloc (size)) == NULL)
+		return -1;
+
+	*geom = '\0';
+	file = fopen (arg, "rb");
+	*geom = ':';
+	if (file == NULL || fread (pixels, 1, size, file) != size) {
+		if (file) fclose (file);
+		free (pixels);
+		return -1;
+	}
+	fclose (file);
+
+	l = &overlays[nr_overlays++];
+	l->argb = pixels;
+	l->width = w;
+	l->height = h;
+	l->pitch = w;
+	l->x = x;
+	l->y = y;
+	l->alpha = alpha;
+
+	return 0;
+}
+
 static const char * show_size (int w, int h)
 {
 	if (w == -1 && h == -1) {
@@ -131,12 +329,52 @@ static const char * show_size (int w, int h)
 	return "";
 }
 
-int set_colorspace (char * arg, int * c)
+/* Parse flags following a colorspace name, eg. "NV12,bt709,full" */
+static int set_colorspace_flags (char * arg, int * flags)
+{
+	char * opt;
+
+	*flags = 0;
+
+	for (opt = strchr (arg, ','); opt != NULL; opt = strchr (opt + 1, ',')) {
+		if (!strncasecmp (opt + 1, "full", 4)) {
+			*flags |= SHVEU_FULL_RANGE;
+		} else if (!strncasecmp (opt + 1, "limited", 7)) {
+			*flags &= ~SHVEU_FULL_RANGE;
+		} else if (!strncasecmp (opt + 1, "bt709", 5)) {
+			*flags |= SHVEU_BT709;
+		} else if (!strncasecmp (opt + 1, "bt601", 5)) {
+			*flags &= ~SHVEU_BT709;
+		} else if (!strncasecmp (opt + 1, "fast", 4)) {
+			*flags = (*flags & ~SHVEU_FILTER_MASK) | SHVEU_FILTER_FAST;
+		} else if (!strncasecmp (opt + 1, "smooth", 6)) {
+			*flags = (*flags & ~SHVEU_FILTER_MASK) | SHVEU_FILTER_SMOOTH;
+		} else {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int set_colorspace (char * arg, int * c, int * flags)
 {
         if (arg) {
-                if (!strncasecmp (arg, "rgb565", 6) ||
+		if (set_colorspace_flags (arg, flags) < 0)
+			return -1;
+
+                if (!strncasecmp (arg, "rgb565be", 8)) {
+                        *c = SHVEU_RGB565_BE;
+                } else if (!strncasecmp (arg, "rgb565", 6) ||
                     !strncasecmp (arg, "rgb", 3)) {
                         *c = SHVEU_RGB565;
+                } else if (!strncasecmp (arg, "NV21", 4)) {
+                        *c = SHVEU_YCrCb420;
+                } else if (!strncasecmp (arg, "YUYV", 4) ||
+                           !strncasecmp (arg, "YUY2", 4)) {
+                        *c = SHVEU_YUYV;
+                } else if (!strncasecmp (arg, "UYVY", 4)) {
+                        *c = SHVEU_UYVY;
                 } else if (!strncasecmp (arg, "YCbCr420", 8) ||
                            !strncasecmp (arg, "420", 3) ||
                            !strncasecmp (arg, "NV12", 4)) {
@@ -144,6 +382,10 @@ int set_colorspace (char * arg, int * c)
                 } else if (!strncasecmp (arg, "YCbCr422", 8) ||
                            !strncasecmp (arg, "422", 3)) {
                         *c = SHVEU_YCbCr422;
+                } else if (!strncasecmp (arg, "YCbCr444", 8) ||
+                           !strncasecmp (arg, "444", 3) ||
+                           !strncasecmp (arg, "NV24", 4)) {
+                        *c = SHVEU_YCbCr444;
                 } else {
                         return -1;
                 }
@@ -154,6 +396,20 @@ int set_colorspace (char * arg, int * c)
 	return -1;
 }
 
+static int set_align_policy (char * arg)
+{
+	if (!strcasecmp (arg, "packed"))
+		align_policy = SHVEU_ALIGN_PACKED;
+	else if (!strcasecmp (arg, "lines"))
+		align_policy = SHVEU_ALIGN_LINES;
+	else if (!strcasecmp (arg, "pages"))
+		align_policy = SHVEU_ALIGN_LINES | SHVEU_ALIGN_PAGES;
+	else
+		return -1;
+
+	return 0;
+}
+
 static char * show_colorspace (int c)
 {
 	switch (c) {
@@ -163,11 +419,54 @@ static char * show_colorspace (int c)
 		return "YCbCr420";
 	case SHVEU_YCbCr422:
 		return "YCbCr422";
+	case SHVEU_YCrCb420:
+		return "YCrCb420 (NV21)";
+	case SHVEU_YUYV:
+		return "YUYV";
+	case SHVEU_UYVY:
+		return "UYVY";
+	case SHVEU_RGB565_BE:
+		return "RGB565 big-endian";
+	case SHVEU_YCbCr444:
+		return "YCbCr444 (NV24)";
 	}
 
 	return "<Unknown colorspace>";
 }
 
+static char * show_flags (int flags)
+{
+	switch (flags & (SHVEU_FULL_RANGE | SHVEU_BT709)) {
+	case SHVEU_FULL_RANGE:
+		return ", BT.601 full range";
+	case SHVEU_BT709:
+		return ", BT.709";
+	case SHVEU_FULL_RANGE | SHVEU_BT709:
+		return ", BT.709 full range";
+	}
+
+	return "";
+}
+
+static char * show_filter (int flags)
+{
+	switch (flags & SHVEU_FILTER_MASK) {
+	case SHVEU_FILTER_FAST:
+		return "Fast";
+	case SHVEU_FILTER_SMOOTH:
+		return "Smooth";
+	}
+
+	return "Default";
+}
+
+/* Whether a colorspace has a separate CbCr plane */
+static int is_planar (int c)
+{
+	return (c == SHVEU_YCbCr420) || (c == SHVEU_YCbCr422) ||
+	       (c == SHVEU_YCrCb420) || (c == SHVEU_YCbCr444);
+}
+
 static char * show_rotation (int r)
 {
 	switch (r) {
@@ -195,6 +494,18 @@ static off_t filesize (char * filename)
 	return statbuf.st_size;
 }
 
+static int is_y4m (char * filename)
+{
+        char * ext;
+
+        if (filename == NULL || !strcmp (filename, "-"))
+                return 0;
+
+	ext = strrchr (filename, '.');
+
+	return (ext != NULL && !strcasecmp (ext, ".y4m"));
+}
+
 static off_t imgsize (int colorspace, int w, int h)
 {
 	int n=0, d=1;
@@ -202,13 +513,21 @@ static off_t imgsize (int colorspace, int w, int h)
         switch (colorspace) {
         case SHVEU_RGB565:
         case SHVEU_YCbCr422:
+        case SHVEU_YUYV:
+        case SHVEU_UYVY:
+        case SHVEU_RGB565_BE:
                 /* 2 bytes per pixel */
                 n=2; d=1;
 	       	break;
        case SHVEU_YCbCr420:
+       case SHVEU_YCrCb420:
 		/* 3/2 bytes per pixel */
 		n=3; d=2;
         	break;
+       case SHVEU_YCbCr444:
+		/* 3 bytes per pixel */
+		n=3; d=1;
+        	break;
        default:
 		return -1;
         }
@@ -258,13 +577,21 @@ static int guess_size (char * filename, int colorspace, int * w, int * h)
         switch (colorspace) {
         case SHVEU_RGB565:
         case SHVEU_YCbCr422:
+        case SHVEU_YUYV:
+        case SHVEU_UYVY:
+        case SHVEU_RGB565_BE:
                 /* 2 bytes per pixel */
                 n=2; d=1;
 	       	break;
        case SHVEU_YCbCr420:
+       case SHVEU_YCrCb420:
 		/* 3/2 bytes per pixel */
 		n=3; d=2;
         	break;
+       case SHVEU_YCbCr444:
+		/* 3 bytes per pixel */
+		n=3; d=1;
+        	break;
        default:
 		return -1;
         }
@@ -295,203 +622,972 @@ static int guess_size (char * filename, int colorspace, int * w, int * h)
 	return 0;
 }
 
-int main (int argc, char * argv[])
+/* Read a YUV4MPEG2 header line, without the newline. Longer lines are
+ * truncated. Returns -1 at end of file. */
+static int
+y4m_read_line (FILE * file, char * line, int size)
 {
-	UIOMux * uiomux;
+	int c, n = 0;
 
-        char * infilename = NULL, * outfilename = NULL;
-        FILE * infile, * outfile = NULL;
-	size_t nread;
-	size_t input_size, output_size;
-	unsigned char * src_virt, * dest_virt;
-	unsigned long src_py, src_pc, dest_py, dest_pc;
-	int veu_index=0;
-	int ret;
-	int frameno=0;
+	while ((c = getc (file)) != EOF && c != '\n') {
+		if (n < size - 1) line[n++] = c;
+	}
+	line[n] = '\0';
 
-        int show_version = 0;
-        int show_help = 0;
-        char * progname;
-	int error = 0;
+	return (c == EOF && n == 0) ? -1 : n;
+}
 
-        int c;
-        char * optstring = "hvo:c:s:C:S:r";
+static void
+y4m_copy_param (char * dest, size_t size, char * value)
+{
+	strncpy (dest, value, size - 1);
+	dest[size - 1] = '\0';
+}
 
-#ifdef HAVE_GETOPT_LONG
-        static struct option long_options[] = {
-                {"help", no_argument, 0, 'h'},
-                {"version", no_argument, 0, 'v'},
-                {"output", required_argument, 0, 'o'},
-                {"input-colorspace", required_argument, 0, 'c'},
-                {"input-size", required_argument, 0, 's'},
-                {"output-colorspace", required_argument, 0, 'C'},
-                {"output-size", required_argument, 0, 'S'},
-                {"rotate", no_argument, 0, 'r'},
-                {NULL,0,0,0}
-        };
-#endif
+/* Parse the stream header, which gives the geometry, chroma format and
+ * range */
+static int
+y4m_read_header (FILE * file, int * w, int * h, int * colorspace, int * flags)
+{
+	char line[Y4M_LINE_MAX];
+	char * tok;
 
-        progname = argv[0];
+	if (y4m_read_line (file, line, sizeof (line)) < 0)
+		return -1;
 
-        if (argc < 2) {
-                usage (progname);
-                return (1);
-        }
+	tok = strtok (line, " ");
+	if (tok == NULL || strcmp (tok, Y4M_MAGIC))
+		return -1;
 
-        if (!strncmp (argv[1], "-?", 2)) {
-#ifdef HAVE_GETOPT_LONG
-                print_options (long_options, optstring);
-#else
-                print_short_options (optstring);
-#endif
-                exit (0);
-        }
+	*colorspace = SHVEU_YCbCr420;
+	*flags &= ~SHVEU_FULL_RANGE;
+
+	while ((tok = strtok (NULL, " ")) != NULL) {
+		switch (tok[0]) {
+		case 'W':
+			*w = atoi (&tok[1]);
+			break;
+		case 'H':
+			*h = atoi (&tok[1]);
+			break;
+		case 'C':
+			/* 420jpeg, 420mpeg2 and 420paldv only differ in chroma siting */
+			if (!strncmp (&tok[1], "420", 3)) {
+				*colorspace = SHVEU_YCbCr420;
+			} else if (!strcmp (&tok[1], "422")) {
+				*colorspace = SHVEU_YCbCr422;
+			} else if (!strcmp (&tok[1], "444")) {
+				*colorspace = SHVEU_YCbCr444;
+			} else {
+				fprintf (stderr, "ERROR: Unsupported Y4M chroma format %s\n", &tok[1]);
+				return -1;
+			}
+			break;
+		case 'F':
+			y4m_copy_param (y4m_rate, sizeof (y4m_rate), &tok[1]);
+			break;
+		case 'A':
+			y4m_copy_param (y4m_aspect, sizeof (y4m_aspect), &tok[1]);
+			break;
+		case 'I':
+			y4m_copy_param (y4m_interlace, sizeof (y4m_interlace), &tok[1]);
+			break;
+		case 'X':
+			if (!strcmp (&tok[1], "COLORRANGE=FULL"))
+				*flags |= SHVEU_FULL_RANGE;
+			break;
+		default:
+			/* Ignore unknown parameters */
+			break;
+		}
+	}
 
-        while (1) {
-#ifdef HAVE_GETOPT_LONG
-                c = getopt_long (argc, argv, optstring, long_options, NULL);
-#else
-                c = getopt (argc, argv, optstring);
-#endif
-                if (c == -1) break;
-                if (c == ':') {
-                        usage (progname);
-                        goto exit_err;
-                }
+	if (*w <= 0 || *h <= 0 || (*w & 1) || (*h & 1)) {
+		fprintf (stderr, "ERROR: Unsupported Y4M frame size %dx%d\n", *w, *h);
+		return -1;
+	}
 
-                switch (c) {
-                case 'h': /* help */
-                        show_help = 1;
-                        break;
-                case 'v': /* version */
-                        show_version = 1;
-                        break;
-                case 'o': /* output */
-                        outfilename = optarg;
-                        break;
-                case 'c': /* input colorspace */
-                        set_colorspace (optarg, &input_colorspace);
-                        break;
-                case 's': /* input size */
-                        set_size (optarg, &input_w, &input_h);
-                        break;
-                case 'C': /* output colorspace */
-                        set_colorspace (optarg, &output_colorspace);
-                        break;
-                case 'S': /* output size */
-                        set_size (optarg, &output_w, &output_h);
-                        break;
-                case 'r': /* rotate */
-                        rotation = SHVEU_ROT_90;
-                        break;
-                default:
-                        break;
-                }
-        }
+	return 0;
+}
 
-        if (show_version) {
-                printf ("%s version " VERSION "\n", progname);
-        }
-      
-        if (show_help) {
-                usage (progname);
-        }
-      
-        if (show_version || show_help) {
-                goto exit_ok;
-        }
+static int
+y4m_write_header (FILE * file, int w, int h, int colorspace, int flags)
+{
+	char * chroma = "420jpeg";
 
-        if (optind >= argc) {
-                usage (progname);
-                goto exit_err;
-        }
+	if (colorspace == SHVEU_YCbCr422)
+		chroma = "422";
+	else if (colorspace == SHVEU_YCbCr444)
+		chroma = "444";
 
-        infilename = argv[optind++];
-	
-	if (optind < argc) {
-	        outfilename = argv[optind++];
+	return fprintf (file, "%s W%d H%d F%s I%s A%s C%s%s\n", Y4M_MAGIC, w, h,
+			y4m_rate, y4m_interlace, y4m_aspect, chroma,
+			(flags & SHVEU_FULL_RANGE) ? " XCOLORRANGE=FULL" : "");
+}
+
+/* Size of one Y4M chroma plane; the VEU interleaves Cb and Cr in one plane */
+static size_t
+y4m_chroma_size (int colorspace, int w, int h)
+{
+	switch (colorspace) {
+	case SHVEU_YCbCr422:
+		return (w/2) * h;
+	case SHVEU_YCbCr444:
+		return w * h;
+	default:
+		return (w/2) * (h/2);
 	}
+}
 
-	printf ("Input file: %s\n", infilename);
-	printf ("Output file: %s\n", outfilename);
+/* Read or write the lines of one plane through stdio, in one piece if
+ * the lines are not padded. Returns the number of bytes transferred. */
+static size_t
+plane_io (FILE * file, unsigned char * buf, size_t line, size_t stride,
+          size_t lines, int writing)
+{
+	size_t i, n = 0;
 
-	guess_colorspace (infilename, &input_colorspace);
-	guess_colorspace (outfilename, &output_colorspace);
-	/* If the output colorspace isn't given and can't be guessed, then default to
-	 * the input colorspace (ie. no colorspace conversion) */
-	if (output_colorspace == -1)
-                output_colorspace = input_colorspace;
+	if (line == stride)
+		return writing ? fwrite (buf, 1, line * lines, file) :
+				 fread (buf, 1, line * lines, file);
 
-	guess_size (infilename, input_colorspace, &input_w, &input_h);
-	/* If the output size isn't given and can't be guessed, then default to
-	 * the input size (ie. no rescaling) */
-	if (output_w == -1 && output_h == -1) {
-		if (rotation == SHVEU_NO_ROT) {
-                	output_w = input_w;
-			output_h = input_h;
-		} else {
-			/* Swap width/height for rotation */
-			output_w = input_h;
-			output_h = input_w;
-		}
+	for (i = 0; i < lines; i++) {
+		n += writing ? fwrite (buf + i * stride, 1, line, file) :
+			       fread (buf + i * stride, 1, line, file);
 	}
 
-	/* Check that all parameters are set */
-	if (input_colorspace == -1) {
-		fprintf (stderr, "ERROR: Input colorspace unspecified\n");
-		error = 1;
-	}
-	if (input_w == -1) {
-		fprintf (stderr, "ERROR: Input width unspecified\n");
-		error = 1;
-	}
-	if (input_h == -1) {
-		fprintf (stderr, "ERROR: Input height unspecified\n");
-		error = 1;
-	}
+	return n;
+}
 
-	if (output_colorspace == -1) {
-		fprintf (stderr, "ERROR: Output colorspace unspecified\n");
-		error = 1;
-	}
-	if (output_w == -1) {
-		fprintf (stderr, "ERROR: Output width unspecified\n");
-		error = 1;
-	}
-	if (output_h == -1) {
-		fprintf (stderr, "ERROR: Output height unspecified\n");
-		error = 1;
-	}
+/* Read or write a packed raw frame through stdio, to or from a buffer laid
+ * out as s. Returns the number of bytes transferred. */
+static size_t
+stdio_frame (FILE * file, unsigned char * buf, const struct shveu_surface * s,
+             int writing)
+{
+	size_t n;
 
-	if (error) goto exit_err;
+	n = plane_io (file, buf, s->y_line, s->y_stride, s->height, writing);
+	if (s->c_lines)
+		n += plane_io (file, buf + s->c_offset, s->c_line, s->c_stride,
+			       s->c_lines, writing);
 
-	printf ("Input colorspace:\t%s\n", show_colorspace (input_colorspace));
-	printf ("Input size:\t\t%dx%d %s\n", input_w, input_h, show_size (input_w, input_h));
-	printf ("Output colorspace:\t%s\n", show_colorspace (output_colorspace));
-	printf ("Output size:\t\t%dx%d %s\n", output_w, output_h, show_size (output_w, output_h));
-	printf ("Rotation:\t\t%s\n", show_rotation (rotation));
+	return n;
+}
 
-	input_size = imgsize (input_colorspace, input_w, input_h);
-	output_size = imgsize (output_colorspace, output_w, output_h);
+/* Read a frame, interleaving the planar chroma for the VEU. Returns the
+ * number of bytes stored in buf, or 0 at the end of the stream. */
+static size_t
+y4m_read_frame (FILE * file, unsigned char * buf, unsigned char * chroma,
+                const struct shveu_surface * s)
+{
+	char line[Y4M_LINE_MAX];
+	size_t cw = s->c_line / 2, csize = cw * s->c_lines;
+	size_t y_size = s->y_line * s->height;
+	unsigned char * cbcr, * cb, * cr;
+	size_t i, j, n;
 
-	uiomux = uiomux_open ();
+	if (y4m_read_line (file, line, sizeof (line)) < 0)
+		return 0;
 
-	/* Set up memory buffers */
-	src_virt = uiomux_malloc (uiomux, UIOMUX_SH_VEU, input_size, 32);
-	src_py = uiomux_virt_to_phys (uiomux, UIOMUX_SH_VEU, src_virt);
-	if (input_colorspace == SHVEU_RGB565) {
-	        src_pc = 0;
-	} else {
-		src_pc = src_py + (input_w * input_h);
+	if (strncmp (line, "FRAME", 5)) {
+		fprintf (stderr, "ERROR: Invalid Y4M frame header\n");
+		return 0;
 	}
 
-	dest_virt = uiomux_malloc (uiomux, UIOMUX_SH_VEU, output_size, 32);
-	dest_py = uiomux_virt_to_phys (uiomux, UIOMUX_SH_VEU, dest_virt);
-	if (output_colorspace == SHVEU_RGB565) {
-	        dest_pc = 0;
-	} else {
-		dest_pc = dest_py + (output_w * output_h);
-	}
+	if ((n = plane_io (file, buf, s->y_line, s->y_stride, s->height, 0)) != y_size)
+		return n;
+
+	n += fread (chroma, 1, 2*csize, file);
+
+	for (j = 0; j < s->c_lines; j++) {
+		cbcr = buf + s->c_offset + j * s->c_stride;
+		cb = chroma + j * cw;
+		cr = cb + csize;
+		for (i = 0; i < cw; i++) {
+			cbcr[2*i] = cb[i];
+			cbcr[2*i+1] = cr[i];
+		}
+	}
+
+	return n;
+}
+
+/* Write a frame, separating the interleaved chroma into planes. Returns
+ * the number of bytes of image data written. */
+static size_t
+y4m_write_frame (FILE * file, unsigned char * buf, unsigned char * chroma,
+                 const struct shveu_surface * s)
+{
+	size_t cw = s->c_line / 2, csize = cw * s->c_lines;
+	unsigned char * cbcr, * cb, * cr;
+	size_t i, j, n;
+
+	for (j = 0; j < s->c_lines; j++) {
+		cbcr = buf + s->c_offset + j * s->c_stride;
+		cb = chroma + j * cw;
+		cr = cb + csize;
+		for (i = 0; i < cw; i++) {
+			cb[i] = cbcr[2*i];
+			cr[i] = cbcr[2*i+1];
+		}
+	}
+
+	if (fputs ("FRAME\n", file) == EOF)
+		return 0;
+
+	n = plane_io (file, buf, s->y_line, s->y_stride, s->height, 1);
+	n += fwrite (chroma, 1, 2*csize, file);
+
+	return n;
+}
+
+/* Use O_DIRECT on a file if frames are a suitable size, otherwise hint
+ * that it will be accessed sequentially */
+static void
+setup_direct_io (FILE * file, size_t frame_size, off_t * offset)
+{
+	int fd = fileno (file);
+	int flags;
+
+	*offset = lseek (fd, 0, SEEK_CUR);
+
+	if (frame_size % DIRECT_ALIGN == 0) {
+		flags = fcntl (fd, F_GETFL);
+		if (flags != -1 && fcntl (fd, F_SETFL, flags | O_DIRECT) == 0)
+			return;
+	}
+
+	posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+/* Transfer a whole frame with pread/pwrite at *offset, or with read/write
+ * if the file is not seekable. Returns the number of bytes transferred. */
+static ssize_t
+frame_io (FILE * file, unsigned char * buf, size_t len, off_t * offset, int writing)
+{
+	int fd = fileno (file);
+	size_t done = 0;
+	ssize_t n;
+	int flags;
+
+	while (done < len) {
+		if (*offset >= 0) {
+			n = writing ? pwrite (fd, buf + done, len - done, *offset + done) :
+				      pread (fd, buf + done, len - done, *offset + done);
+		} else {
+			n = writing ? write (fd, buf + done, len - done) :
+				      read (fd, buf + done, len - done);
+		}
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			/* The filesystem or buffer does not allow O_DIRECT
+			 * after all: continue through the page cache */
+			flags = fcntl (fd, F_GETFL);
+			if (errno == EINVAL && flags != -1 && (flags & O_DIRECT)) {
+				fcntl (fd, F_SETFL, flags & ~O_DIRECT);
+				continue;
+			}
+			break;
+		}
+		if (n == 0)
+			break;
+
+		done += n;
+	}
+
+	if (*offset >= 0)
+		*offset += done;
+
+	return done;
+}
+
+/* Wait until a frame reaches the given state, or the pipeline fails */
+static struct frame *
+wait_frame (struct pipeline * p, int i, int state)
+{
+	struct frame * f = &p->frames[i % p->nr_frames];
+
+	pthread_mutex_lock (&p->lock);
+	while (f->state != state && !p->error)
+		pthread_cond_wait (&p->cond, &p->lock);
+	if (p->error) f = NULL;
+	pthread_mutex_unlock (&p->lock);
+
+	return f;
+}
+
+static void
+post_frame (struct pipeline * p, struct frame * f, int state)
+{
+	pthread_mutex_lock (&p->lock);
+	f->state = state;
+	pthread_cond_broadcast (&p->cond);
+	pthread_mutex_unlock (&p->lock);
+}
+
+static void
+fail_pipeline (struct pipeline * p)
+{
+	pthread_mutex_lock (&p->lock);
+	p->error = 1;
+	pthread_cond_broadcast (&p->cond);
+	pthread_mutex_unlock (&p->lock);
+}
+
+/* Blend the overlays onto a frame converted by the VEU. The frame then no
+ * longer holds the VEU's output, so the next frame must not be skipped as
+ * a duplicate. */
+static int
+blend_overlays (struct pipeline * p, void * dest, int w, int h, int pitch, int colorspace)
+{
+	int ret;
+
+	if (nr_overlays == 0)
+		return 0;
+
+	ret = shveu_blend (dest, w, h, pitch, colorspace, overlays, nr_overlays);
+	shveu_invalidate_duplicates (p->veu_index);
+
+	return ret;
+}
+
+/* Explain why converting frame i failed */
+static void
+convert_error (struct pipeline * p, long i)
+{
+	if (rotation != SHVEU_NO_ROT && (input_w != output_h || input_h != output_w))
+		fprintf (stderr, "Illegal operation: cannot combine rotation and scaling\n");
+	else
+		fprintf (stderr, "%s: cannot convert frame %ld from %dx%d %s to %dx%d %s\n",
+			 p->progname, i, input_w, input_h, show_colorspace (input_colorspace),
+			 output_w, output_h, show_colorspace (output_colorspace));
+}
+
+/* Convert one frame on the CPU, between any two buffers, blending the
+ * overlays onto each line as it is converted */
+static int
+cpu_convert (unsigned char * src, const struct shveu_surface * s,
+             unsigned char * dest, const struct shveu_surface * d)
+{
+	if (nr_overlays)
+		return shveu_cpu_composite (src, src + s->c_offset, input_w, input_h, s->pitch,
+					    input_colorspace | input_flags,
+					    dest, output_w, output_h, d->pitch,
+					    output_colorspace | output_flags,
+					    rotation, overlays, nr_overlays);
+
+	return shveu_cpu_operation (src, src + s->c_offset, input_w, input_h, s->pitch,
+				    input_colorspace | input_flags,
+				    dest, dest + d->c_offset, output_w, output_h, d->pitch,
+				    output_colorspace | output_flags,
+				    rotation);
+}
+
+/* Convert one frame into the hidden framebuffer page and display it */
+static int
+fb_convert (struct pipeline * p, struct frame * f)
+{
+	struct shveu_fb * fb = p->fb;
+	int ret;
+
+	if (cpu_only) {
+		ret = shveu_cpu_composite (f->src_virt, f->src_virt + p->in_buf.c_offset,
+					   input_w, input_h, p->in_buf.pitch,
+					   input_colorspace | input_flags,
+					   shveu_fb_get_buffer (fb, NULL),
+					   fb->width, fb->height, fb->pitch, SHVEU_RGB565, rotation,
+					   overlays, nr_overlays);
+	} else {
+		uiomux_lock (p->uiomux, UIOMUX_SH_VEU);
+		ret = shveu_fb_operation (p->veu_index, fb, f->src_py, f->src_pc,
+					  input_w, input_h, p->in_buf.pitch,
+					  input_colorspace | input_flags,
+					  rotation);
+		uiomux_unlock (p->uiomux, UIOMUX_SH_VEU);
+
+		if (ret == 0)
+			ret = blend_overlays (p, shveu_fb_get_buffer (fb, NULL), fb->width,
+					      fb->height, fb->pitch, SHVEU_RGB565);
+	}
+
+	if (ret == 0)
+		shveu_fb_flip (fb);
+
+	return ret;
+}
+
+/* Whether the VEU supports the conversion, whatever the buffers */
+static int
+veu_supported (struct pipeline * p)
+{
+	struct shveu_prepared prep;
+	struct shveu_op op;
+
+	memset (&op, 0, sizeof (op));
+	op.src_width = input_w;
+	op.src_height = input_h;
+	op.src_pitch = p->in_buf.pitch;
+	op.src_fmt = input_colorspace | input_flags;
+	op.dst_width = output_w;
+	op.dst_height = output_h;
+	op.dst_pitch = p->out_buf.pitch;
+	op.dst_fmt = output_colorspace | output_flags;
+	op.rotate = rotation;
+
+	return (shveu_prepare (&prep, &op) == 0);
+}
+
+static void *
+convert_thread (void * arg)
+{
+	struct pipeline * p = arg;
+	struct frame * f;
+	int i, ret, on_cpu;
+
+	/* Conversions the VEU does not support are done on the CPU. Once
+	 * on the VEU, a failure is an error. */
+	on_cpu = cpu_only || (!p->fb && !veu_supported (p));
+
+	for (i = 0; (f = wait_frame (p, i, FRAME_READ)) != NULL; i++) {
+		if (f->last) {
+			post_frame (p, f, FRAME_CONVERTED);
+			break;
+		}
+
+#ifdef DEBUG
+		fprintf (stderr, "Converting frame %d\n", i);
+#endif
+
+		if (p->fb) {
+			ret = fb_convert (p, f);
+		} else if (on_cpu) {
+			ret = cpu_convert (f->src_virt, &p->in_buf, f->dest_virt, &p->out_buf);
+		} else {
+			uiomux_lock (p->uiomux, UIOMUX_SH_VEU);
+			ret = shveu_operation (p->veu_index, f->src_py, f->src_pc, input_w, input_h, p->in_buf.pitch,
+					                     input_colorspace | input_flags,
+					                     f->dest_py, f->dest_pc, output_w, output_h, p->out_buf.pitch,
+					                     output_colorspace | output_flags,
+						             rotation);
+			uiomux_unlock (p->uiomux, UIOMUX_SH_VEU);
+
+			if (ret == 0)
+				ret = blend_overlays (p, f->dest_virt, output_w, output_h, p->out_buf.pitch,
+						      output_colorspace);
+		}
+
+		if (ret == -1) {
+			convert_error (p, i);
+			fail_pipeline (p);
+			break;
+		}
+
+		post_frame (p, f, FRAME_CONVERTED);
+	}
+
+	return NULL;
+}
+
+static void *
+write_thread (void * arg)
+{
+	struct pipeline * p = arg;
+	struct frame * f;
+	size_t nwritten;
+	int i;
+
+	for (i = 0; (f = wait_frame (p, i, FRAME_CONVERTED)) != NULL; i++) {
+		if (f->last)
+			break;
+
+		if (p->outfile == NULL)
+			nwritten = p->output_size;
+		else if (p->out_chroma)
+			nwritten = y4m_write_frame (p->outfile, f->dest_virt, p->out_chroma,
+						    &p->out_buf);
+		else if (p->direct_out)
+			nwritten = frame_io (p->outfile, f->dest_virt, p->output_size, &p->out_offset, 1);
+		else
+			nwritten = stdio_frame (p->outfile, f->dest_virt, &p->out_buf, 1);
+
+		if (nwritten != p->output_size) {
+			fprintf (stderr, "%s: error writing output file %s\n",
+				 p->progname, p->outfilename);
+			fail_pipeline (p);
+			break;
+		}
+
+		post_frame (p, f, FRAME_FREE);
+	}
+
+	return NULL;
+}
+
+/* Convert segments of frames, taking the next unclaimed segment each time,
+ * until the whole range has been converted. Each worker uses its own
+ * buffers, and frames are written at their own offset so that the output
+ * is in order however the segments are shared out. */
+static void *
+segment_thread (void * arg)
+{
+	struct frame * f = arg;
+	struct pipeline * p = f->pipeline;
+	struct shveu_op op;
+	long seg, i, end;
+	off_t in_offset, out_offset;
+	size_t n;
+	int ret;
+
+	op.src_py = f->src_py; op.src_pc = f->src_pc;
+	op.src_width = input_w; op.src_height = input_h; op.src_pitch = p->in_buf.pitch;
+	op.src_fmt = input_colorspace | input_flags;
+	op.dst_py = f->dest_py; op.dst_pc = f->dest_pc;
+	op.dst_width = output_w; op.dst_height = output_h; op.dst_pitch = p->out_buf.pitch;
+	op.dst_fmt = output_colorspace | output_flags;
+	op.rotate = rotation;
+
+	for (;;) {
+		pthread_mutex_lock (&p->lock);
+		seg = p->error ? p->nr_segment_frames : p->next_segment;
+		p->next_segment = seg + SEGMENT_FRAMES;
+		pthread_mutex_unlock (&p->lock);
+
+		if (seg >= p->nr_segment_frames)
+			break;
+
+		end = seg + SEGMENT_FRAMES;
+		if (end > p->nr_segment_frames) end = p->nr_segment_frames;
+
+		for (i = seg; i < end; i++) {
+			in_offset = p->in_offset + (off_t)i * p->input_size;
+			n = frame_io (p->infile, f->src_virt, p->input_size, &in_offset, 0);
+			if (n != p->input_size) {
+				fprintf (stderr, "%s: error reading input file %s\n",
+					 p->progname, p->infilename);
+				fail_pipeline (p);
+				return NULL;
+			}
+
+			if (nr_overlays)
+				ret = shveu_composite (p->veu_index, &op, overlays, nr_overlays);
+			else
+				ret = shveu_sched_operation (p->veu_index, &op);
+			if (ret < 0) {
+				convert_error (p, i);
+				fail_pipeline (p);
+				return NULL;
+			}
+
+			if (p->outfile) {
+				out_offset = p->out_offset + (off_t)i * p->output_size;
+				n = frame_io (p->outfile, f->dest_virt, p->output_size, &out_offset, 1);
+				if (n != p->output_size) {
+					fprintf (stderr, "%s: error writing output file %s\n",
+						 p->progname, p->outfilename);
+					fail_pipeline (p);
+					return NULL;
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Convert a seekable raw file in segments with one worker per buffer pair */
+static int
+run_segments (struct pipeline * p)
+{
+	pthread_t threads[MAX_JOBS];
+	struct stat statbuf;
+	int i, nr_threads;
+
+	if (fstat (fileno (p->infile), &statbuf) < 0)
+		return -1;
+
+	/* As when mapping the file, a partial frame at the end is ignored */
+	p->nr_segment_frames = 0;
+	if (statbuf.st_size > p->in_offset)
+		p->nr_segment_frames = (statbuf.st_size - p->in_offset) / p->input_size;
+	if (p->count >= 0 && p->nr_segment_frames > p->count)
+		p->nr_segment_frames = p->count;
+	p->next_segment = 0;
+	p->error = 0;
+
+	/* Let the scheduler put the VEU's overflow on the CPU */
+	shveu_sched_set_policy (p->veu_index, SHVEU_SCHED_LATENCY);
+
+	uiomux_lock (p->uiomux, UIOMUX_SH_VEU);
+
+	for (nr_threads = 0; nr_threads < p->nr_frames; nr_threads++) {
+		p->frames[nr_threads].pipeline = p;
+		if (pthread_create (&threads[nr_threads], NULL, segment_thread,
+				    &p->frames[nr_threads]) != 0)
+			break;
+	}
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join (threads[i], NULL);
+
+	uiomux_unlock (p->uiomux, UIOMUX_SH_VEU);
+
+	p->frameno = p->nr_segment_frames;
+
+	return (nr_threads == 0 || p->error) ? -1 : 0;
+}
+
+/* Map a file for sequential access, with huge pages if they are available */
+static unsigned char *
+map_file (int fd, size_t len, int prot)
+{
+	void * addr;
+
+	addr = mmap (NULL, len, prot, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+		return NULL;
+
+	madvise (addr, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	madvise (addr, len, MADV_HUGEPAGE);
+#endif
+
+	return addr;
+}
+
+/* Convert on the CPU straight from a mapping of the input file into a
+ * mapping of the output file, without staging buffers. Returns 1 if the
+ * files cannot be mapped, having converted nothing. */
+static int
+run_mapped (struct pipeline * p)
+{
+	struct stat statbuf;
+	unsigned char * src, * dest = NULL;
+	size_t src_len, dest_len = 0;
+	off_t in_offset, out_offset = 0;
+	long i, n;
+
+	if (fstat (fileno (p->infile), &statbuf) < 0 || !S_ISREG (statbuf.st_mode))
+		return 1;
+	in_offset = lseek (fileno (p->infile), 0, SEEK_CUR) + (off_t)skip_frames * p->input_size;
+
+	/* A partial frame at the end is not mapped */
+	n = 0;
+	if (statbuf.st_size > in_offset)
+		n = (statbuf.st_size - in_offset) / p->input_size;
+	if (p->count >= 0 && n > p->count)
+		n = p->count;
+
+	p->frameno = 0;
+	if (n == 0)
+		return 0;
+
+	src_len = in_offset + n * p->input_size;
+	if ((src = map_file (fileno (p->infile), src_len, PROT_READ)) == NULL)
+		return 1;
+
+	if (p->outfile) {
+		if (fstat (fileno (p->outfile), &statbuf) < 0 || !S_ISREG (statbuf.st_mode))
+			goto no_output_map;
+		fflush (p->outfile);
+		out_offset = lseek (fileno (p->outfile), 0, SEEK_CUR);
+		dest_len = out_offset + n * p->output_size;
+		if (ftruncate (fileno (p->outfile), dest_len) < 0)
+			goto no_output_map;
+		dest = map_file (fileno (p->outfile), dest_len, PROT_READ | PROT_WRITE);
+		if (dest == NULL) {
+			/* Fall back to writing the file */
+			if (ftruncate (fileno (p->outfile), out_offset) < 0) {
+				fprintf (stderr, "%s: error truncating output file %s\n",
+					 p->progname, p->outfilename);
+				munmap (src, src_len);
+				return -1;
+			}
+			goto no_output_map;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (cpu_convert (src + in_offset + i * p->input_size, &p->in_file,
+				 dest ? dest + out_offset + i * p->output_size : p->frames[0].dest_virt,
+				 &p->out_file) == -1) {
+			convert_error (p, i);
+			break;
+		}
+	}
+
+	munmap (src, src_len);
+	if (dest) munmap (dest, dest_len);
+
+	p->frameno = i;
+
+	return (i == n) ? 0 : -1;
+
+no_output_map:
+	munmap (src, src_len);
+	return 1;
+}
+
+static size_t
+read_frame (struct pipeline * p, unsigned char * buf)
+{
+	if (p->in_chroma)
+		return y4m_read_frame (p->infile, buf, p->in_chroma, &p->in_buf);
+	else if (p->direct_in)
+		return frame_io (p->infile, buf, p->input_size, &p->in_offset, 0);
+	else
+		return stdio_frame (p->infile, buf, &p->in_buf, 0);
+}
+
+/* Read frames on the calling thread while converting and writing earlier
+ * frames on their own threads */
+static int
+run_pipeline (struct pipeline * p)
+{
+	pthread_t converter, writer;
+	struct frame * f;
+	size_t nread;
+	int i;
+
+	for (i = 0; i < p->nr_frames; i++) {
+		p->frames[i].state = FRAME_FREE;
+		p->frames[i].last = 0;
+	}
+	p->error = 0;
+
+	if (pthread_create (&converter, NULL, convert_thread, p) != 0)
+		return -1;
+	if (pthread_create (&writer, NULL, write_thread, p) != 0) {
+		fail_pipeline (p);
+		pthread_join (converter, NULL);
+		return -1;
+	}
+
+	for (i = 0; (f = wait_frame (p, i, FRAME_FREE)) != NULL; i++) {
+		nread = (i == p->count) ? 0 : read_frame (p, f->src_virt);
+
+		if (nread == 0) {
+			if (!p->in_chroma && !p->direct_in && ferror (p->infile)) {
+				fprintf (stderr, "%s: error reading input file %s\n",
+					 p->progname, p->infilename);
+			}
+			f->last = 1;
+			post_frame (p, f, FRAME_READ);
+			break;
+		} else if (nread != p->input_size) {
+			fprintf (stderr, "%s: error reading input file %s\n",
+				 p->progname, p->infilename);
+		}
+
+		post_frame (p, f, FRAME_READ);
+	}
+
+	pthread_join (converter, NULL);
+	pthread_join (writer, NULL);
+
+	p->frameno = i;
+
+	return p->error ? -1 : 0;
+}
+
+/* Buffers are in VEU memory unless converting on the CPU */
+static unsigned char *
+alloc_buffer (struct pipeline * p, size_t size, size_t align)
+{
+	void * buf;
+
+	if (align < (size_t) p->buf_align)
+		align = p->buf_align;
+
+	if (cpu_only)
+		return posix_memalign (&buf, align, size) ? NULL : buf;
+
+	return uiomux_malloc (p->uiomux, UIOMUX_SH_VEU, size, align);
+}
+
+static void
+free_buffer (struct pipeline * p, unsigned char * buf, size_t size)
+{
+	if (cpu_only)
+		free (buf);
+	else
+		uiomux_free (p->uiomux, UIOMUX_SH_VEU, buf, size);
+}
+
+static unsigned long
+buffer_phys (struct pipeline * p, unsigned char * buf)
+{
+	return cpu_only ? 0 : uiomux_virt_to_phys (p->uiomux, UIOMUX_SH_VEU, buf);
+}
+
+/* Make sure each buffer can hold a frame of the current geometry, and
+ * point the chroma planes at the right place. Buffers are only reallocated
+ * when they need to grow. */
+static int
+setup_buffers (struct pipeline * p)
+{
+	struct frame * f;
+	int i;
+
+	for (i = 0; i < p->nr_frames; i++) {
+		f = &p->frames[i];
+
+		if (p->in_buf.size > p->src_alloc) {
+			if (f->src_virt)
+				free_buffer (p, f->src_virt, p->src_alloc);
+			f->src_virt = alloc_buffer (p, p->in_buf.size, p->in_buf.align);
+			if (f->src_virt == NULL) return -1;
+			f->src_py = buffer_phys (p, f->src_virt);
+		}
+		if (!is_planar (input_colorspace)) {
+			f->src_pc = 0;
+		} else {
+			f->src_pc = f->src_py + p->in_buf.c_offset;
+		}
+
+		if (p->out_buf.size > p->dest_alloc) {
+			if (f->dest_virt)
+				free_buffer (p, f->dest_virt, p->dest_alloc);
+			f->dest_virt = alloc_buffer (p, p->out_buf.size, p->out_buf.align);
+			if (f->dest_virt == NULL) return -1;
+			f->dest_py = buffer_phys (p, f->dest_virt);
+		}
+		if (!is_planar (output_colorspace)) {
+			f->dest_pc = 0;
+		} else {
+			f->dest_pc = f->dest_py + p->out_buf.c_offset;
+		}
+	}
+
+	if (p->in_buf.size > p->src_alloc) p->src_alloc = p->in_buf.size;
+	if (p->out_buf.size > p->dest_alloc) p->dest_alloc = p->out_buf.size;
+
+	return 0;
+}
+
+static void
+free_buffers (struct pipeline * p)
+{
+	struct frame * f;
+	int i;
+
+	for (i = 0; i < p->nr_frames; i++) {
+		f = &p->frames[i];
+		if (f->src_virt)
+			free_buffer (p, f->src_virt, p->src_alloc);
+		if (f->dest_virt)
+			free_buffer (p, f->dest_virt, p->dest_alloc);
+	}
+
+	free (p->in_chroma);
+	free (p->out_chroma);
+}
+
+/* Skip the first frames of the input, by offset if it is seekable */
+static void
+skip_input (struct pipeline * p, long n)
+{
+	off_t offset;
+
+	if (!p->in_chroma) {
+		offset = p->direct_in ? p->in_offset : lseek (fileno (p->infile), 0, SEEK_CUR);
+		if (offset >= 0) {
+			offset += (off_t)n * p->input_size;
+			/* Padded buffers are filled a line at a time through stdio */
+			if (!shveu_surface_is_packed (&p->in_buf)) {
+				if (fseeko (p->infile, offset, SEEK_SET) == 0)
+					return;
+			} else {
+				p->direct_in = 1;
+				p->in_offset = offset;
+				return;
+			}
+		}
+	}
+
+	while (n-- > 0 && read_frame (p, p->frames[0].src_virt) > 0)
+		;
+}
+
+/* Replace %s in the template with the input filename, without its
+ * directory and extension */
+static char *
+make_output_name (char * template, char * infilename)
+{
+	char * base, * ext, * pct, * name;
+	int baselen;
+
+	base = strrchr (infilename, '/');
+	base = base ? base + 1 : infilename;
+	ext = strrchr (base, '.');
+	baselen = ext ? ext - base : (int) strlen (base);
+
+	pct = strstr (template, "%s");
+	name = malloc (strlen (template) + baselen + 1);
+	if (name == NULL) return NULL;
+
+	sprintf (name, "%.*s%.*s%s", (int)(pct - template), template,
+		 baselen, base, pct + 2);
+
+	return name;
+}
+
+/* Geometry and formats given on the command line; each file starts from
+ * these, and anything unspecified is taken or guessed from the file */
+struct format_args {
+	int input_w, input_h, output_w, output_h;
+	int input_colorspace, output_colorspace;
+	int input_flags, output_flags;
+	int input_y4m, output_y4m;
+};
+
+static void
+save_format_args (struct format_args * args)
+{
+	args->input_w = input_w;
+	args->input_h = input_h;
+	args->output_w = output_w;
+	args->output_h = output_h;
+	args->input_colorspace = input_colorspace;
+	args->output_colorspace = output_colorspace;
+	args->input_flags = input_flags;
+	args->output_flags = output_flags;
+	args->input_y4m = input_y4m;
+	args->output_y4m = output_y4m;
+}
+
+static void
+restore_format_args (struct format_args * args)
+{
+	input_w = args->input_w;
+	input_h = args->input_h;
+	output_w = args->output_w;
+	output_h = args->output_h;
+	input_colorspace = args->input_colorspace;
+	output_colorspace = args->output_colorspace;
+	input_flags = args->input_flags;
+	output_flags = args->output_flags;
+	input_y4m = args->input_y4m;
+	output_y4m = args->output_y4m;
+}
+
+/* Convert one input file. Returns the number of frames converted, or -1
+ * on error */
+static int
+convert_file (struct pipeline * p, FILE * info, char * infilename, char * outfilename)
+{
+	char * progname = p->progname;
+        FILE * infile, * outfile = NULL;
+	size_t input_size, output_size;
+	struct stat statbuf;
+	int error = 0, mapped, policy;
+	int ret = -1;
+
+	fprintf (info, "Input file: %s\n", infilename);
+	fprintf (info, "Output file: %s\n", outfilename);
 
         if (strcmp (infilename, "-") == 0) {
 	        infile = stdin;
@@ -500,10 +1596,137 @@ int main (int argc, char * argv[])
 		if (infile == NULL) {
                         fprintf (stderr, "%s: unable to open input file %s\n",
 	                         progname, infilename);
-                        goto exit_err;
+                        return -1;
 		}
 	}
 
+	if (is_y4m (infilename))
+		input_y4m = 1;
+	if (is_y4m (outfilename))
+		output_y4m = 1;
+
+	/* A Y4M stream describes its own geometry */
+	if (input_y4m && y4m_read_header (infile, &input_w, &input_h, &input_colorspace, &input_flags) < 0) {
+		fprintf (stderr, "%s: invalid YUV4MPEG2 header in %s\n", progname, infilename);
+		goto out_close;
+	}
+
+	/* Output goes to the framebuffer instead of a file */
+	if (fb_device) {
+		outfilename = NULL;
+		output_y4m = 0;
+		output_colorspace = SHVEU_RGB565;
+		if (p->fb) {
+			output_w = p->fb->width;
+			output_h = p->fb->height;
+		}
+	}
+
+	guess_colorspace (infilename, &input_colorspace);
+	guess_colorspace (outfilename, &output_colorspace);
+	/* If the output colorspace isn't given and can't be guessed, then default to
+	 * the input colorspace (ie. no colorspace conversion) */
+	if (output_colorspace == -1)
+                output_colorspace = input_colorspace;
+
+	guess_size (infilename, input_colorspace, &input_w, &input_h);
+	/* If the output size isn't given and can't be guessed, then default to
+	 * the input size (ie. no rescaling) */
+	if (output_w == -1 && output_h == -1) {
+		if (rotation == SHVEU_NO_ROT) {
+                	output_w = input_w;
+			output_h = input_h;
+		} else {
+			/* Swap width/height for rotation */
+			output_w = input_h;
+			output_h = input_w;
+		}
+	}
+
+	if (fb_device && p->fb == NULL && output_w > 0 && output_h > 0) {
+		p->fb = shveu_fb_open (fb_device, 1);
+		if (p->fb == NULL && (stat (fb_device, &statbuf) < 0 || !S_ISCHR (statbuf.st_mode)))
+			p->fb = shveu_fb_open_file (fb_device, output_w, output_h, 2);
+		if (p->fb == NULL) {
+			fprintf (stderr, "%s: unable to open framebuffer %s\n", progname, fb_device);
+			goto out_close;
+		}
+		output_w = p->fb->width;
+		output_h = p->fb->height;
+		fprintf (info, "Framebuffer:\t\t%s %lux%lu, %d buffer(s)\n", fb_device,
+			 p->fb->width, p->fb->height, p->fb->nr_buffers);
+	}
+
+	/* Check that all parameters are set */
+	if (input_colorspace == -1) {
+		fprintf (stderr, "ERROR: Input colorspace unspecified\n");
+		error = 1;
+	}
+	if (input_w == -1) {
+		fprintf (stderr, "ERROR: Input width unspecified\n");
+		error = 1;
+	}
+	if (input_h == -1) {
+		fprintf (stderr, "ERROR: Input height unspecified\n");
+		error = 1;
+	}
+
+	if (output_colorspace == -1) {
+		fprintf (stderr, "ERROR: Output colorspace unspecified\n");
+		error = 1;
+	}
+	if (output_w == -1) {
+		fprintf (stderr, "ERROR: Output width unspecified\n");
+		error = 1;
+	}
+	if (output_h == -1) {
+		fprintf (stderr, "ERROR: Output height unspecified\n");
+		error = 1;
+	}
+
+	if (output_y4m && output_colorspace != SHVEU_YCbCr420 &&
+	    output_colorspace != SHVEU_YCbCr422 && output_colorspace != SHVEU_YCbCr444) {
+		fprintf (stderr, "ERROR: YUV4MPEG2 output must be YCbCr420, YCbCr422 or YCbCr444\n");
+		error = 1;
+	}
+
+	if (nr_overlays && output_colorspace != SHVEU_RGB565 &&
+	    output_colorspace != SHVEU_RGB565_BE) {
+		fprintf (stderr, "ERROR: Overlays require RGB565 or RGB565BE output\n");
+		error = 1;
+	}
+
+	if (error) goto out_close;
+
+	fprintf (info, "Input colorspace:\t%s%s\n", show_colorspace (input_colorspace),
+		 show_flags (input_flags));
+	fprintf (info, "Input size:\t\t%dx%d %s\n", input_w, input_h, show_size (input_w, input_h));
+	fprintf (info, "Output colorspace:\t%s%s\n", show_colorspace (output_colorspace),
+		 show_flags (output_flags));
+	fprintf (info, "Output size:\t\t%dx%d %s\n", output_w, output_h, show_size (output_w, output_h));
+	fprintf (info, "Rotation:\t\t%s\n", show_rotation (rotation));
+	fprintf (info, "Filter:\t\t\t%s\n", show_filter (output_flags));
+
+	input_size = imgsize (input_colorspace, input_w, input_h);
+	output_size = imgsize (output_colorspace, output_w, output_h);
+
+	p->input_size = input_size;
+	p->output_size = output_size;
+
+	/* Frames are transferred whole with O_DIRECT and in parallel mode, so
+	 * buffers are only padded when frames pass through stdio */
+	policy = (direct_io || nr_jobs > 1) ? SHVEU_ALIGN_PACKED : align_policy;
+
+	shveu_surface_init (&p->in_file, input_colorspace, input_w, input_h, SHVEU_ALIGN_PACKED);
+	shveu_surface_init (&p->out_file, output_colorspace, output_w, output_h, SHVEU_ALIGN_PACKED);
+	shveu_surface_init (&p->in_buf, input_colorspace, input_w, input_h, policy);
+	shveu_surface_init (&p->out_buf, output_colorspace, output_w, output_h, policy);
+
+	if (setup_buffers (p) < 0) {
+		fprintf (stderr, "%s: unable to allocate %d buffers\n", progname, p->nr_frames);
+		goto out_close;
+	}
+
 	if (outfilename != NULL) {
                 if (strcmp (outfilename, "-") == 0) {
                         outfile = stdout;
@@ -512,57 +1735,87 @@ int main (int argc, char * argv[])
                         if (outfile == NULL) {
                                 fprintf (stderr, "%s: unable to open output file %s\n",
 	                                 progname, outfilename);
-                                goto exit_err;
+                                goto out_close;
                         }
                 }
 	}
 
-        if (shveu_open () < 0) {
-		fprintf (stderr, "Error opening VEU\n");
-		goto exit_err;
+	p->infile = infile;
+	p->outfile = outfile;
+	p->infilename = infilename;
+	p->outfilename = outfilename;
+	p->direct_in = p->direct_out = 0;
+	p->count = count_frames;
+
+	free (p->in_chroma);
+	free (p->out_chroma);
+	p->in_chroma = p->out_chroma = NULL;
+
+	if (input_y4m) {
+		p->in_chroma = malloc (2 * y4m_chroma_size (input_colorspace, input_w, input_h));
+		if (p->in_chroma == NULL) goto out_close;
 	}
 
-	while (1) {
-#ifdef DEBUG
-		fprintf (stderr, "%s: Converting frame %d\n", progname, frameno);
-#endif
+	if (outfile && output_y4m) {
+		p->out_chroma = malloc (2 * y4m_chroma_size (output_colorspace, output_w, output_h));
+		if (p->out_chroma == NULL) goto out_close;
+		y4m_write_header (outfile, output_w, output_h, output_colorspace, output_flags);
+	}
 
-		/* Read input */
-		if ((nread = fread (src_virt, 1, input_size, infile)) != input_size) {
-			if (nread == 0 && feof (infile)) {
-				break;
-			} else {
-				fprintf (stderr, "%s: error reading input file %s\n",
-					 progname, infilename);
-			}
+	/* Y4M streams are parsed through stdio */
+	p->in_offset = p->out_offset = -1;
+	if (direct_io) {
+		if (!input_y4m) {
+			p->direct_in = 1;
+			setup_direct_io (infile, input_size, &p->in_offset);
 		}
+		if (outfile && !output_y4m) {
+			/* Don't let output bypass messages already buffered */
+			fflush (outfile);
+			p->direct_out = 1;
+			setup_direct_io (outfile, output_size, &p->out_offset);
+		}
+	}
 
-		uiomux_lock (uiomux, UIOMUX_SH_VEU);
-		ret = shveu_operation (veu_index, src_py, src_pc, input_w, input_h, input_w, input_colorspace,
-				                  dest_py, dest_pc, output_w, output_h, output_w, output_colorspace,
-					          rotation);
-		uiomux_unlock (uiomux, UIOMUX_SH_VEU);
-
-		if (ret == -1) {
-			fprintf (stderr, "Illegal operation: cannot combine rotation and scaling\n");
-			goto exit_err;
+	/* Prefer converting between mapped files; fall back to streaming */
+	if (cpu_only && !input_y4m && !output_y4m && !direct_io && !p->fb) {
+		mapped = run_mapped (p);
+		if (mapped == 0) {
+			fprintf (info, "Frames:\t\t%d\n", p->frameno);
+			ret = p->frameno;
 		}
+		if (mapped <= 0)
+			goto out_close;
+	}
 
-		/* Write output */
-		if (outfile && fwrite (dest_virt, 1, output_size, outfile) != output_size) {
-				fprintf (stderr, "%s: error writing input file %s\n",
-					 progname, outfilename);
+	if (nr_jobs > 1) {
+		/* Segments are located by offset in both files */
+		if (input_y4m || output_y4m ||
+		    (p->in_offset = lseek (fileno (infile), 0, SEEK_CUR)) < 0 ||
+		    (outfile && (p->out_offset = lseek (fileno (outfile), 0, SEEK_CUR)) < 0)) {
+			fprintf (stderr, "%s: parallel conversion needs seekable raw files\n", progname);
+			goto out_close;
 		}
+		if (outfile) fflush (outfile);
+		p->in_offset += (off_t)skip_frames * input_size;
+		p->direct_in = p->direct_out = 1;
 
-		frameno++;
+		if (run_segments (p) == 0) {
+			fprintf (info, "Frames:\t\t%d\n", p->frameno);
+			ret = p->frameno;
+		}
+		goto out_close;
 	}
 
-        shveu_close ();
+	if (skip_frames > 0)
+		skip_input (p, skip_frames);
 
-	uiomux_free (uiomux, UIOMUX_SH_VEU, src_virt, input_size);
-	uiomux_free (uiomux, UIOMUX_SH_VEU, dest_virt, output_size);
-	uiomux_close (uiomux);
+	if (run_pipeline (p) == 0) {
+		fprintf (info, "Frames:\t\t%d\n", p->frameno);
+		ret = p->frameno;
+	}
 
+out_close:
 	if (infile != stdin) fclose (infile);
 
 	if (outfile == stdout) {
@@ -571,7 +1824,283 @@ int main (int argc, char * argv[])
 		fclose (outfile);
 	}
 
-	printf ("Frames:\t\t%d\n", frameno);
+	return ret;
+}
+
+int main (int argc, char * argv[])
+{
+	UIOMux * uiomux = NULL;
+
+        char * infilename = NULL, * outfilename = NULL;
+	struct pipeline pipeline;
+	struct format_args args;
+	FILE * info = stdout;
+	glob_t inputs;
+	int veu_index=0;
+	int i, nr_failed = 0;
+
+        int show_version = 0;
+        int show_help = 0;
+        char * progname;
+
+        int c;
+        char * optstring = "hvo:c:s:C:S:rdb:DyYk:n:O:j:pF:L:a:";
+
+#ifdef HAVE_GETOPT_LONG
+        static struct option long_options[] = {
+                {"help", no_argument, 0, 'h'},
+                {"version", no_argument, 0, 'v'},
+                {"output", required_argument, 0, 'o'},
+                {"input-colorspace", required_argument, 0, 'c'},
+                {"input-size", required_argument, 0, 's'},
+                {"output-colorspace", required_argument, 0, 'C'},
+                {"output-size", required_argument, 0, 'S'},
+                {"rotate", no_argument, 0, 'r'},
+                {"skip-duplicates", no_argument, 0, 'd'},
+                {"buffers", required_argument, 0, 'b'},
+                {"direct-io", no_argument, 0, 'D'},
+                {"input-y4m", no_argument, 0, 'y'},
+                {"output-y4m", no_argument, 0, 'Y'},
+                {"skip", required_argument, 0, 'k'},
+                {"count", required_argument, 0, 'n'},
+                {"output-template", required_argument, 0, 'O'},
+                {"jobs", required_argument, 0, 'j'},
+                {"cpu", no_argument, 0, 'p'},
+                {"fb", required_argument, 0, 'F'},
+                {"overlay", required_argument, 0, 'L'},
+                {"align", required_argument, 0, 'a'},
+                {NULL,0,0,0}
+        };
+#endif
+
+        progname = argv[0];
+
+        if (argc < 2) {
+                usage (progname);
+                return (1);
+        }
+
+        if (!strncmp (argv[1], "-?", 2)) {
+#ifdef HAVE_GETOPT_LONG
+                print_options (long_options, optstring);
+#else
+                print_short_options (optstring);
+#endif
+                exit (0);
+        }
+
+        while (1) {
+#ifdef HAVE_GETOPT_LONG
+                c = getopt_long (argc, argv, optstring, long_options, NULL);
+#else
+                c = getopt (argc, argv, optstring);
+#endif
+                if (c == -1) break;
+                if (c == ':') {
+                        usage (progname);
+                        goto exit_err;
+                }
+
+                switch (c) {
+                case 'h': /* help */
+                        show_help = 1;
+                        break;
+                case 'v': /* version */
+                        show_version = 1;
+                        break;
+                case 'o': /* output */
+                        outfilename = optarg;
+                        break;
+                case 'c': /* input colorspace */
+                        set_colorspace (optarg, &input_colorspace, &input_flags);
+                        break;
+                case 's': /* input size */
+                        set_size (optarg, &input_w, &input_h);
+                        break;
+                case 'C': /* output colorspace */
+                        set_colorspace (optarg, &output_colorspace, &output_flags);
+                        break;
+                case 'S': /* output size */
+                        set_size (optarg, &output_w, &output_h);
+                        break;
+                case 'r': /* rotate */
+                        rotation = SHVEU_ROT_90;
+                        break;
+                case 'd': /* skip duplicates */
+                        skip_duplicates = 1;
+                        break;
+                case 'b': /* buffers */
+                        nr_buffers = atoi (optarg);
+                        break;
+                case 'D': /* direct I/O */
+                        direct_io = 1;
+                        break;
+                case 'y': /* input Y4M */
+                        input_y4m = 1;
+                        break;
+                case 'Y': /* output Y4M */
+                        output_y4m = 1;
+                        break;
+                case 'k': /* skip */
+                        skip_frames = atol (optarg);
+                        break;
+                case 'n': /* count */
+                        count_frames = atol (optarg);
+                        break;
+                case 'O': /* output template */
+                        output_template = optarg;
+                        break;
+                case 'j': /* jobs */
+                        nr_jobs = atoi (optarg);
+                        break;
+                case 'p': /* CPU */
+                        cpu_only = 1;
+                        break;
+                case 'F': /* framebuffer */
+                        fb_device = optarg;
+                        break;
+                case 'L': /* overlay */
+                        if (add_overlay (optarg) < 0) {
+                                fprintf (stderr, "%s: invalid overlay %s\n", progname, optarg);
+                                goto exit_err;
+                        }
+                        break;
+                case 'a': /* alignment */
+                        if (set_align_policy (optarg) < 0) {
+                                fprintf (stderr, "%s: invalid alignment policy %s\n", progname, optarg);
+                                goto exit_err;
+                        }
+                        break;
+                default:
+                        break;
+                }
+        }
+
+        if (show_version) {
+                printf ("%s version " VERSION "\n", progname);
+        }
+      
+        if (show_help) {
+                usage (progname);
+        }
+      
+        if (show_version || show_help) {
+                goto exit_ok;
+        }
+
+        if (optind >= argc) {
+                usage (progname);
+                goto exit_err;
+        }
+
+	if (output_template && strstr (output_template, "%s") == NULL) {
+		fprintf (stderr, "ERROR: Output template must contain %%s\n");
+		goto exit_err;
+	}
+
+	if (skip_frames < 0 || count_frames < -1) {
+		fprintf (stderr, "ERROR: Invalid frame range\n");
+		goto exit_err;
+	}
+
+	/* Duplicates can only be skipped if each frame is converted into the
+	 * same destination buffer as the previous one */
+	if (nr_buffers == -1)
+		nr_buffers = skip_duplicates ? 1 : DEFAULT_BUFFERS;
+
+	if (nr_buffers < 1 || nr_buffers > MAX_BUFFERS) {
+		fprintf (stderr, "ERROR: Number of buffers must be 1 to %d\n", MAX_BUFFERS);
+		goto exit_err;
+	}
+
+	if (nr_jobs < 1 || nr_jobs > MAX_JOBS) {
+		fprintf (stderr, "ERROR: Number of jobs must be 1 to %d\n", MAX_JOBS);
+		goto exit_err;
+	}
+
+	/* Each worker converts into its own buffer pair */
+	if (nr_jobs > 1) {
+		if (skip_duplicates || cpu_only || fb_device) {
+			fprintf (stderr, "ERROR: Parallel conversion cannot be combined with --skip-duplicates, --cpu or --fb\n");
+			goto exit_err;
+		}
+		nr_buffers = nr_jobs;
+	}
+
+	memset (&inputs, 0, sizeof (inputs));
+	if (output_template) {
+		/* Expand quoted wildcards; other names are used as given */
+		for (i = optind; i < argc; i++) {
+			glob (argv[i], GLOB_NOCHECK | (i > optind ? GLOB_APPEND : 0),
+			      NULL, &inputs);
+		}
+	} else {
+		infilename = argv[optind++];
+
+		if (optind < argc) {
+			outfilename = argv[optind++];
+		}
+
+		/* Keep messages out of the data if writing to stdout */
+		if (outfilename != NULL && strcmp (outfilename, "-") == 0)
+			info = stderr;
+	}
+
+	save_format_args (&args);
+
+	if (!cpu_only)
+		uiomux = uiomux_open ();
+
+	memset (&pipeline, 0, sizeof (pipeline));
+	pthread_mutex_init (&pipeline.lock, NULL);
+	pthread_cond_init (&pipeline.cond, NULL);
+	pipeline.nr_frames = nr_buffers;
+	pipeline.uiomux = uiomux;
+	pipeline.veu_index = veu_index;
+	pipeline.progname = progname;
+
+	/* O_DIRECT needs buffers aligned to the logical block size */
+	pipeline.buf_align = direct_io ? sysconf (_SC_PAGESIZE) : 32;
+
+        if (!cpu_only && shveu_open () < 0) {
+		fprintf (stderr, "Error opening VEU\n");
+		goto exit_err;
+	}
+
+	if (skip_duplicates)
+		shveu_set_skip_duplicates (veu_index, 1);
+
+	if (output_template) {
+		for (i = 0; i < (int) inputs.gl_pathc; i++) {
+			infilename = inputs.gl_pathv[i];
+			outfilename = make_output_name (output_template, infilename);
+
+			restore_format_args (&args);
+			if (outfilename == NULL || convert_file (&pipeline, info, infilename, outfilename) < 0)
+				nr_failed++;
+
+			free (outfilename);
+		}
+
+		fprintf (info, "Files:\t\t%d (%d failed)\n", (int) inputs.gl_pathc, nr_failed);
+		globfree (&inputs);
+	} else {
+		if (convert_file (&pipeline, info, infilename, outfilename) < 0)
+			nr_failed++;
+	}
+
+	if (skip_duplicates)
+		fprintf (info, "Duplicates:\t%lu\n", shveu_get_skipped_frames (veu_index));
+
+	free_buffers (&pipeline);
+	shveu_fb_close (pipeline.fb);
+
+	if (!cpu_only) {
+		shveu_close ();
+		uiomux_close (uiomux);
+	}
+
+	if (nr_failed) goto exit_err;
 
 exit_ok:
         exit (0);